@@ -1,10 +1,15 @@
 #include <iostream>
 #include <Windows.h>
 #include <string>
+#include <memory>
+#include <vector>
 
 #include <Math.hpp>
 #include <Gfx.hpp>
+#include <RenderQueue.hpp>
 #include <Timer.hpp>
+#include <AssetFile.hpp>
+#include <MeshImporter.hpp>
 
 /**
  * Коды ошибок
@@ -31,6 +36,35 @@ ErrorCode g_lastError = ErrorCode::eNoErrors;
 /// Таймер
 tools::Timer* g_pTimer = nullptr;
 
+/// Положения вершин куба (константы времени компиляции)
+constexpr math::Vec3<float> g_cubeVertices[] = {
+        {-1.0f,1.0f,1.0f},
+        {1.0f,1.0f,1.0f},
+        {1.0f,-1.0f,1.0f},
+        {-1.0f,-1.0f,1.0f},
+
+        {-1.0f,1.0f,-1.0f},
+        {1.0f,1.0f,-1.0f},
+        {1.0f,-1.0f,-1.0f},
+        {-1.0f,-1.0f,-1.0f}
+};
+/// Индексы куба (тройки вершин)
+constexpr size_t g_cubeIndices[] = {
+        0,1,2, 2,3,0,
+        1,5,6, 6,2,1,
+        5,4,7, 7,6,5,
+        4,0,3, 3,7,4,
+        4,5,1, 1,0,4,
+        3,2,6, 6,7,3
+};
+/// Кол-во индексов куба
+constexpr size_t g_cubeIndexCount = sizeof(g_cubeIndices) / sizeof(g_cubeIndices[0]);
+/// Описывающий параллелепипед куба (вычисляется при компиляции)
+constexpr math::BBox<math::Vec3<float>> g_cubeBounds = math::FindBoundingBox(g_cubeVertices, sizeof(g_cubeVertices) / sizeof(g_cubeVertices[0]));
+
+static_assert(g_cubeIndexCount % 3 == 0, "Cube indices must form triangles");
+static_assert(g_cubeBounds.min.x == -1.0f && g_cubeBounds.max.z == 1.0f, "Cube bounds must be evaluated at compile time");
+
 /**
  * Обработчик оконных сообщений
  * @param hWnd Дескриптор окна
@@ -50,11 +84,31 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM
  */
 void PresentFrame(void *pixels, int width, int height, HWND hWnd);
 
+/**
+ * Команда отрисовки меша (элемент очереди отрисовки)
+ */
+struct MeshDrawCommand
+{
+    /// Указатель на массив вершин
+    const math::Vec3<float>* pVertices;
+    /// Указатель на массив индексов
+    const size_t* pIndices;
+    /// Кол-во индексов
+    size_t indexCount;
+    /// Положение меша
+    math::Vec3<float> position;
+    /// Ориентация меша
+    math::Vec3<float> orientation;
+    /// Цвет (RGB в диапозоне от 0 до 1)
+    math::Vec3<float> color;
+};
+
 /**
  * Нарисовать полигональный меш
  * @param frameBuffer Указатель на кадровый буфер
  * @param vertices Массив вершин
  * @param indices Массив индексов
+ * @param indexCount Кол-во индексов
  * @param position Положение меша
  * @param orientation Ориентация меша
  * @param color Цвет (RGB в диапозоне от 0 до 1)
@@ -63,8 +117,9 @@ void PresentFrame(void *pixels, int width, int height, HWND hWnd);
  * @param fillFaces Заливка граней (false для сеточной отрисовки)
  */
 void DrawMesh(gfx::ImageBuffer<RGBQUAD>* frameBuffer,
-        const std::vector<math::Vec3<float>>& vertices,
-        const std::vector<size_t>& indices,
+        const math::Vec3<float>* vertices,
+        const size_t* indices,
+        size_t indexCount,
         const math::Vec3<float>& position,
         const math::Vec3<float>& orientation,
         const math::Vec3<float>& color = {0.0f,1.0f,0.0f},
@@ -137,35 +192,77 @@ int main(int argc, char* argv[])
         auto frameBuffer = gfx::ImageBuffer<RGBQUAD>(clientRect.right, clientRect.bottom, {0, 0, 0, 0});
         std::cout << "INFO: Frame-buffer initialized  (resolution : " << frameBuffer.getWidth() << "x" << frameBuffer.getHeight() << ", size : " << frameBuffer.getSize() << " bytes)" << std::endl;
 
-        // Положения вершин куба
-        std::vector<math::Vec3<float>> vertices {
-                {-1.0f,1.0f,1.0f},
-                {1.0f,1.0f,1.0f},
-                {1.0f,-1.0f,1.0f},
-                {-1.0f,-1.0f,1.0f},
-
-                {-1.0f,1.0f,-1.0f},
-                {1.0f,1.0f,-1.0f},
-                {1.0f,-1.0f,-1.0f},
-                {-1.0f,-1.0f,-1.0f}
-        };
-
-        // Индексы (тройки вершин)
-        std::vector<size_t> indices {
-                0,1,2, 2,3,0,
-                1,5,6, 6,2,1,
-                5,4,7, 7,6,5,
-                4,0,3, 3,7,4,
-                4,5,1, 1,0,4,
-                3,2,6, 6,7,3
-        };
-
         // Текущий угол поворота
         float rotationAngle = 0.0f;
 
         // Скорость вращения
         float angleSpeed = 0.02f;
 
+        // Меш центрального объекта (путь - первый аргумент командной строки, без него - куб). Файлы .obj и .ply
+        // импортируются, остальные открываются как файлы ассетов (используется первый меш, положения вершин - прямо
+        // из отображенного файла). Индексы расширяются до size_t для DrawMesh
+        std::unique_ptr<tools::AssetFile> pAssetFile;
+        tools::ImportedMesh importedMesh;
+        std::vector<size_t> meshIndices;
+        const math::Vec3<float>* pMeshVertices = g_cubeVertices;
+        const size_t* pMeshIndices = g_cubeIndices;
+        size_t meshIndexCount = g_cubeIndexCount;
+        math::BBox<math::Vec3<float>> meshBounds = g_cubeBounds;
+
+        if(argc > 1)
+        {
+            const std::string path = argv[1];
+            const std::string extension = path.size() > 4 ? path.substr(path.size() - 4) : std::string();
+
+            if(extension == ".obj" || extension == ".OBJ" || extension == ".ply" || extension == ".PLY")
+            {
+                tools::ThreadPool threadPool;
+                importedMesh = tools::LoadMesh(path, &threadPool);
+                meshIndices.assign(importedMesh.indices.begin(), importedMesh.indices.end());
+                pMeshVertices = importedMesh.positions.data();
+                meshBounds = importedMesh.bounds;
+                std::cout << "INFO: Mesh imported (vertices : " << importedMesh.positions.size() << ", triangles : " << meshIndices.size() / 3 << ")" << std::endl;
+            }
+            else
+            {
+                pAssetFile.reset(new tools::AssetFile(path));
+                if(pAssetFile->getMeshCount() == 0){
+                    throw std::runtime_error("ERROR: Asset file has no meshes " + path);
+                }
+
+                // Индексы файла не проверяются при открытии - проверяем перед отрисовкой
+                const tools::MeshView mesh = pAssetFile->getMesh(0);
+                meshIndices.resize(mesh.indexCount - mesh.indexCount % 3);
+                for(size_t i = 0; i < meshIndices.size(); i++)
+                {
+                    meshIndices[i] = mesh.getIndex(i);
+                    if(meshIndices[i] >= mesh.vertexCount){
+                        throw std::runtime_error("ERROR: Mesh index is out of range in asset file " + path);
+                    }
+                }
+
+                pMeshVertices = mesh.pPositions;
+                meshBounds = mesh.bounds;
+                std::cout << "INFO: Mesh loaded from asset file (vertices : " << mesh.vertexCount << ", triangles : " << meshIndices.size() / 3 << ")" << std::endl;
+            }
+
+            pMeshIndices = meshIndices.data();
+            meshIndexCount = meshIndices.size();
+        }
+
+        // Описывающие параллелепипеды мешей объектов (в пространстве модели) для отсечения по пирамиде видимости
+        const math::BBox<math::Vec3<float>> objectBounds[] = {g_cubeBounds, meshBounds, g_cubeBounds};
+
+        // Центральный объект отодвигается так, чтобы меш любого размера помещался в кадр
+        const float meshDistance = std::max(4.0f, math::Length(meshBounds.max - meshBounds.min));
+
+        // Пирамида видимости (те же параметры, что используются при проекции в DrawMesh)
+        float aspectRatio = static_cast<float>(frameBuffer.getWidth()) / static_cast<float>(frameBuffer.getHeight());
+        auto frustum = math::GetFrustum(math::GetProjectionMatPerspective(90.0f, aspectRatio, 0.1f, 100.0f));
+
+        // Очередь отрисовки кадра (буфера глубины нет, поэтому объекты рисуются от дальних к ближним)
+        gfx::RenderQueue<MeshDrawCommand> renderQueue(gfx::RenderQueue<MeshDrawCommand>::DepthOrder::eBackToFront, 16);
+
         /** MAIN LOOP **/
 
         // Таймер основного цикла (для выяснения временной дельты и FPS)
@@ -190,32 +287,73 @@ int main(int argc, char* argv[])
                 }
             }
 
+            // Приращение угла поворота
+            rotationAngle += (angleSpeed * g_pTimer->getDelta());
+
+            // Объекты сцены
+            MeshDrawCommand objects[] = {
+                    {g_cubeVertices, g_cubeIndices, g_cubeIndexCount, {-2.5f,0.0f,-6.0f}, {rotationAngle,0.0f,0.0f}, {1.0f,0.0f,0.0f}},
+                    {pMeshVertices, pMeshIndices, meshIndexCount, {0.0f,0.0f,-meshDistance}, {rotationAngle,rotationAngle,0.0f}, {0.0f,1.0f,0.0f}},
+                    {g_cubeVertices, g_cubeIndices, g_cubeIndexCount, {2.5f,0.0f,-6.0f}, {0.0f,rotationAngle,0.0f}, {0.0f,0.0f,1.0f}}
+            };
+            const size_t objectCount = sizeof(objects) / sizeof(objects[0]);
+            static_assert(sizeof(objectBounds) / sizeof(objectBounds[0]) == objectCount, "Each object needs bounds");
+
+            // Описывающие сферы объектов в пространстве мира и пакетное отсечение по пирамиде видимости
+            math::Vec4<float> spheres[objectCount];
+            std::uint8_t visible[objectCount];
+            for(size_t i = 0; i < objectCount; i++)
+            {
+                auto meshCenter = (objectBounds[i].min + objectBounds[i].max) * 0.5f;
+                auto meshRadius = math::Length(objectBounds[i].max - objectBounds[i].min) * 0.5f;
+                auto c = math::RotateAroundZ(math::RotateAroundY(math::RotateAroundX(meshCenter, objects[i].orientation.x), objects[i].orientation.y), objects[i].orientation.z) + objects[i].position;
+                spheres[i] = {c.x, c.y, c.z, meshRadius};
+            }
+            math::CullSpheres(frustum, spheres, objectCount, visible);
+
+            // Собрать команды отрисовки кадра для видимых объектов (глубина - расстояние до наблюдателя по оси Z)
+            renderQueue.clear();
+            for(size_t i = 0; i < objectCount; i++){
+                if(visible[i]) renderQueue.push(0, -objects[i].position.z, objects[i]);
+            }
+
+            // Нарисовать полигональные меши (пакетами по состоянию, в порядке глубины)
+            renderQueue.submit(
+                    [](std::uint32_t){},
+                    [&](std::uint32_t, const MeshDrawCommand* commands, size_t count)
+                    {
+                        for(size_t i = 0; i < count; i++)
+                        {
+                            DrawMesh(
+                                    &frameBuffer,
+                                    commands[i].pVertices,
+                                    commands[i].pIndices,
+                                    commands[i].indexCount,
+                                    commands[i].position,
+                                    commands[i].orientation,
+                                    commands[i].color,
+                                    true,
+                                    true,
+                                    true);
+                        }
+                    });
+
             // Поскольку показ FPS на окне уменьшает FPS - делаем это только тогда когда счетчик готов (примерно 1 раз в секунду)
             if (g_pTimer->isFpsCounterReady()){
-                std::string fps = std::string(g_strWindowCaption).append(" (").append(std::to_string(g_pTimer->getFps())).append(" FPS)");
+                // Кол-во треугольников этого кадра, нарисованных путем для мелких треугольников и общим путем (до сброса счетчиков)
+                const auto& stats = gfx::GetTriangleStats();
+                std::string fps = std::string(g_strWindowCaption).append(" (").append(std::to_string(g_pTimer->getFps())).append(" FPS, ")
+                        .append(std::to_string(stats.microTriangles)).append(" micro / ")
+                        .append(std::to_string(stats.regularTriangles)).append(" regular triangles)");
                 SetWindowTextA(g_hwnd, fps.c_str());
             }
 
-            // Приращение угла поворота
-            rotationAngle += (angleSpeed * g_pTimer->getDelta());
-
-            // Нарисовать полигональный меш
-            DrawMesh(
-                    &frameBuffer,
-                    vertices,
-                    indices,
-                    {0.0f,0.0f,-4.0f},
-                    {rotationAngle,rotationAngle,0.0f},
-                    {0.0f,1.0f,0.0f},
-                    true,
-                    true,
-                    true);
-
             // Показ кадра
             PresentFrame(frameBuffer.getData(), static_cast<int>(frameBuffer.getWidth()), static_cast<int>(frameBuffer.getHeight()), g_hwnd);
 
-            // Очистка кадра
+            // Очистка кадра и счетчиков растеризации
             frameBuffer.clear({0,0,0,0});
+            gfx::ResetTriangleStats();
         }
     }
     catch(std::exception& ex)
@@ -322,6 +460,7 @@ void PresentFrame(void *pixels, int width, int height, HWND hWnd)
  * @param frameBuffer Указатель на кадровый буфер
  * @param vertices Массив вершин
  * @param indices Массив индексов
+ * @param indexCount Кол-во индексов
  * @param position Положение меша
  * @param orientation Ориентация меша
  * @param color Цвет (RGB в диапозоне от 0 до 1)
@@ -330,8 +469,9 @@ void PresentFrame(void *pixels, int width, int height, HWND hWnd)
  * @param fillFaces Заливка граней (false для сеточной отрисовки)
  */
 void DrawMesh(gfx::ImageBuffer<RGBQUAD>* frameBuffer,
-              const std::vector<math::Vec3<float>>& vertices,
-              const std::vector<size_t>& indices,
+              const math::Vec3<float>* vertices,
+              const size_t* indices,
+              size_t indexCount,
               const math::Vec3<float>& position,
               const math::Vec3<float>& orientation,
               const math::Vec3<float>& color,
@@ -343,7 +483,7 @@ void DrawMesh(gfx::ImageBuffer<RGBQUAD>* frameBuffer,
     float aspectRatio = static_cast<float>(frameBuffer->getWidth()) / static_cast<float>(frameBuffer->getHeight());
 
     // Пройти по всем индексам (шаг - 3 индекса)
-    for(size_t i = 3; i <= indices.size(); i+=3)
+    for(size_t i = 3; i <= indexCount; i+=3)
     {
         // Точки треугольника (в координатаъ экрана)
         std::vector<math::Vec2<int>> triangleScreen;
@@ -0,0 +1,306 @@
+/**
+ * Классы анимационных клипов. Используются для вычисления локальных трансформаций костей по ключевым кадрам
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+#include <Math.hpp>
+
+#include "FlatSkeleton.hpp"
+
+/**
+ * Анимационный клип
+ * @details Для каждой анимируемой кости хранится дорожка с ключевыми кадрами переноса, поворота и масштаба.
+ * Ключи каждого канала должны идти по возрастанию времени. Время задается в тех же единицах, что и при воспроизведении
+ */
+class AnimationClip
+{
+public:
+    /**
+     * Ключевой кадр
+     * @tparam T Тип значения (вектор или кватернион)
+     */
+    template <typename T>
+    struct Key
+    {
+        /// Время кадра
+        float time;
+        /// Значение
+        T value;
+    };
+
+    /**
+     * Дорожка кости
+     */
+    struct Track
+    {
+        /// Исходный индекс кости
+        size_t boneIndex = 0;
+        /// Ключи переноса (пустой массив - нулевой перенос)
+        std::vector<Key<math::Vec3<float>>> translationKeys;
+        /// Ключи поворота (пустой массив - без поворота)
+        std::vector<Key<math::Quat<float>>> rotationKeys;
+        /// Ключи масштаба (пустой массив - единичный масштаб)
+        std::vector<Key<math::Vec3<float>>> scaleKeys;
+    };
+
+private:
+    /// Длительность клипа
+    float duration_;
+    /// Дорожки костей
+    std::vector<Track> tracks_;
+
+public:
+    /**
+     * Конструктор
+     * @param duration Длительность клипа
+     */
+    explicit AnimationClip(float duration):duration_(duration){}
+
+    /**
+     * Добавить дорожку кости
+     * @param boneIndex Исходный индекс кости
+     * @return Ссылка на дорожку (действительна до добавления следующей дорожки)
+     */
+    Track& addTrack(size_t boneIndex)
+    {
+        tracks_.emplace_back();
+        tracks_.back().boneIndex = boneIndex;
+        return tracks_.back();
+    }
+
+    /**
+     * Получить дорожки костей
+     * @return Ссылка на массив дорожек
+     */
+    const std::vector<Track>& getTracks() const
+    {
+        return tracks_;
+    }
+
+    /**
+     * Получить длительность клипа
+     * @return Число с плавающей точкой
+     */
+    float getDuration() const
+    {
+        return duration_;
+    }
+};
+
+/**
+ * Воспроизведение анимационного клипа
+ * @details Для каждого канала хранится курсор - индекс последнего пройденного ключа. При монотонно растущем времени
+ * нужный отрезок находится сдвигом курсора на 0-1 ключ (без бинарного поиска), при возврате времени назад
+ * (зацикливание) курсор сбрасывается в начало. Результат пишется прямо в массив локальных трансформаций скелета.
+ * Память выделяется только в конструкторе
+ */
+class AnimationSampler
+{
+private:
+    /// Клип
+    const AnimationClip* pClip_;
+    /// Индекс в массиве позы для каждой дорожки (SIZE_MAX - дорожка не используется)
+    std::vector<size_t> targets_;
+    /// Курсоры каналов (по 3 на дорожку: перенос, поворот, масштаб)
+    std::vector<std::uint32_t> cursors_;
+    /// Текущее время воспроизведения
+    float time_;
+
+    /**
+     * Интерполяция векторов
+     * @param a Первое значение
+     * @param b Второе значение
+     * @param ratio Коэффициент
+     * @return Вектор
+     */
+    static math::Vec3<float> interpolate(const math::Vec3<float>& a, const math::Vec3<float>& b, float ratio)
+    {
+        return math::Mix(a, b, ratio);
+    }
+
+    /**
+     * Интерполяция кватернионов
+     * @param a Первое значение
+     * @param b Второе значение
+     * @param ratio Коэффициент
+     * @return Кватернион
+     */
+    static math::Quat<float> interpolate(const math::Quat<float>& a, const math::Quat<float>& b, float ratio)
+    {
+        return math::Slerp(a, b, ratio);
+    }
+
+    /**
+     * Получить значение канала в момент времени
+     * @tparam T Тип значения
+     * @param keys Ключи канала
+     * @param cursor Курсор канала (обновляется)
+     * @param time Время
+     * @param defaultValue Значение для канала без ключей
+     * @return Значение
+     */
+    template <typename T>
+    static T sampleChannel(const std::vector<AnimationClip::Key<T>>& keys, std::uint32_t& cursor, float time, const T& defaultValue)
+    {
+        if(keys.empty()) return defaultValue;
+
+        const auto count = static_cast<std::uint32_t>(keys.size());
+        if(count == 1 || time <= keys[0].time){
+            cursor = 0;
+            return keys[0].value;
+        }
+
+        // Время ушло назад - поиск с начала
+        if(cursor >= count || keys[cursor].time > time) cursor = 0;
+        while(cursor + 1 < count && keys[cursor + 1].time <= time) cursor++;
+
+        if(cursor + 1 == count) return keys[cursor].value;
+
+        const AnimationClip::Key<T>& k0 = keys[cursor];
+        const AnimationClip::Key<T>& k1 = keys[cursor + 1];
+        return interpolate(k0.value, k1.value, (time - k0.time) / (k1.time - k0.time));
+    }
+
+public:
+    /**
+     * Конструктор (поза индексируется исходными индексами костей)
+     * @param clip Клип (должен существовать все время работы)
+     */
+    explicit AnimationSampler(const AnimationClip& clip):
+            pClip_(&clip),
+            cursors_(clip.getTracks().size() * 3, 0),
+            time_(0.0f)
+    {
+        targets_.reserve(clip.getTracks().size());
+        for(const auto& track : clip.getTracks()) targets_.push_back(track.boneIndex);
+    }
+
+    /**
+     * Конструктор (поза индексируется плоскими индексами скелета, как FlatSkeleton::getLocalTransforms)
+     * @param clip Клип (должен существовать все время работы)
+     * @param skeleton Плоский скелет
+     */
+    AnimationSampler(const AnimationClip& clip, const FlatSkeleton& skeleton):
+            pClip_(&clip),
+            cursors_(clip.getTracks().size() * 3, 0),
+            time_(0.0f)
+    {
+        targets_.reserve(clip.getTracks().size());
+        for(const auto& track : clip.getTracks())
+        {
+            const size_t flatIndex = skeleton.getFlatIndex(track.boneIndex);
+            targets_.push_back(flatIndex < skeleton.getParentIndices().size() ? flatIndex : SIZE_MAX);
+        }
+    }
+
+    /**
+     * Вычислить позу в момент времени
+     * @details Пишутся только кости, у которых есть дорожки
+     * @param time Время (от 0 до длительности клипа)
+     * @param pPose Массив локальных трансформаций
+     */
+    void sample(float time, math::Transform<float>* pPose)
+    {
+        time_ = time;
+
+        const auto& tracks = pClip_->getTracks();
+        for(size_t i = 0; i < tracks.size(); i++)
+        {
+            if(targets_[i] == SIZE_MAX) continue;
+
+            const AnimationClip::Track& track = tracks[i];
+            std::uint32_t* pCursors = cursors_.data() + i * 3;
+
+            math::Transform<float>& transform = pPose[targets_[i]];
+            transform.translation = sampleChannel(track.translationKeys, pCursors[0], time, math::Vec3<float>(0.0f, 0.0f, 0.0f));
+            transform.rotation = sampleChannel(track.rotationKeys, pCursors[1], time, math::Quat<float>());
+            transform.scale = sampleChannel(track.scaleKeys, pCursors[2], time, math::Vec3<float>(1.0f, 1.0f, 1.0f));
+        }
+    }
+
+    /**
+     * Продвинуть время воспроизведения и вычислить позу
+     * @param delta Приращение времени
+     * @param pPose Массив локальных трансформаций
+     * @param loop Зацикливание (иначе время останавливается на конце клипа)
+     */
+    void advance(float delta, math::Transform<float>* pPose, bool loop = true)
+    {
+        const float duration = pClip_->getDuration();
+        float time = time_ + delta;
+
+        if(time > duration){
+            time = (loop && duration > 0.0f) ? std::fmod(time, duration) : duration;
+        }
+
+        sample(time, pPose);
+    }
+
+    /**
+     * Получить текущее время воспроизведения
+     * @return Число с плавающей точкой
+     */
+    float getTime() const
+    {
+        return time_;
+    }
+};
+
+/**
+ * Интерполяция двух поз
+ * @param pPoseA Первая поза
+ * @param pPoseB Вторая поза
+ * @param ratio Коэффициент (0 - первая поза, 1 - вторая)
+ * @param count Кол-во трансформаций в позе
+ * @param pOut Результирующая поза (может совпадать с одной из исходных)
+ */
+inline void LerpPoses(const math::Transform<float>* pPoseA, const math::Transform<float>* pPoseB, float ratio, size_t count, math::Transform<float>* pOut)
+{
+    for(size_t i = 0; i < count; i++) pOut[i] = math::Slerp(pPoseA[i], pPoseB[i], ratio);
+}
+
+/**
+ * Смешивание нескольких поз с весами
+ * @details Перенос и масштаб усредняются с весами, повороты - взвешенная сумма кватернионов (выровненных
+ * по полусфере первой позы) с нормализацией. Веса нормализуются по их сумме
+ * @param ppPoses Массив указателей на позы
+ * @param pWeights Веса поз
+ * @param poseCount Кол-во поз
+ * @param count Кол-во трансформаций в позе
+ * @param pOut Результирующая поза (не должна совпадать с исходными)
+ */
+inline void BlendPoses(const math::Transform<float>* const* ppPoses, const float* pWeights, size_t poseCount, size_t count, math::Transform<float>* pOut)
+{
+    float weightSum = 0.0f;
+    for(size_t p = 0; p < poseCount; p++) weightSum += pWeights[p];
+    if(poseCount == 0 || weightSum <= 0.0f) return;
+    const float weightScale = 1.0f / weightSum;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        const math::Quat<float>& reference = ppPoses[0][i].rotation;
+
+        math::Vec3<float> translation(0.0f, 0.0f, 0.0f);
+        math::Vec3<float> scale(0.0f, 0.0f, 0.0f);
+        math::Quat<float> rotation(0.0f, 0.0f, 0.0f, 0.0f);
+
+        for(size_t p = 0; p < poseCount; p++)
+        {
+            const math::Transform<float>& t = ppPoses[p][i];
+            const float w = pWeights[p] * weightScale;
+            translation = translation + t.translation * w;
+            scale = scale + t.scale * w;
+            rotation = rotation + t.rotation * (math::Dot(reference, t.rotation) < 0.0f ? -w : w);
+        }
+
+        pOut[i].translation = translation;
+        pOut[i].scale = scale;
+        pOut[i].rotation = math::Normalize(rotation);
+    }
+}
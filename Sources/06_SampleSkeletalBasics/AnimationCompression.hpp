@@ -0,0 +1,562 @@
+/**
+ * Сжатые анимационные клипы. Используются для хранения больших библиотек анимаций
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include <Math.hpp>
+
+#include "Animation.hpp"
+
+/**
+ * Сжатый анимационный клип
+ * @details При построении из обычного клипа для каждого канала дорожки:
+ * - каналы, значения которых не выходят за допуск от первого ключа, хранятся одним значением без ключей
+ * - ключи, восстанавливаемые интерполяцией соседних в пределах допуска, удаляются
+ * - повороты квантуются методом "smallest three" (наибольшая по модулю компонента отбрасывается и восстанавливается
+ *   из нормы, остальные три - по 15 бит, индекс отброшенной - 2 бита) - 6 байт на ключ
+ * - перенос и масштаб квантуются по 16 бит на компоненту в пределах диапазона значений канала - 6 байт на ключ
+ * - время ключа квантуется в 16 бит относительно длительности клипа
+ * Погрешность не превышает допуск прореживания плюс шаг квантования (для поворотов ~2.2e-5 на компоненту)
+ */
+class CompressedAnimationClip
+{
+public:
+    /**
+     * Заголовок канала
+     */
+    struct Channel
+    {
+        /// Смещение первого ключа в общих массивах
+        std::uint32_t keyOffset = 0;
+        /// Кол-во ключей (0 - постоянное значение в origin)
+        std::uint32_t keyCount = 0;
+        /// Начало диапазона значений (или постоянное значение, для поворота - кватернион x,y,z,w)
+        float origin[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        /// Размер диапазона значений
+        float extent[3] = {0.0f, 0.0f, 0.0f};
+    };
+
+    /**
+     * Виды каналов
+     */
+    enum ChannelType
+    {
+        eTranslation = 0,
+        eRotation = 1,
+        eScale = 2
+    };
+
+private:
+    /// Длительность клипа
+    float duration_;
+    /// Исходные индексы костей дорожек
+    std::vector<size_t> boneIndices_;
+    /// Заголовки каналов (по 3 на дорожку: перенос, поворот, масштаб)
+    std::vector<Channel> channels_;
+    /// Квантованное время ключей всех каналов
+    std::vector<std::uint16_t> keyTimes_;
+    /// Квантованные значения ключей всех каналов (по 3 на ключ)
+    std::vector<std::uint16_t> keyValues_;
+
+    /**
+     * Максимальное отклонение векторов по компонентам
+     * @param a Первый вектор
+     * @param b Второй вектор
+     * @return Отклонение
+     */
+    static float difference(const math::Vec3<float>& a, const math::Vec3<float>& b)
+    {
+        return std::max(std::fabs(a.x - b.x), std::max(std::fabs(a.y - b.y), std::fabs(a.z - b.z)));
+    }
+
+    /**
+     * Максимальное отклонение кватернионов по компонентам (q и -q - один поворот)
+     * @param a Первый кватернион
+     * @param b Второй кватернион
+     * @return Отклонение
+     */
+    static float difference(const math::Quat<float>& a, const math::Quat<float>& b)
+    {
+        const math::Quat<float> c = math::Dot(a, b) < 0.0f ? -b : b;
+        return std::max(std::max(std::fabs(a.x - c.x), std::fabs(a.y - c.y)), std::max(std::fabs(a.z - c.z), std::fabs(a.w - c.w)));
+    }
+
+    /**
+     * Прореживание ключей
+     * @details Жадный проход: от последнего оставленного ключа отрезок удлиняется, пока все пропущенные ключи
+     * восстанавливаются интерполяцией в пределах допуска
+     * @tparam T Тип значения
+     * @param keys Исходные ключи
+     * @param tolerance Допуск
+     * @return Индексы оставленных ключей
+     */
+    template <typename T>
+    static std::vector<size_t> reduceKeys(const std::vector<AnimationClip::Key<T>>& keys, float tolerance)
+    {
+        std::vector<size_t> kept = {0};
+        if(keys.size() < 2) return kept;
+
+        size_t anchor = 0;
+        for(size_t end = 2; end < keys.size(); end++)
+        {
+            for(size_t j = anchor + 1; j < end; j++)
+            {
+                const float ratio = (keys[j].time - keys[anchor].time) / (keys[end].time - keys[anchor].time);
+                if(difference(interpolate(keys[anchor].value, keys[end].value, ratio), keys[j].value) > tolerance)
+                {
+                    anchor = end - 1;
+                    kept.push_back(anchor);
+                    break;
+                }
+            }
+        }
+
+        kept.push_back(keys.size() - 1);
+        return kept;
+    }
+
+    /**
+     * Квантование числа из диапазона [0, 1] в 16 бит
+     * @param value Значение
+     * @param maxValue Максимальное целое значение
+     * @return Целое число
+     */
+    static std::uint16_t quantize(float value, float maxValue)
+    {
+        return static_cast<std::uint16_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * maxValue));
+    }
+
+    /**
+     * Сжатие канала
+     * @tparam T Тип значения
+     * @param keys Исходные ключи
+     * @param tolerance Допуск прореживания и постоянного значения
+     * @param defaultValue Значение для канала без ключей
+     * @param channel Заголовок канала
+     */
+    template <typename T>
+    void compressChannel(const std::vector<AnimationClip::Key<T>>& keys, float tolerance, const T& defaultValue, Channel& channel)
+    {
+        channel.keyOffset = static_cast<std::uint32_t>(keyTimes_.size());
+        channel.keyCount = 0;
+
+        bool constant = true;
+        for(const auto& key : keys) constant = constant && difference(key.value, keys[0].value) <= tolerance;
+
+        if(keys.empty() || constant){
+            storeConstant(keys.empty() ? defaultValue : keys[0].value, channel);
+            return;
+        }
+
+        const std::vector<size_t> kept = reduceKeys(keys, tolerance);
+        channel.keyCount = static_cast<std::uint32_t>(kept.size());
+        setRange(keys, kept, channel);
+
+        for(size_t index : kept)
+        {
+            keyTimes_.push_back(duration_ > 0.0f ? quantize(keys[index].time / duration_, 65535.0f) : 0);
+            encode(keys[index].value, channel);
+        }
+    }
+
+    /**
+     * Сохранить постоянное значение вектора
+     * @param value Значение
+     * @param channel Заголовок канала
+     */
+    static void storeConstant(const math::Vec3<float>& value, Channel& channel)
+    {
+        channel.origin[0] = value.x;
+        channel.origin[1] = value.y;
+        channel.origin[2] = value.z;
+    }
+
+    /**
+     * Сохранить постоянное значение кватерниона
+     * @param value Значение
+     * @param channel Заголовок канала
+     */
+    static void storeConstant(const math::Quat<float>& value, Channel& channel)
+    {
+        channel.origin[0] = value.x;
+        channel.origin[1] = value.y;
+        channel.origin[2] = value.z;
+        channel.origin[3] = value.w;
+    }
+
+    /**
+     * Вычислить диапазон значений векторного канала
+     * @param keys Исходные ключи
+     * @param kept Индексы оставленных ключей
+     * @param channel Заголовок канала
+     */
+    static void setRange(const std::vector<AnimationClip::Key<math::Vec3<float>>>& keys, const std::vector<size_t>& kept, Channel& channel)
+    {
+        math::Vec3<float> min = keys[kept[0]].value, max = keys[kept[0]].value;
+        for(size_t index : kept)
+        {
+            const math::Vec3<float>& v = keys[index].value;
+            min = {std::min(min.x, v.x), std::min(min.y, v.y), std::min(min.z, v.z)};
+            max = {std::max(max.x, v.x), std::max(max.y, v.y), std::max(max.z, v.z)};
+        }
+
+        storeConstant(min, channel);
+        channel.extent[0] = max.x - min.x;
+        channel.extent[1] = max.y - min.y;
+        channel.extent[2] = max.z - min.z;
+    }
+
+    /**
+     * Диапазон канала поворота не используется (компоненты всегда в [-1/sqrt(2), 1/sqrt(2)])
+     */
+    static void setRange(const std::vector<AnimationClip::Key<math::Quat<float>>>&, const std::vector<size_t>&, Channel&){}
+
+    /**
+     * Квантование вектора в пределах диапазона канала
+     * @param value Значение
+     * @param channel Заголовок канала
+     */
+    void encode(const math::Vec3<float>& value, const Channel& channel)
+    {
+        const float v[3] = {value.x, value.y, value.z};
+        for(unsigned i = 0; i < 3; i++){
+            keyValues_.push_back(channel.extent[i] > 0.0f ? quantize((v[i] - channel.origin[i]) / channel.extent[i], 65535.0f) : 0);
+        }
+    }
+
+    /**
+     * Квантование кватерниона методом "smallest three"
+     * @details Индекс отброшенной компоненты хранится в старших битах первых двух слов
+     * @param value Значение
+     */
+    void encode(const math::Quat<float>& value, const Channel&)
+    {
+        const math::Quat<float> q = math::Normalize(value);
+        float c[4] = {q.x, q.y, q.z, q.w};
+
+        unsigned largest = 0;
+        for(unsigned i = 1; i < 4; i++) if(std::fabs(c[i]) > std::fabs(c[largest])) largest = i;
+
+        // Отброшенная компонента восстанавливается как положительная
+        const float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+        std::uint16_t words[3];
+        for(unsigned i = 0, k = 0; i < 4; i++){
+            if(i != largest) words[k++] = quantize((c[i] * sign * 1.41421356f + 1.0f) * 0.5f, 32767.0f);
+        }
+
+        keyValues_.push_back(static_cast<std::uint16_t>(words[0] | ((largest & 1u) << 15u)));
+        keyValues_.push_back(static_cast<std::uint16_t>(words[1] | ((largest >> 1u) << 15u)));
+        keyValues_.push_back(words[2]);
+    }
+
+public:
+    /**
+     * Интерполяция векторов
+     * @param a Первое значение
+     * @param b Второе значение
+     * @param ratio Коэффициент
+     * @return Вектор
+     */
+    static math::Vec3<float> interpolate(const math::Vec3<float>& a, const math::Vec3<float>& b, float ratio)
+    {
+        return math::Mix(a, b, ratio);
+    }
+
+    /**
+     * Интерполяция кватернионов
+     * @param a Первое значение
+     * @param b Второе значение
+     * @param ratio Коэффициент
+     * @return Кватернион
+     */
+    static math::Quat<float> interpolate(const math::Quat<float>& a, const math::Quat<float>& b, float ratio)
+    {
+        return math::Slerp(a, b, ratio);
+    }
+
+    /**
+     * Сжатие клипа
+     * @param clip Исходный клип
+     * @param translationTolerance Допуск переноса (в единицах пространства)
+     * @param rotationTolerance Допуск поворота (по компонентам кватерниона, 1e-3 - примерно 0.1 градуса)
+     * @param scaleTolerance Допуск масштаба
+     */
+    explicit CompressedAnimationClip(const AnimationClip& clip,
+                                     float translationTolerance = 1e-3f,
+                                     float rotationTolerance = 1e-3f,
+                                     float scaleTolerance = 1e-3f):
+            duration_(clip.getDuration())
+    {
+        const auto& tracks = clip.getTracks();
+        boneIndices_.reserve(tracks.size());
+        channels_.resize(tracks.size() * 3);
+
+        for(size_t i = 0; i < tracks.size(); i++)
+        {
+            boneIndices_.push_back(tracks[i].boneIndex);
+            compressChannel(tracks[i].translationKeys, translationTolerance, math::Vec3<float>(0.0f, 0.0f, 0.0f), channels_[i * 3 + eTranslation]);
+            compressChannel(tracks[i].rotationKeys, rotationTolerance, math::Quat<float>(), channels_[i * 3 + eRotation]);
+            compressChannel(tracks[i].scaleKeys, scaleTolerance, math::Vec3<float>(1.0f, 1.0f, 1.0f), channels_[i * 3 + eScale]);
+        }
+
+        keyTimes_.shrink_to_fit();
+        keyValues_.shrink_to_fit();
+    }
+
+    /**
+     * Получить время ключа
+     * @param channel Заголовок канала
+     * @param key Индекс ключа в канале
+     * @return Время
+     */
+    float getKeyTime(const Channel& channel, std::uint32_t key) const
+    {
+        return static_cast<float>(keyTimes_[channel.keyOffset + key]) * (duration_ / 65535.0f);
+    }
+
+    /**
+     * Восстановить вектор ключа
+     * @param channel Заголовок канала
+     * @param key Индекс ключа в канале (для канала без ключей игнорируется)
+     * @return Вектор
+     */
+    math::Vec3<float> decodeVec3(const Channel& channel, std::uint32_t key) const
+    {
+        if(channel.keyCount == 0) return {channel.origin[0], channel.origin[1], channel.origin[2]};
+
+        const std::uint16_t* w = keyValues_.data() + (channel.keyOffset + key) * 3;
+        const float scale = 1.0f / 65535.0f;
+        return {
+                channel.origin[0] + static_cast<float>(w[0]) * scale * channel.extent[0],
+                channel.origin[1] + static_cast<float>(w[1]) * scale * channel.extent[1],
+                channel.origin[2] + static_cast<float>(w[2]) * scale * channel.extent[2]};
+    }
+
+    /**
+     * Восстановить кватернион ключа
+     * @param channel Заголовок канала
+     * @param key Индекс ключа в канале (для канала без ключей игнорируется)
+     * @return Кватернион
+     */
+    math::Quat<float> decodeQuat(const Channel& channel, std::uint32_t key) const
+    {
+        if(channel.keyCount == 0) return {channel.origin[0], channel.origin[1], channel.origin[2], channel.origin[3]};
+
+        const std::uint16_t* w = keyValues_.data() + (channel.keyOffset + key) * 3;
+        const unsigned largest = (w[0] >> 15u) | ((w[1] >> 15u) << 1u);
+        const float scale = 1.41421356f / 32767.0f;
+        const float bias = 0.70710678f;
+
+        float c[4];
+        float sumSq = 0.0f;
+        for(unsigned i = 0, k = 0; i < 4; i++)
+        {
+            if(i == largest) continue;
+            c[i] = static_cast<float>(w[k++] & 0x7FFFu) * scale - bias;
+            sumSq += c[i] * c[i];
+        }
+        c[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSq));
+
+        return {c[0], c[1], c[2], c[3]};
+    }
+
+    /**
+     * Получить заголовок канала
+     * @param track Индекс дорожки
+     * @param type Вид канала
+     * @return Ссылка на заголовок
+     */
+    const Channel& getChannel(size_t track, ChannelType type) const
+    {
+        return channels_[track * 3 + type];
+    }
+
+    /**
+     * Получить исходные индексы костей дорожек
+     * @return Ссылка на массив индексов
+     */
+    const std::vector<size_t>& getBoneIndices() const
+    {
+        return boneIndices_;
+    }
+
+    /**
+     * Получить длительность клипа
+     * @return Число с плавающей точкой
+     */
+    float getDuration() const
+    {
+        return duration_;
+    }
+
+    /**
+     * Получить объем памяти, занимаемой данными клипа
+     * @return Кол-во байт
+     */
+    size_t getMemorySize() const
+    {
+        return boneIndices_.size() * sizeof(size_t) +
+               channels_.size() * sizeof(Channel) +
+               keyTimes_.size() * sizeof(std::uint16_t) +
+               keyValues_.size() * sizeof(std::uint16_t);
+    }
+};
+
+/**
+ * Воспроизведение сжатого анимационного клипа
+ * @details Работает так же, как AnimationSampler (курсоры каналов, запись в массив позы), но восстанавливает
+ * только два ключа каждого канала, нужных в момент времени, не распаковывая клип целиком
+ */
+class CompressedAnimationSampler
+{
+private:
+    /// Клип
+    const CompressedAnimationClip* pClip_;
+    /// Индекс в массиве позы для каждой дорожки (SIZE_MAX - дорожка не используется)
+    std::vector<size_t> targets_;
+    /// Курсоры каналов (по 3 на дорожку: перенос, поворот, масштаб)
+    std::vector<std::uint32_t> cursors_;
+    /// Текущее время воспроизведения
+    float time_;
+
+    /**
+     * Найти отрезок ключей канала для момента времени
+     * @param channel Заголовок канала
+     * @param cursor Курсор канала (обновляется)
+     * @param time Время
+     * @return Коэффициент интерполяции между ключами cursor и cursor + 1 (0 - значение ключа cursor)
+     */
+    float seek(const CompressedAnimationClip::Channel& channel, std::uint32_t& cursor, float time) const
+    {
+        const std::uint32_t count = channel.keyCount;
+        if(count <= 1 || time <= pClip_->getKeyTime(channel, 0)){
+            cursor = 0;
+            return 0.0f;
+        }
+
+        // Время ушло назад - поиск с начала
+        if(cursor >= count || pClip_->getKeyTime(channel, cursor) > time) cursor = 0;
+        while(cursor + 1 < count && pClip_->getKeyTime(channel, cursor + 1) <= time) cursor++;
+
+        if(cursor + 1 == count) return 0.0f;
+
+        const float t0 = pClip_->getKeyTime(channel, cursor);
+        const float t1 = pClip_->getKeyTime(channel, cursor + 1);
+        return (time - t0) / (t1 - t0);
+    }
+
+    /**
+     * Получить вектор канала в момент времени
+     * @param channel Заголовок канала
+     * @param cursor Курсор канала (обновляется)
+     * @param time Время
+     * @return Вектор
+     */
+    math::Vec3<float> sampleVec3(const CompressedAnimationClip::Channel& channel, std::uint32_t& cursor, float time) const
+    {
+        const float ratio = seek(channel, cursor, time);
+        const math::Vec3<float> a = pClip_->decodeVec3(channel, cursor);
+        return ratio > 0.0f ? math::Mix(a, pClip_->decodeVec3(channel, cursor + 1), ratio) : a;
+    }
+
+    /**
+     * Получить кватернион канала в момент времени
+     * @param channel Заголовок канала
+     * @param cursor Курсор канала (обновляется)
+     * @param time Время
+     * @return Кватернион
+     */
+    math::Quat<float> sampleQuat(const CompressedAnimationClip::Channel& channel, std::uint32_t& cursor, float time) const
+    {
+        const float ratio = seek(channel, cursor, time);
+        const math::Quat<float> a = pClip_->decodeQuat(channel, cursor);
+        return ratio > 0.0f ? math::Slerp(a, pClip_->decodeQuat(channel, cursor + 1), ratio) : a;
+    }
+
+public:
+    /**
+     * Конструктор (поза индексируется исходными индексами костей)
+     * @param clip Клип (должен существовать все время работы)
+     */
+    explicit CompressedAnimationSampler(const CompressedAnimationClip& clip):
+            pClip_(&clip),
+            targets_(clip.getBoneIndices()),
+            cursors_(clip.getBoneIndices().size() * 3, 0),
+            time_(0.0f)
+    {}
+
+    /**
+     * Конструктор (поза индексируется плоскими индексами скелета, как FlatSkeleton::getLocalTransforms)
+     * @param clip Клип (должен существовать все время работы)
+     * @param skeleton Плоский скелет
+     */
+    CompressedAnimationSampler(const CompressedAnimationClip& clip, const FlatSkeleton& skeleton):
+            pClip_(&clip),
+            cursors_(clip.getBoneIndices().size() * 3, 0),
+            time_(0.0f)
+    {
+        targets_.reserve(clip.getBoneIndices().size());
+        for(size_t boneIndex : clip.getBoneIndices())
+        {
+            const size_t flatIndex = skeleton.getFlatIndex(boneIndex);
+            targets_.push_back(flatIndex < skeleton.getParentIndices().size() ? flatIndex : SIZE_MAX);
+        }
+    }
+
+    /**
+     * Вычислить позу в момент времени
+     * @details Пишутся только кости, у которых есть дорожки
+     * @param time Время (от 0 до длительности клипа)
+     * @param pPose Массив локальных трансформаций
+     */
+    void sample(float time, math::Transform<float>* pPose)
+    {
+        time_ = time;
+
+        for(size_t i = 0; i < targets_.size(); i++)
+        {
+            if(targets_[i] == SIZE_MAX) continue;
+
+            std::uint32_t* pCursors = cursors_.data() + i * 3;
+            math::Transform<float>& transform = pPose[targets_[i]];
+            transform.translation = sampleVec3(pClip_->getChannel(i, CompressedAnimationClip::eTranslation), pCursors[0], time);
+            transform.rotation = sampleQuat(pClip_->getChannel(i, CompressedAnimationClip::eRotation), pCursors[1], time);
+            transform.scale = sampleVec3(pClip_->getChannel(i, CompressedAnimationClip::eScale), pCursors[2], time);
+        }
+    }
+
+    /**
+     * Продвинуть время воспроизведения и вычислить позу
+     * @param delta Приращение времени
+     * @param pPose Массив локальных трансформаций
+     * @param loop Зацикливание (иначе время останавливается на конце клипа)
+     */
+    void advance(float delta, math::Transform<float>* pPose, bool loop = true)
+    {
+        const float duration = pClip_->getDuration();
+        float time = time_ + delta;
+
+        if(time > duration){
+            time = (loop && duration > 0.0f) ? std::fmod(time, duration) : duration;
+        }
+
+        sample(time, pPose);
+    }
+
+    /**
+     * Получить текущее время воспроизведения
+     * @return Число с плавающей точкой
+     */
+    float getTime() const
+    {
+        return time_;
+    }
+};
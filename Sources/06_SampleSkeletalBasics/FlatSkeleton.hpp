@@ -0,0 +1,331 @@
+/**
+ * Класс скелета в "плоском" представлении. Используется для быстрого вычисления поз больших скелетов
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+#include <Math.hpp>
+
+#include "Skeleton.hpp"
+
+/**
+ * Плоский скелет
+ * @details Кости хранятся в непрерывных массивах (отдельный массив на каждый вид трансформаций) в порядке
+ * "родитель перед потомком", поэтому поза вычисляется одним линейным проходом без рекурсии и обхода указателей.
+ * Индексы костей снаружи (в setLocalTransform и массивах итоговых трансформаций) - те же, что у исходного скелета
+ */
+class FlatSkeleton
+{
+private:
+    /// Индексы родительских костей в плоском порядке (-1 для корневых)
+    std::vector<std::int32_t> parentIndices_;
+    /// Исходный индекс кости для каждого плоского индекса
+    std::vector<size_t> boneIndices_;
+    /// Плоский индекс для каждого исходного индекса кости
+    std::vector<size_t> flatIndices_;
+
+    /// Смещения костей относительно родителя (initial-положения)
+    std::vector<math::Transform<float>> localBindTransforms_;
+    /// Локальные (анимируемые) трансформации
+    std::vector<math::Transform<float>> localTransforms_;
+    /// Результирующие трансформации костей с учетом родительских
+    std::vector<math::Transform<float>> totalTransforms_;
+    /// Инвертированные результирующие bind-матрицы (вычисляются один раз при построении)
+    std::vector<math::Mat4<float>> totalBindTransformsInverse_;
+    /// Инвертированные результирующие bind-трансформации в виде дуальных кватернионов (вычисляются один раз при построении)
+    std::vector<math::DualQuat<float>> totalBindDualQuatsInverse_;
+
+    /// Массив итоговых трансформаций для вершин в пространстве модели (по исходным индексам)
+    std::vector<math::Mat4<float>> modelSpaceFinalTransforms_;
+    /// Массив итоговых трансформаций для вершин в пространстве модели в виде дуальных кватернионов (по исходным индексам, пуст, если не включен)
+    std::vector<math::DualQuat<float>> modelSpaceFinalDualQuats_;
+    /// Массив итоговых трансформаций для вершин в пространстве костей (по исходным индексам)
+    std::vector<math::Mat4<float>> boneSpaceFinalTransforms_;
+    /// Матрица глобальной инверсии
+    math::Mat4<float> globalInverseTransform_;
+    /// Матрица глобальной инверсии в виде дуального кватерниона
+    math::DualQuat<float> globalInverseDualQuat_;
+
+    /**
+     * Упорядочить кости так, чтобы родитель всегда шел перед потомками (обход в ширину)
+     * @param parents Индексы родительских костей (по исходным индексам, -1 для корневых)
+     * @details Кости, не достижимые от корневых (например при циклических ссылках), не попадают в плоский массив
+     */
+    void buildOrder(const std::vector<std::int32_t>& parents)
+    {
+        const size_t count = parents.size();
+
+        // Дочерние кости в виде смещений в общем массиве (подсчет, затем распределение)
+        std::vector<size_t> childrenOffsets(count + 1, 0);
+        for(size_t i = 0; i < count; i++){
+            if(parents[i] >= 0 && static_cast<size_t>(parents[i]) < count) childrenOffsets[parents[i] + 1]++;
+        }
+        for(size_t i = 0; i < count; i++) childrenOffsets[i + 1] += childrenOffsets[i];
+
+        std::vector<size_t> children(childrenOffsets[count]);
+        std::vector<size_t> fill(childrenOffsets.begin(), childrenOffsets.end() - 1);
+        for(size_t i = 0; i < count; i++){
+            if(parents[i] >= 0 && static_cast<size_t>(parents[i]) < count) children[fill[parents[i]]++] = i;
+        }
+
+        // Корневые кости, затем потомки уже добавленных костей
+        boneIndices_.clear();
+        boneIndices_.reserve(count);
+        for(size_t i = 0; i < count; i++){
+            if(parents[i] < 0 || static_cast<size_t>(parents[i]) >= count) boneIndices_.push_back(i);
+        }
+        for(size_t i = 0; i < boneIndices_.size(); i++){
+            const size_t bone = boneIndices_[i];
+            for(size_t c = childrenOffsets[bone]; c < childrenOffsets[bone + 1]; c++) boneIndices_.push_back(children[c]);
+        }
+
+        flatIndices_.assign(count, count);
+        for(size_t i = 0; i < boneIndices_.size(); i++) flatIndices_[boneIndices_[i]] = i;
+
+        parentIndices_.resize(boneIndices_.size());
+        for(size_t i = 0; i < boneIndices_.size(); i++){
+            const std::int32_t parent = parents[boneIndices_[i]];
+            parentIndices_[i] = (parent >= 0 && static_cast<size_t>(parent) < count) ? static_cast<std::int32_t>(flatIndices_[parent]) : -1;
+        }
+    }
+
+    /**
+     * Вычисление инвертированных bind-матриц (один линейный проход)
+     * @details Как и в Skeleton, неравномерный масштаб в bind-трансформациях допустим только у костей без потомков
+     */
+    void calculateBindPose()
+    {
+        std::vector<math::Transform<float>> totalBind(localBindTransforms_.size());
+        for(size_t i = 0; i < localBindTransforms_.size(); i++)
+        {
+            assert((parentIndices_[i] < 0 || totalBind[parentIndices_[i]].hasUniformScale()) && "Non-uniform bind scale is only allowed on leaf bones");
+            totalBind[i] = parentIndices_[i] < 0 ? localBindTransforms_[i] : totalBind[parentIndices_[i]] * localBindTransforms_[i];
+            totalBindTransformsInverse_[i] = math::InverseAffine(totalBind[i].toMat4());
+            totalBindDualQuatsInverse_[i] = math::Conjugate(math::DualQuat<float>(totalBind[i]));
+        }
+    }
+
+    /**
+     * Выделение памяти под массивы трансформаций
+     * @param boneTotalCount Общее кол-во костей (размер массивов итоговых трансформаций)
+     */
+    void allocate(size_t boneTotalCount)
+    {
+        const size_t flatCount = boneIndices_.size();
+        localBindTransforms_.resize(flatCount);
+        localTransforms_.resize(flatCount);
+        totalTransforms_.resize(flatCount);
+        totalBindTransformsInverse_.resize(flatCount, math::Mat4<float>(1.0f));
+        totalBindDualQuatsInverse_.resize(flatCount);
+        modelSpaceFinalTransforms_.resize(boneTotalCount, math::Mat4<float>(1.0f));
+        boneSpaceFinalTransforms_.resize(boneTotalCount, math::Mat4<float>(1.0f));
+    }
+
+public:
+    /**
+     * Построение по иерархическому скелету
+     * @param skeleton Исходный скелет (копируются иерархия, bind и локальные трансформации)
+     */
+    explicit FlatSkeleton(const Skeleton& skeleton):
+            globalInverseTransform_(skeleton.getGlobalInverseTransform()),
+            globalInverseDualQuat_(skeleton.getGlobalInverseTransform())
+    {
+        const size_t count = skeleton.getBonesCount();
+
+        std::vector<std::int32_t> parents(count);
+        for(size_t i = 0; i < count; i++) parents[i] = skeleton.getParentIndex(i);
+
+        buildOrder(parents);
+        allocate(count);
+
+        for(size_t i = 0; i < boneIndices_.size(); i++)
+        {
+            localBindTransforms_[i] = skeleton.getLocalBindTransform(boneIndices_[i]);
+            localTransforms_[i] = skeleton.getLocalTransform(boneIndices_[i]);
+        }
+
+        calculateBindPose();
+        update();
+    }
+
+    /**
+     * Построение по массиву индексов родительских костей
+     * @param parents Индексы родительских костей (-1 для корневых), порядок костей произвольный
+     * @param localBindTransforms Смещения костей относительно родителя (в том же порядке)
+     * @param globalInverseTransform Матрица глобальной инверсии
+     */
+    FlatSkeleton(const std::vector<std::int32_t>& parents,
+                 const std::vector<math::Transform<float>>& localBindTransforms,
+                 const math::Mat4<float>& globalInverseTransform = math::Mat4<float>(1.0f)):
+            globalInverseTransform_(globalInverseTransform),
+            globalInverseDualQuat_(globalInverseTransform)
+    {
+        buildOrder(parents);
+        allocate(parents.size());
+
+        for(size_t i = 0; i < boneIndices_.size(); i++){
+            if(boneIndices_[i] < localBindTransforms.size()) localBindTransforms_[i] = localBindTransforms[boneIndices_[i]];
+        }
+
+        calculateBindPose();
+        update();
+    }
+
+    /**
+     * Вычисление позы (итоговых трансформаций всех костей) одним линейным проходом
+     * @details Родитель всегда обработан раньше потомка, поэтому его результирующая трансформация уже готова
+     */
+    void update()
+    {
+        const size_t count = boneIndices_.size();
+        for(size_t i = 0; i < count; i++)
+        {
+            const math::Transform<float> local = localBindTransforms_[i] * localTransforms_[i];
+            totalTransforms_[i] = parentIndices_[i] < 0 ? local : totalTransforms_[parentIndices_[i]] * local;
+
+            const size_t bone = boneIndices_[i];
+            boneSpaceFinalTransforms_[bone] = globalInverseTransform_ * totalTransforms_[i].toMat4();
+            modelSpaceFinalTransforms_[bone] = boneSpaceFinalTransforms_[bone] * totalBindTransformsInverse_[i];
+        }
+
+        // Дуальные кватернионы - отдельным проходом и только если включены (строятся из TRS, без разложения матриц)
+        if(!modelSpaceFinalDualQuats_.empty()){
+            for(size_t i = 0; i < count; i++){
+                modelSpaceFinalDualQuats_[boneIndices_[i]] = globalInverseDualQuat_ * math::DualQuat<float>(totalTransforms_[i]) * totalBindDualQuatsInverse_[i];
+            }
+        }
+    }
+
+    /**
+     * Включить или отключить вычисление итоговых трансформаций в виде дуальных кватернионов
+     * @details По умолчанию отключено - скиннинг матрицами не тратит на них время и память.
+     * Включенные дуальные кватернионы вычисляются при следующем вызове update
+     * @param enabled Вычислять ли дуальные кватернионы
+     */
+    void setDualQuatsEnabled(bool enabled)
+    {
+        if(enabled) modelSpaceFinalDualQuats_.resize(modelSpaceFinalTransforms_.size());
+        else{
+            modelSpaceFinalDualQuats_.clear();
+            modelSpaceFinalDualQuats_.shrink_to_fit();
+        }
+    }
+
+    /**
+     * Установить локальную (анимируемую) трансформацию кости (поза пересчитывается при вызове update)
+     * @param boneIndex Исходный индекс кости
+     * @param transform Трансформация (перенос, поворот, масштаб)
+     */
+    void setLocalTransform(size_t boneIndex, const math::Transform<float>& transform)
+    {
+        if(boneIndex < flatIndices_.size() && flatIndices_[boneIndex] < localTransforms_.size())
+            localTransforms_[flatIndices_[boneIndex]] = transform;
+    }
+
+    /**
+     * Получить массив итоговых трансформаций костей
+     * @param fromBoneSpace Если точки заданы в пространстве кости
+     * @return Ссылка на массив матриц (по исходным индексам костей)
+     */
+    const std::vector<math::Mat4<float>>& getFinalBoneTransforms(bool fromBoneSpace = false) const
+    {
+        return fromBoneSpace ? boneSpaceFinalTransforms_ : modelSpaceFinalTransforms_;
+    }
+
+    /**
+     * Получить массив итоговых трансформаций костей в виде дуальных кватернионов
+     * @return Ссылка на массив дуальных кватернионов (по исходным индексам костей, для точек в пространстве модели,
+     * пуст без setDualQuatsEnabled)
+     */
+    const std::vector<math::DualQuat<float>>& getFinalBoneDualQuats() const
+    {
+        return modelSpaceFinalDualQuats_;
+    }
+
+    /**
+     * Получить общее кол-во костей
+     * @return Целое положительное число
+     */
+    size_t getBonesCount() const
+    {
+        return modelSpaceFinalTransforms_.size();
+    }
+
+    /**
+     * Получить плоский индекс кости (позиция в массивах локальных трансформаций)
+     * @param boneIndex Исходный индекс кости
+     * @return Плоский индекс (равен getBonesCount() для костей вне иерархии)
+     */
+    size_t getFlatIndex(size_t boneIndex) const
+    {
+        return boneIndex < flatIndices_.size() ? flatIndices_[boneIndex] : flatIndices_.size();
+    }
+
+    /**
+     * Получить массив индексов родительских костей в плоском порядке
+     * @return Ссылка на массив индексов (-1 для корневых)
+     */
+    const std::vector<std::int32_t>& getParentIndices() const
+    {
+        return parentIndices_;
+    }
+
+    /**
+     * Получить массив исходных индексов костей в плоском порядке
+     * @return Ссылка на массив индексов
+     */
+    const std::vector<size_t>& getBoneIndices() const
+    {
+        return boneIndices_;
+    }
+
+    /**
+     * Получить массив смещений костей относительно родителя в плоском порядке
+     * @return Ссылка на массив трансформаций
+     */
+    const std::vector<math::Transform<float>>& getLocalBindTransforms() const
+    {
+        return localBindTransforms_;
+    }
+
+    /**
+     * Получить массив инвертированных результирующих bind-матриц в плоском порядке
+     * @return Ссылка на массив матриц
+     */
+    const std::vector<math::Mat4<float>>& getBindTransformsInverse() const
+    {
+        return totalBindTransformsInverse_;
+    }
+
+    /**
+     * Получить матрицу глобальной инверсии
+     * @return Ссылка на матрицу
+     */
+    const math::Mat4<float>& getGlobalInverseTransform() const
+    {
+        return globalInverseTransform_;
+    }
+
+    /**
+     * Получить массив локальных (анимируемых) трансформаций в плоском порядке
+     * @return Ссылка на массив трансформаций
+     */
+    std::vector<math::Transform<float>>& getLocalTransforms()
+    {
+        return localTransforms_;
+    }
+
+    /**
+     * Получить массив локальных (анимируемых) трансформаций в плоском порядке
+     * @return Константная ссылка на массив трансформаций
+     */
+    const std::vector<math::Transform<float>>& getLocalTransforms() const
+    {
+        return localTransforms_;
+    }
+};
@@ -7,6 +7,8 @@
 #include <Timer.hpp>
 
 #include "Skeleton.hpp"
+#include "Skinning.hpp"
+#include "Animation.hpp"
 
 
 /**
@@ -53,19 +55,6 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM
  */
 void PresentFrame(void *pixels, int width, int height, HWND hWnd);
 
-/**
- * Простое описание вершины
- * В отличии от реальных примеров, здесь отсутствуют веса и вершина может принадлежать только одной кости
- */
-struct Vertex
-{
-    /// Положение в пространстве
-    math::Vec3<float> position;
-
-    /// Индек кости, к которой привязана вершины
-    size_t boneId = 0;
-};
-
 /**
  * Точка входа
  * @param argc Кол-во аргументов
@@ -136,41 +125,54 @@ int main(int argc, char* argv[])
 
         /// И Н И Ц И А Л И З А Ц И Я  С Ц Е Н Ы
 
-        // Текущий угол поворота
-        float rotationAngle = 0.0f;
-
-        // Скорость вращения
-        float angleSpeed = 0.03f;
-
         // Матрица проекции
         math::Mat4<float> mProjection = math::GetProjectionMatOrthogonal(-8.0f,8.0f,-8.0f,8.0f,0.1f,100.0f,aspectRatio);
 
-        // Набор вершин
-        std::vector<Vertex> vertices = {
+        // Набор вершин (в данном примере каждая вершина полностью принадлежит одной кости)
+        std::vector<SkinVertex> vertices = {
                 // Первый квдрат принадлежит корневой кости
-                {{-1.0f,-1.0f,0.0f},0},
-                {{-1.0f,1.0f,0.0f},0},
-                {{1.0f,1.0f,0.0f},0},
-                {{1.0f,-1.0f,0.0f},0},
+                {{-1.0f,-1.0f,0.0f},{0.0f,0.0f,1.0f},{0},{1.0f}},
+                {{-1.0f,1.0f,0.0f},{0.0f,0.0f,1.0f},{0},{1.0f}},
+                {{1.0f,1.0f,0.0f},{0.0f,0.0f,1.0f},{0},{1.0f}},
+                {{1.0f,-1.0f,0.0f},{0.0f,0.0f,1.0f},{0},{1.0f}},
 
                 // 2-й квадрат принадлежит кости 1
-                {{-1.0f,1.5f,0.0f},1},
-                {{-1.0f,3.5f,0.0f},1},
-                {{1.0f,3.5f,0.0f},1},
-                {{1.0f,1.5f,0.0f},1},
+                {{-1.0f,1.5f,0.0f},{0.0f,0.0f,1.0f},{1},{1.0f}},
+                {{-1.0f,3.5f,0.0f},{0.0f,0.0f,1.0f},{1},{1.0f}},
+                {{1.0f,3.5f,0.0f},{0.0f,0.0f,1.0f},{1},{1.0f}},
+                {{1.0f,1.5f,0.0f},{0.0f,0.0f,1.0f},{1},{1.0f}},
 
                 // 3-й квадрат принадлежит кости 2
-                {{-1.0f,4.0f,0.0f},2},
-                {{-1.0f,6.0f,0.0f},2},
-                {{1.0f,6.0f,0.0f},2},
-                {{1.0f,4.0f,0.0f},2},
+                {{-1.0f,4.0f,0.0f},{0.0f,0.0f,1.0f},{2},{1.0f}},
+                {{-1.0f,6.0f,0.0f},{0.0f,0.0f,1.0f},{2},{1.0f}},
+                {{1.0f,6.0f,0.0f},{0.0f,0.0f,1.0f},{2},{1.0f}},
+                {{1.0f,4.0f,0.0f},{0.0f,0.0f,1.0f},{2},{1.0f}},
         };
 
-        // Инициализация скелета (скелет из 3 суставов/костей)
-        Skeleton skeleton(3);
-        skeleton.getRootBone()
-        ->addChildBone(1,math::GetTranslationMat4({0.0f,2.5f,0.0f}))
-        ->addChildBone(2,math::GetTranslationMat4({0.0f,2.5f,0.0f}));
+        // Вершины после скиннинга (буфер выделяется один раз)
+        std::vector<SkinnedVertex> skinnedVertices(vertices.size());
+
+        // Скиннинг вершин по матрицам костей
+        Skinner skinner;
+
+        // Инициализация скелета (скелет из 3 суставов/костей, каждая следующая кость - потомок предыдущей)
+        Skeleton skeleton(
+                {-1, 0, 1},
+                {math::Transform<float>(), math::Transform<float>({0.0f,2.5f,0.0f}), math::Transform<float>({0.0f,2.5f,0.0f})});
+
+        // Анимационный клип: равномерный поворот всех суставов вокруг оси Z (полный оборот за 12 секунд)
+        AnimationClip clip(12000.0f);
+        for(size_t boneIndex = 0; boneIndex < skeleton.getBonesCount(); boneIndex++)
+        {
+            auto& track = clip.addTrack(boneIndex);
+            for(unsigned k = 0; k <= 3; k++){
+                track.rotationKeys.push_back({static_cast<float>(k) * 4000.0f, math::GetQuatFromAxisAngle<float>({0.0f,0.0f,1.0f},static_cast<float>(k) * 120.0f)});
+            }
+        }
+
+        // Воспроизведение клипа и поза скелета (локальные трансформации по индексам костей)
+        AnimationSampler sampler(clip);
+        std::vector<math::Transform<float>> pose(skeleton.getBonesCount());
 
 
         /** MAIN LOOP **/
@@ -205,13 +207,14 @@ int main(int argc, char* argv[])
 
             /// А Н И М А Ц И Я
 
-            // Приращение угла поворота
-            rotationAngle += (angleSpeed * g_pTimer->getDelta());
+            // Вычисление позы по клипу
+            sampler.advance(g_pTimer->getDelta(), pose.data());
 
             // Повороты суставов скелета
-            skeleton.getRootBone()->setLocalTransform(math::GetRotationMat4({0.0f,0.0f,rotationAngle}));
-            skeleton.getRootBone()->getChildrenBones().back()->setLocalTransform(math::GetRotationMat4({0.0f,0.0f,rotationAngle}));
-            skeleton.getRootBone()->getChildrenBones().back()->getChildrenBones().back()->setLocalTransform(math::GetRotationMat4({0.0f,0.0f,rotationAngle}));
+            for(size_t i = 0; i < pose.size(); i++) skeleton.getBoneByIndex(i)->setLocalTransform(pose[i]);
+
+            // Пересчет матриц скелета (один раз за кадр, каждая кость вычисляется один раз)
+            skeleton.update();
 
             /// D R A W
 
@@ -221,11 +224,14 @@ int main(int argc, char* argv[])
             // Дополнительные точки (для отметки костей)
             std::vector<math::Vec2<float>> bonesPointsTransformed;
 
-            // Трансформация вершин
-            // В данном цикле проходим по вершинам и применям к ним трансформации соответствующих костей
-            for(const auto& v : vertices)
+            // Скиннинг вершин (смешивание матриц костей с учетом весов)
+            skinner.setBoneTransforms(skeleton.getFinalBoneTransforms());
+            skinner.skin(vertices.data(), vertices.size(), skinnedVertices.data());
+
+            // Проекция вершин после скиннинга
+            for(const auto& v : skinnedVertices)
             {
-                auto vt = mProjection * skeleton.getFinalBoneTransforms()[v.boneId] * math::Vec4<float>({v.position.x,v.position.y,v.position.z,1.0f});
+                auto vt = mProjection * math::Vec4<float>({v.position.x,v.position.y,v.position.z,1.0f});
                 pointsTransformed.emplace_back(vt.x,vt.y);
             }
 
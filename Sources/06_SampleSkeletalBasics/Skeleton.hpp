@@ -6,244 +6,198 @@
 #pragma once
 
 #include <vector>
-#include <functional>
 #include <memory>
+#include <cstdint>
+#include <cassert>
+#include <type_traits>
 
 #include <Math.hpp>
 
 /**
  * Класс скелета
+ * @details Данные всех костей хранятся в одном непрерывном массиве (индекс кости - позиция в массиве), связи между
+ * костями задаются индексами. Построение скелета требует фиксированного кол-ва выделений памяти, а копирование
+ * скелета сводится к побайтовому копированию массивов.
+ * Трансформации костей компонуются в виде TRS, поэтому неравномерный масштаб в bind-трансформациях допустим только
+ * у костей без потомков (для остальных композиция не представима в виде TRS, что проверяется assert)
  */
 class Skeleton
 {
 public:
+    /**
+     * Флаги вычисления матриц
+     */
+    enum CalcFlags
+    {
+        eNone = (0),
+        eFullTransform = (1u << 0u),
+        eBindTransform = (1u << 1u),
+        eInverseBindTransform = (1u << 2u),
+        eFinalTransform = (1u << 3u),
+    };
 
     /**
-     * Класс кости скелета (внутренний класс скелета)
+     * Кость скелета (легковесная ссылка на данные кости в массиве скелета)
+     * @details Ведет себя как указатель (поддерживает ->, проверку на пустоту), но хранит только скелет и индекс,
+     * поэтому не требует выделения памяти и подсчета ссылок. Действительна, пока существует скелет
      */
     class Bone
     {
-    public:
-        /// Флаги вычисления матриц
-        enum CalcFlags
-        {
-            eNone = (0),
-            eFullTransform = (1u << 0u),
-            eBindTransform = (1u << 1u),
-            eInverseBindTransform = (1u << 2u),
-        };
-
     private:
-        /// Открыть доступ для дружественных классов
-        friend class Skeleton;
-
         /// Указатель на скелет
         Skeleton* pSkeleton_;
-        /// Индекс кости в линейном массиве
+        /// Индекс кости в массиве
         size_t index_;
 
-        /// Указатель на родительскую кость
-        Skeleton::Bone* pParentBone_;
-        /// Массив указателей на дочерние кости
-        std::vector<std::shared_ptr<Skeleton::Bone>> childrenBones_;
-
-        /// Смещение (расположение) относительно родительской кости (можно считать это initial-положением)
-        math::Mat4<float> localBindTransform_;
-        /// Локальная трансформация относительно bind (та трансформация, которая может назначаться во время анимации)
-        math::Mat4<float> localTransform_;
-
-        /// Результирующая трансформация кости с учетом локальной трансформации и результирующий трансформаций родительских костей
-        /// Данная трансформация может быть применена к точкам находящимся В ПРОСТРАНСТВЕ КОСТИ
-        math::Mat4<float> totalTransform_;
-        /// Результирующая трансформация кости БЕЗ учета задаваемой, но с учетом bind-трансформаций родительских костей
-        math::Mat4<float> totalBindTransform_;
-        /// Инвертированная bind матрица может быть использована для перехода в пространство кости ИЗ ПРОСТРАНСТВА МОДЕЛИ
-        math::Mat4<float> totalBindTransformInverse_;
-
+    public:
         /**
-         * Рекурсивное вычисление матриц для текущей кости и всех дочерних её костей
-         * @param callUpdateCallbackFunction Вызывать функцию обратного вызова установленную к скелета
-         * @param calcFlags Опции вычисления матриц (какие матрицы считать)
+         * Конструктор
+         * @param pSkeleton Указатель на объект скелета (nullptr - пустая ссылка)
+         * @param index Индекс кости
          */
-        void calculateBranch(unsigned calcFlags = CalcFlags::eFullTransform | CalcFlags::eBindTransform | CalcFlags::eInverseBindTransform)
-        {
-            // Если у кости есть родительская кость
-            if(pParentBone_ != nullptr)
-            {
-                // Общая initial (bind) трансформация для кости учитывает текущую и родительскую (что в свою очередь справедливо и для родительской)
-                if(calcFlags & CalcFlags::eBindTransform)
-                    totalBindTransform_ = pParentBone_->totalBindTransform_ * this->localBindTransform_;
-
-                // Общая полная (с учетом задаваемой) трансформация кости (смещаем на localTransform_, затем на initial, затем на общую родительскую трансформацию)
-                if(calcFlags & CalcFlags::eFullTransform)
-                    totalTransform_ = pParentBone_->totalTransform_ * this->localBindTransform_ * this->localTransform_;
-            }
-                // Если нет родительской кости - считать кость корневой
-            else
-            {
-                if(calcFlags & CalcFlags::eBindTransform)
-                    totalBindTransform_ = this->localBindTransform_;
-
-                if(calcFlags & CalcFlags::eFullTransform)
-                    totalTransform_ = this->localBindTransform_ * this->localTransform_;
-            }
-
-            // Инвертированная матрица bind трансформации
-            if(calcFlags & CalcFlags::eInverseBindTransform)
-                totalBindTransformInverse_ = math::Inverse(totalBindTransform_);
-
-            // Если есть указатель на объект скелета и индекс корректный
-            if(pSkeleton_ != nullptr && index_ < pSkeleton_->modelSpaceFinalTransforms_.size())
-            {
-                // Итоговая матрица трансформации для точек находящихся в пространстве модели
-                // Поскольку общая трансформация кости работает с вершинами находящимися в пространстве модели,
-                // они в начале должны быть переведены в пространство кости.
-                pSkeleton_->modelSpaceFinalTransforms_[index_] = pSkeleton_->globalInverseTransform_ * totalTransform_ * totalBindTransformInverse_;
-
-                // Для ситуаций, если вершины задаются сразу в пространстве кости
-                pSkeleton_->boneSpaceFinalTransforms_[index_] = pSkeleton_->globalInverseTransform_ * totalTransform_;
-            }
-
-            // Рекурсивно выполнить для дочерних элементов (если они есть)
-            if(!this->childrenBones_.empty()){
-                for(auto& childBone : this->childrenBones_){
-                    childBone->calculateBranch(calcFlags);
-                }
-            }
-        }
+        explicit Bone(Skeleton* pSkeleton = nullptr, size_t index = 0):
+                pSkeleton_(pSkeleton),
+                index_(index){}
 
-    public:
         /**
-         * Конструктор по умолчанию
+         * Доступ к методам кости в стиле указателя
+         * @return Указатель на ссылку
          */
-        Bone():
-                pSkeleton_(nullptr),
-                index_(0),
-                pParentBone_(nullptr),
-                localBindTransform_(math::Mat4<float>(1.0f)),
-                localTransform_(math::Mat4<float>(1.0f)),
-                totalTransform_(math::Mat4<float>(1.0f)),
-                totalBindTransform_(math::Mat4<float>(1.0f)),
-                totalBindTransformInverse_(math::Mat4<float>(1.0f)){}
+        Bone* operator->()
+        {
+            return this;
+        }
 
         /**
-         * Основной конструктор кости
-         * @param pSkeleton Указатель на объект скелета
-         * @param index Индекс кости в линейном массиве трансформаций
-         * @param parentBone Указатель на родительскую кость
-         * @param localBindTransform Смещение (расположение) относительно родительской кости
-         * @param localTransform  Локальная трансформация (та трансформация, которая может назначаться, например "поворот руки на n градусов")
+         * Доступ к методам кости в стиле указателя
+         * @return Указатель на ссылку
          */
-        explicit Bone(Skeleton* pSkeleton,
-                      size_t index, Bone* parentBone = nullptr,
-                      const math::Mat4<float>& localBindTransform = math::Mat4<float>(1.0f),
-                      const math::Mat4<float>& localTransform = math::Mat4<float>(1.0f)):
-                index_(index),
-                pSkeleton_(pSkeleton),
-                pParentBone_(parentBone),
-                localBindTransform_(localBindTransform),
-                localTransform_(localTransform),
-                totalTransform_(math::Mat4<float>(1.0f)),
-                totalBindTransform_(math::Mat4<float>(1.0f)),
-                totalBindTransformInverse_(math::Mat4<float>(1.0f))
+        const Bone* operator->() const
         {
-            // Вычисление матриц кости
-            calculateBranch(CalcFlags::eFullTransform|CalcFlags::eBindTransform|CalcFlags::eInverseBindTransform);
+            return this;
         }
 
         /**
-         * Деструктор по умолчанию
+         * Проверка, ссылается ли объект на кость
+         * @return Да или нет
          */
-        ~Bone() = default;
+        explicit operator bool() const
+        {
+            return pSkeleton_ != nullptr;
+        }
 
         /**
          * Добавление дочерней кости
-         * @param index Индекс
+         * @param index Индекс (кость с таким индексом не должна быть уже добавлена в иерархию)
          * @param localBindTransform Изначальная трансформация
          * @param localTransform Задаваемая трансформация
-         * @return Указатель на добавленную кость
+         * @return Добавленная кость (пустая ссылка, если индекс некорректен)
          */
-        std::shared_ptr<Bone> addChildBone(size_t index,
-                                           const math::Mat4<float>& localBindTransform,
-                                           const math::Mat4<float>& localTransform = math::Mat4<float>(1.0f))
+        Bone addChildBone(size_t index,
+                          const math::Transform<float>& localBindTransform,
+                          const math::Transform<float>& localTransform = math::Transform<float>())
         {
-            // Создать дочернюю кость
-            std::shared_ptr<Bone> child(new Bone(this->pSkeleton_,index,this,localBindTransform,localTransform));
-            // Добавить в массив дочерних костей
-            this->childrenBones_.push_back(child);
-            // Добавить в общий линейный массив по указанному индексу
-            if(this->pSkeleton_ != nullptr) this->pSkeleton_->bones_[index] = child;
-            // Вернуть указатель
-            return child;
+            return pSkeleton_->attachBone(index, index_, localBindTransform, localTransform);
         }
 
         /**
          * Установить локальную (анимируемую) трансформацию
-         * @param transform Матрица 4*4
-         * @param recalculateBranch Пересчитать ветвь
+         * @details Матрицы ветви пересчитываются при вызове Skeleton::update
+         * @param transform Трансформация (перенос, поворот, масштаб)
          */
-        void setLocalTransform(const math::Mat4<float>& transform, bool recalculateBranch = true)
+        void setLocalTransform(const math::Transform<float>& transform)
         {
-            this->localTransform_ = transform;
-            if(recalculateBranch) this->calculateBranch(CalcFlags::eFullTransform);
+            pSkeleton_->bones_[index_].localTransform = transform;
+            pSkeleton_->markDirty(index_, CalcFlags::eFullTransform);
         }
 
         /**
          * Установить изначальную (initial) трансформацию кости относительно родителя
-         * @param transform Матрица 4*4
-         * @param recalculateBranch Пересчитать ветвь
+         * @details Матрицы ветви пересчитываются при вызове Skeleton::update
+         * @param transform Трансформация (перенос, поворот, масштаб)
          */
-        void setLocalBindTransform(const math::Mat4<float>& transform, bool recalculateBranch = true)
+        void setLocalBindTransform(const math::Transform<float>& transform)
         {
-            this->localBindTransform_ = transform;
-            if(recalculateBranch) this->calculateBranch(CalcFlags::eBindTransform|CalcFlags::eInverseBindTransform);
+            pSkeleton_->bones_[index_].localBindTransform = transform;
+            // Полная трансформация тоже зависит от bind-трансформации
+            pSkeleton_->markDirty(index_, CalcFlags::eFullTransform|CalcFlags::eBindTransform|CalcFlags::eInverseBindTransform);
         }
 
         /**
          * Установить изначальную (initial, bind) и добавочную (animated) трансформацию
-         * @param localBind Матрица 4*4
-         * @param local Матрица 4*4
-         * @param recalculateBranch Пересчитать ветвь
+         * @details Матрицы ветви пересчитываются при вызове Skeleton::update
+         * @param localBind Трансформация (перенос, поворот, масштаб)
+         * @param local Трансформация (перенос, поворот, масштаб)
          */
-        void setTransformations(const math::Mat4<float>& localBind, const math::Mat4<float>& local, bool recalculateBranch = true)
+        void setTransformations(const math::Transform<float>& localBind, const math::Transform<float>& local)
         {
-            this->localBindTransform_ = localBind;
-            this->localTransform_ = local;
-            if(recalculateBranch) this->calculateBranch(CalcFlags::eFullTransform|CalcFlags::eBindTransform|CalcFlags::eInverseBindTransform);
+            pSkeleton_->bones_[index_].localBindTransform = localBind;
+            pSkeleton_->bones_[index_].localTransform = local;
+            pSkeleton_->markDirty(index_, CalcFlags::eFullTransform|CalcFlags::eBindTransform|CalcFlags::eInverseBindTransform);
         }
 
         /**
-         * Получить массив дочерних костей
-         * @return Ссылка на массив указателей
+         * Получить локальную (анимируемую) трансформацию
+         * @return Трансформация (перенос, поворот, масштаб)
          */
-        std::vector<std::shared_ptr<Bone>>& getChildrenBones()
+        const math::Transform<float>& getLocalTransform() const
         {
-            return this->childrenBones_;
+            return pSkeleton_->getLocalTransform(index_);
         }
 
         /**
-         * Получить указатель на родительскую кость
-         * @return Указатель
+         * Получить изначальную (initial) трансформацию кости относительно родителя
+         * @return Трансформация (перенос, поворот, масштаб)
          */
-        Bone* getParentBone()
+        const math::Transform<float>& getLocalBindTransform() const
         {
-            return this->pParentBone_;
+            return pSkeleton_->getLocalBindTransform(index_);
+        }
+
+        /**
+         * Получить родительскую кость
+         * @return Кость (пустая ссылка для корневой)
+         */
+        Bone getParentBone() const
+        {
+            const std::int32_t parent = pSkeleton_->bones_[index_].parentIndex;
+            return parent < 0 ? Bone() : Bone(pSkeleton_, static_cast<size_t>(parent));
+        }
+
+        /**
+         * Получить первую дочернюю кость
+         * @return Кость (пустая ссылка, если дочерних костей нет)
+         */
+        Bone getFirstChildBone() const
+        {
+            const std::int32_t child = pSkeleton_->bones_[index_].firstChildIndex;
+            return child < 0 ? Bone() : Bone(pSkeleton_, static_cast<size_t>(child));
+        }
+
+        /**
+         * Получить следующую кость с тем же родителем
+         * @return Кость (пустая ссылка, если это последний потомок родителя)
+         */
+        Bone getNextSiblingBone() const
+        {
+            const std::int32_t sibling = pSkeleton_->bones_[index_].nextSiblingIndex;
+            return sibling < 0 ? Bone() : Bone(pSkeleton_, static_cast<size_t>(sibling));
         }
 
         /**
          * Получить индекс кости
          * @return Целое положительное число
          */
-        size_t getIndex()
+        size_t getIndex() const
         {
             return index_;
         }
     };
 
     /**
-     * Smart-pointer объекта скелетной кости
+     * Ссылка на кость скелета (сохранено для совместимости, ссылка ведет себя как указатель)
      */
-    typedef std::shared_ptr<Bone> BonePtr;
+    typedef Bone BonePtr;
 
     /**
      * Состояние анимации
@@ -258,72 +212,330 @@ private:
     /// Открыть доступ для класса Mesh
     friend class Mesh;
 
+    /**
+     * Данные кости
+     */
+    struct BoneData
+    {
+        /// Индекс родительской кости (-1 для корневой и не добавленных в иерархию)
+        std::int32_t parentIndex;
+        /// Индекс первой дочерней кости (-1 если нет)
+        std::int32_t firstChildIndex;
+        /// Индекс последней дочерней кости (-1 если нет, для добавления в конец списка)
+        std::int32_t lastChildIndex;
+        /// Индекс следующей кости с тем же родителем (-1 если нет)
+        std::int32_t nextSiblingIndex;
+
+        /// Смещение (расположение) относительно родительской кости (можно считать это initial-положением)
+        math::Transform<float> localBindTransform;
+        /// Локальная трансформация относительно bind (та трансформация, которая может назначаться во время анимации)
+        math::Transform<float> localTransform;
+
+        /// Результирующая трансформация кости с учетом локальной трансформации и результирующий трансформаций родительских костей
+        /// Данная трансформация может быть применена к точкам находящимся В ПРОСТРАНСТВЕ КОСТИ
+        math::Transform<float> totalTransform;
+        /// Результирующая трансформация кости БЕЗ учета задаваемой, но с учетом bind-трансформаций родительских костей
+        math::Transform<float> totalBindTransform;
+        /// Инвертированная bind матрица может быть использована для перехода в пространство кости ИЗ ПРОСТРАНСТВА МОДЕЛИ
+        math::Mat4<float> totalBindTransformInverse;
+        /// Обратная bind-трансформация в виде дуального кватерниона (bind-трансформация жесткая - сопряженный кватернион)
+        math::DualQuat<float> totalBindDualQuatInverse;
+
+        /// Флаги матриц, которые нужно пересчитать при следующем обновлении скелета
+        unsigned dirtyFlags;
+        /// Есть ли среди потомков кости требующие пересчета
+        bool hasDirtyChildren;
+        /// Добавлена ли кость в иерархию
+        bool attached;
+    };
+
+    static_assert(std::is_trivially_copyable<BoneData>::value, "Bone data must be copyable as raw memory");
+
     /// Массив итоговых трансформаций для вершин в пространстве модели
     std::vector<math::Mat4<float>> modelSpaceFinalTransforms_;
+    /// Массив итоговых трансформаций для вершин в пространстве модели в виде дуальных кватернионов (пуст, если не включен)
+    std::vector<math::DualQuat<float>> modelSpaceFinalDualQuats_;
     /// Массив итоговых трансформаций для вершин в пространстве костей
     std::vector<math::Mat4<float>> boneSpaceFinalTransforms_;
     /// Матрица глобальной инверсии (на случай если в программе для моделирования объекту задавалась глобальная трансформация)
     math::Mat4<float> globalInverseTransform_;
+    /// Матрица глобальной инверсии в виде дуального кватерниона (для итоговых дуальных кватернионов)
+    math::DualQuat<float> globalInverseDualQuat_;
 
-    /// Массив указателей на кости для доступа по индексам
-    std::vector<BonePtr> bones_;
-    /// Корневая кость
-    BonePtr rootBone_;
+    /// Данные всех костей (индекс кости - позиция в массиве, корневая кость - 0)
+    std::vector<BoneData> bones_;
 
-public:
     /**
-     * Конструктор по умолчанию
-     * Изначально у скелета всегда есть одна кость
+     * Вычисление матриц кости (родительская кость должна быть уже вычислена)
+     * @param index Индекс кости
+     * @param calcFlags Опции вычисления матриц (какие матрицы считать)
      */
-    Skeleton():
-            modelSpaceFinalTransforms_(1),
-            boneSpaceFinalTransforms_(1),
-            globalInverseTransform_(math::Mat4<float>(1.0f)),
-            bones_(1)
+    void calculate(size_t index, unsigned calcFlags)
     {
-        // Создать корневую кость
-        rootBone_ = std::make_shared<Bone>(this,0,nullptr,math::Mat4<float>(1),math::Mat4<float>(1));
-        // Нулевая кость в линейном массиве указателей
-        bones_[0] = rootBone_;
+        BoneData& bone = bones_[index];
+
+        // Если у кости есть родительская кость
+        if(bone.parentIndex >= 0)
+        {
+            const BoneData& parent = bones_[bone.parentIndex];
+
+            // Общая initial (bind) трансформация для кости учитывает текущую и родительскую (что в свою очередь справедливо и для родительской).
+            // Композиция TRS точна только при равномерном масштабе родителя
+            if(calcFlags & CalcFlags::eBindTransform){
+                assert(parent.totalBindTransform.hasUniformScale() && "Non-uniform bind scale is only allowed on leaf bones");
+                bone.totalBindTransform = parent.totalBindTransform * bone.localBindTransform;
+            }
+
+            // Общая полная (с учетом задаваемой) трансформация кости (смещаем на localTransform, затем на initial, затем на общую родительскую трансформацию)
+            if(calcFlags & CalcFlags::eFullTransform)
+                bone.totalTransform = parent.totalTransform * bone.localBindTransform * bone.localTransform;
+        }
+            // Если нет родительской кости - считать кость корневой
+        else
+        {
+            if(calcFlags & CalcFlags::eBindTransform)
+                bone.totalBindTransform = bone.localBindTransform;
+
+            if(calcFlags & CalcFlags::eFullTransform)
+                bone.totalTransform = bone.localBindTransform * bone.localTransform;
+        }
+
+        // Инвертированная матрица bind трансформации (bind-трансформации всегда аффинные)
+        if(calcFlags & CalcFlags::eInverseBindTransform){
+            bone.totalBindTransformInverse = math::InverseAffine(bone.totalBindTransform.toMat4());
+            bone.totalBindDualQuatInverse = math::Conjugate(math::DualQuat<float>(bone.totalBindTransform));
+        }
+
+        // Перевод в матрицу выполняется один раз, вся композиция выше идет в виде TRS
+        const math::Mat4<float> totalTransformMat = bone.totalTransform.toMat4();
+
+        // Итоговая матрица трансформации для точек находящихся в пространстве модели
+        // Поскольку общая трансформация кости работает с вершинами находящимися в пространстве модели,
+        // они в начале должны быть переведены в пространство кости.
+        modelSpaceFinalTransforms_[index] = globalInverseTransform_ * totalTransformMat * bone.totalBindTransformInverse;
+
+        // Та же трансформация в виде дуального кватерниона (для скиннинга без "скручивания"), только если вывод включен.
+        // Строится из TRS напрямую, обратная bind-трансформация берется из кэша кости
+        if(!modelSpaceFinalDualQuats_.empty()){
+            modelSpaceFinalDualQuats_[index] = globalInverseDualQuat_ * math::DualQuat<float>(bone.totalTransform) * bone.totalBindDualQuatInverse;
+        }
+
+        // Для ситуаций, если вершины задаются сразу в пространстве кости
+        boneSpaceFinalTransforms_[index] = globalInverseTransform_ * totalTransformMat;
+    }
+
+    /**
+     * Пересчет ветви: вычисляются только кости с измененными трансформациями и их потомки, каждая ровно один раз
+     * @param index Индекс кости
+     * @param inheritedFlags Флаги, унаследованные от родителя (трансформации родителя изменились)
+     */
+    void updateBranch(size_t index, unsigned inheritedFlags)
+    {
+        const unsigned calcFlags = inheritedFlags | bones_[index].dirtyFlags;
+        if(calcFlags != CalcFlags::eNone) this->calculate(index, calcFlags);
+
+        // Ветви без изменений пропускаются целиком
+        if(calcFlags != CalcFlags::eNone || bones_[index].hasDirtyChildren){
+            for(std::int32_t child = bones_[index].firstChildIndex; child >= 0; child = bones_[child].nextSiblingIndex){
+                updateBranch(static_cast<size_t>(child), calcFlags);
+            }
+        }
+
+        bones_[index].dirtyFlags = CalcFlags::eNone;
+        bones_[index].hasDirtyChildren = false;
+    }
+
+    /**
+     * Пометить кость как требующую пересчета (пересчет выполняется в update)
+     * @param index Индекс кости
+     * @param calcFlags Опции вычисления матриц (какие матрицы считать)
+     */
+    void markDirty(size_t index, unsigned calcFlags)
+    {
+        bones_[index].dirtyFlags |= calcFlags;
+
+        // Пометить путь до корня, чтобы обновление дошло до этой кости
+        for(std::int32_t parent = bones_[index].parentIndex; parent >= 0 && !bones_[parent].hasDirtyChildren; parent = bones_[parent].parentIndex){
+            bones_[parent].hasDirtyChildren = true;
+        }
+    }
+
+    /**
+     * Добавить кость в иерархию
+     * @param index Индекс кости
+     * @param parentIndex Индекс родительской кости
+     * @param localBindTransform Изначальная трансформация
+     * @param localTransform Задаваемая трансформация
+     * @return Добавленная кость (пустая ссылка, если индекс некорректен или кость уже в иерархии)
+     */
+    Bone attachBone(size_t index, size_t parentIndex, const math::Transform<float>& localBindTransform, const math::Transform<float>& localTransform)
+    {
+        if(index >= bones_.size() || bones_[index].attached) return Bone();
+
+        BoneData& bone = bones_[index];
+        bone.parentIndex = static_cast<std::int32_t>(parentIndex);
+        bone.localBindTransform = localBindTransform;
+        bone.localTransform = localTransform;
+        bone.attached = true;
+
+        // Добавить в конец списка дочерних костей родителя
+        BoneData& parent = bones_[parentIndex];
+        if(parent.lastChildIndex >= 0) bones_[parent.lastChildIndex].nextSiblingIndex = static_cast<std::int32_t>(index);
+        else parent.firstChildIndex = static_cast<std::int32_t>(index);
+        parent.lastChildIndex = static_cast<std::int32_t>(index);
+
+        // Вычисление матриц кости (у новой кости еще нет потомков)
+        calculate(index, CalcFlags::eFullTransform|CalcFlags::eBindTransform|CalcFlags::eInverseBindTransform);
+        return Bone(this, index);
     }
 
+public:
     /**
      * Основной конструктор
-     * @param boneTotalCount Общее количество костей
-     * @param updateCallback Функция обратного вызова при пересчете матриц
+     * @param boneTotalCount Общее количество костей (изначально в иерархии только корневая кость с индексом 0)
      */
-    explicit Skeleton(size_t boneTotalCount):
+    explicit Skeleton(size_t boneTotalCount = 1):
+            modelSpaceFinalTransforms_(std::max<size_t>(1,boneTotalCount)),
+            boneSpaceFinalTransforms_(std::max<size_t>(1,boneTotalCount)),
             globalInverseTransform_(math::Mat4<float>(1.0f))
     {
-        // Изначально у скелета есть как минимум 1 кость
-        modelSpaceFinalTransforms_.resize(std::max<size_t>(1,boneTotalCount));
-        boneSpaceFinalTransforms_.resize(std::max<size_t>(1,boneTotalCount));
-        bones_.resize(std::max<size_t>(1,boneTotalCount));
-
-        // Создать корневую кость
-        rootBone_ = std::make_shared<Bone>(this,0,nullptr,math::Mat4<float>(1),math::Mat4<float>(1));
-        // Нулевая кость в линейном массиве указателей
-        bones_[0] = rootBone_;
+        BoneData empty = {};
+        empty.parentIndex = -1;
+        empty.firstChildIndex = -1;
+        empty.lastChildIndex = -1;
+        empty.nextSiblingIndex = -1;
+        empty.localBindTransform = math::Transform<float>();
+        empty.localTransform = math::Transform<float>();
+        empty.totalTransform = math::Transform<float>();
+        empty.totalBindTransform = math::Transform<float>();
+        empty.totalBindTransformInverse = math::Mat4<float>(1.0f);
+        empty.totalBindDualQuatInverse = math::DualQuat<float>();
+        empty.dirtyFlags = CalcFlags::eNone;
+
+        // Одно выделение памяти под все кости
+        bones_.assign(std::max<size_t>(1,boneTotalCount), empty);
+
+        // Корневая кость
+        bones_[0].attached = true;
+        calculate(0, CalcFlags::eFullTransform|CalcFlags::eBindTransform|CalcFlags::eInverseBindTransform);
     }
 
     /**
-     * Деструктор по умолчанию
+     * Построение скелета по массиву индексов родительских костей
+     * @details Кости связываются обходом в ширину от корня, при этом все матрицы (включая инвертированные bind-матрицы)
+     * вычисляются в порядке "родитель перед потомком" - каждая кость вычисляется ровно один раз.
+     * Кость 0 всегда корневая. Кости без родителя (кроме корневой), в циклах или с предками в циклах в иерархию не
+     * попадают: они остаются неприсоединенными (без родителя, потомков и соседей) и могут быть присоединены позже
+     * @param parents Индексы родительских костей (-1 для корневой), порядок костей произвольный
+     * @param localBindTransforms Смещения костей относительно родителя (в том же порядке)
+     * @param globalInverseTransform Матрица глобальной инверсии
      */
-    ~Skeleton() = default;
+    Skeleton(const std::vector<std::int32_t>& parents,
+             const std::vector<math::Transform<float>>& localBindTransforms,
+             const math::Mat4<float>& globalInverseTransform = math::Mat4<float>(1.0f)):
+            Skeleton(parents.size())
+    {
+        const size_t count = bones_.size();
+        globalInverseTransform_ = globalInverseTransform;
+        globalInverseDualQuat_ = math::DualQuat<float>(globalInverseTransform);
+
+        for(size_t i = 0; i < count && i < localBindTransforms.size(); i++){
+            bones_[i].localBindTransform = localBindTransforms[i];
+        }
+
+        // Списки потомков по массиву родителей (дочерние кости в порядке индексов)
+        std::vector<std::int32_t> firstChild(count, -1), lastChild(count, -1), nextSibling(count, -1);
+        for(size_t i = 1; i < count && i < parents.size(); i++)
+        {
+            const std::int32_t parent = parents[i];
+            if(parent < 0 || static_cast<size_t>(parent) >= count || static_cast<size_t>(parent) == i) continue;
+
+            if(lastChild[parent] >= 0) nextSibling[lastChild[parent]] = static_cast<std::int32_t>(i);
+            else firstChild[parent] = static_cast<std::int32_t>(i);
+            lastChild[parent] = static_cast<std::int32_t>(i);
+        }
+
+        // Обход в ширину от корня: связываются только достижимые кости (кости в циклах остаются неприсоединенными),
+        // родитель всегда вычисляется раньше потомков
+        std::vector<std::int32_t> order;
+        order.reserve(count);
+        order.push_back(0);
+        for(size_t i = 0; i < order.size(); i++)
+        {
+            const std::int32_t index = order[i];
+            calculate(static_cast<size_t>(index), CalcFlags::eFullTransform|CalcFlags::eBindTransform|CalcFlags::eInverseBindTransform);
+
+            for(std::int32_t child = firstChild[index]; child >= 0; child = nextSibling[child])
+            {
+                bones_[child].parentIndex = index;
+                bones_[child].attached = true;
+
+                BoneData& parentBone = bones_[index];
+                if(parentBone.lastChildIndex >= 0) bones_[parentBone.lastChildIndex].nextSiblingIndex = child;
+                else parentBone.firstChildIndex = child;
+                parentBone.lastChildIndex = child;
+
+                order.push_back(child);
+            }
+        }
+    }
 
     /**
      * Получить корневую кость
-     * @return Указатель на объект кости
+     * @return Кость
+     */
+    Bone getRootBone()
+    {
+        return Bone(this, 0);
+    }
+
+    /**
+     * Получить матрицу глобальной инверсии
+     * @return Матрица 4*4
      */
-    BonePtr getRootBone()
+    const math::Mat4<float>& getGlobalInverseTransform() const
     {
-        return rootBone_;
+        return this->globalInverseTransform_;
     }
 
+    /**
+     * Установить матрицу глобальной инверсии (итоговые матрицы пересчитываются при вызове update)
+     * @param m Матрица 4*4
+     */
     void setGlobalInverseTransform(const math::Mat4<float>& m)
     {
         this->globalInverseTransform_ = m;
-        this->getRootBone()->calculateBranch(Bone::CalcFlags::eNone);
+        this->globalInverseDualQuat_ = math::DualQuat<float>(m);
+        this->markDirty(0, CalcFlags::eFinalTransform);
+    }
+
+    /**
+     * Включить или отключить вычисление итоговых трансформаций в виде дуальных кватернионов
+     * @details По умолчанию отключено - скиннинг матрицами не тратит на них время и память.
+     * Включенные дуальные кватернионы вычисляются при следующем вызове update
+     * @param enabled Вычислять ли дуальные кватернионы
+     */
+    void setDualQuatsEnabled(bool enabled)
+    {
+        if(enabled == !this->modelSpaceFinalDualQuats_.empty()) return;
+
+        if(enabled){
+            this->modelSpaceFinalDualQuats_.resize(this->bones_.size());
+            this->markDirty(0, CalcFlags::eFinalTransform);
+        }
+        else{
+            this->modelSpaceFinalDualQuats_.clear();
+            this->modelSpaceFinalDualQuats_.shrink_to_fit();
+        }
+    }
+
+    /**
+     * Пересчитать матрицы костей, трансформации которых изменились с прошлого обновления
+     * @details Каждая кость пересчитывается не более одного раза, ветви без изменений пропускаются
+     */
+    void update()
+    {
+        this->updateBranch(0, CalcFlags::eNone);
     }
 
     /**
@@ -336,6 +548,16 @@ public:
         return fromBoneSpace ? boneSpaceFinalTransforms_ : modelSpaceFinalTransforms_;
     }
 
+    /**
+     * Получить массив итоговых трансформаций костей в виде дуальных кватернионов
+     * @details Вдвое меньше массива матриц. Корректен для жестких трансформаций костей (масштаб не учитывается)
+     * @return Ссылка на массив дуальных кватернионов (для точек в пространстве модели, пуст без setDualQuatsEnabled)
+     */
+    const std::vector<math::DualQuat<float>>& getFinalBoneDualQuats() const
+    {
+        return modelSpaceFinalDualQuats_;
+    }
+
     /**
      * Получить общее кол-во костей
      * @return Целое положительное число
@@ -355,26 +577,47 @@ public:
     }
 
     /**
-     * Получить линейный массив костей
-     * @return Массив указателей на кости
+     * Получить кость по индексу
+     * @param index Индекс
+     * @return Кость
      */
-    const std::vector<BonePtr>& getBones()
+    Bone getBoneByIndex(size_t index)
     {
-        return bones_;
+        return Bone(this, index);
     }
 
     /**
-     * Получить указатель на кость по индексу
-     * @param index Индекс
-     * @return Smart-pointer кости
+     * Получить индекс родительской кости
+     * @param index Индекс кости
+     * @return Индекс родителя (-1 для корневой кости и костей, не добавленных в иерархию)
+     */
+    std::int32_t getParentIndex(size_t index) const
+    {
+        return bones_[index].parentIndex;
+    }
+
+    /**
+     * Получить локальную (анимируемую) трансформацию кости
+     * @param index Индекс кости
+     * @return Трансформация (перенос, поворот, масштаб)
+     */
+    const math::Transform<float>& getLocalTransform(size_t index) const
+    {
+        return bones_[index].localTransform;
+    }
+
+    /**
+     * Получить изначальную (initial) трансформацию кости относительно родителя
+     * @param index Индекс кости
+     * @return Трансформация (перенос, поворот, масштаб)
      */
-    BonePtr getBoneByIndex(size_t index)
+    const math::Transform<float>& getLocalBindTransform(size_t index) const
     {
-        return bones_[index];
+        return bones_[index].localBindTransform;
     }
 };
 
 /**
  * Smart-unique-pointer объекта скелета
  */
-typedef std::unique_ptr<Skeleton> UniqueSkeleton;
\ No newline at end of file
+typedef std::unique_ptr<Skeleton> UniqueSkeleton;
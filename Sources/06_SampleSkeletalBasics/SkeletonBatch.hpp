@@ -0,0 +1,182 @@
+/**
+ * Класс набора экземпляров скелета с общей иерархией. Используется для вычисления поз толпы персонажей
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Math.hpp>
+#include <ThreadPool.hpp>
+
+#include "FlatSkeleton.hpp"
+
+/**
+ * Набор экземпляров скелета
+ * @details Иерархия, bind-трансформации и инвертированные bind-матрицы хранятся один раз для всех экземпляров.
+ * Для каждого экземпляра хранятся только локальные (анимируемые) трансформации. Позы экземпляров независимы,
+ * поэтому вычисляются параллельно, а итоговые матрицы всех экземпляров пишутся в один непрерывный массив
+ * (экземпляр за экземпляром, внутри экземпляра - по исходным индексам костей)
+ */
+class SkeletonBatch
+{
+private:
+    /// Индексы родительских костей в плоском порядке (-1 для корневых)
+    std::vector<std::int32_t> parentIndices_;
+    /// Исходный индекс кости для каждого плоского индекса
+    std::vector<size_t> boneIndices_;
+    /// Смещения костей относительно родителя (общие для всех экземпляров)
+    std::vector<math::Transform<float>> localBindTransforms_;
+    /// Инвертированные результирующие bind-матрицы (общие для всех экземпляров)
+    std::vector<math::Mat4<float>> totalBindTransformsInverse_;
+    /// Матрица глобальной инверсии
+    math::Mat4<float> globalInverseTransform_;
+
+    /// Кол-во экземпляров
+    size_t instanceCount_;
+    /// Общее кол-во костей (размер блока итоговых матриц одного экземпляра)
+    size_t boneCount_;
+
+    /// Локальные трансформации всех экземпляров (блоками по кол-ву костей в плоском порядке)
+    std::vector<math::Transform<float>> localTransforms_;
+    /// Результирующие трансформации (отдельный блок на каждый поток, чтобы потоки не делили память)
+    std::vector<math::Transform<float>> totalTransformsScratch_;
+    /// Итоговые трансформации для вершин в пространстве модели всех экземпляров
+    std::vector<math::Mat4<float>> finalTransforms_;
+
+    /**
+     * Вычисление позы одного экземпляра
+     * @param instance Индекс экземпляра
+     * @param pTotal Временный массив результирующих трансформаций (не меньше кол-ва костей в иерархии)
+     */
+    void updateInstance(size_t instance, math::Transform<float>* pTotal)
+    {
+        const size_t count = boneIndices_.size();
+        const math::Transform<float>* pLocal = localTransforms_.data() + instance * count;
+        math::Mat4<float>* pFinal = finalTransforms_.data() + instance * boneCount_;
+
+        for(size_t i = 0; i < count; i++)
+        {
+            const math::Transform<float> local = localBindTransforms_[i] * pLocal[i];
+            pTotal[i] = parentIndices_[i] < 0 ? local : pTotal[parentIndices_[i]] * local;
+            pFinal[boneIndices_[i]] = globalInverseTransform_ * pTotal[i].toMat4() * totalBindTransformsInverse_[i];
+        }
+    }
+
+public:
+    /**
+     * Конструктор
+     * @param skeleton Плоский скелет, задающий иерархию (его текущая поза - начальная поза всех экземпляров)
+     * @param instanceCount Кол-во экземпляров
+     */
+    SkeletonBatch(const FlatSkeleton& skeleton, size_t instanceCount):
+            parentIndices_(skeleton.getParentIndices()),
+            boneIndices_(skeleton.getBoneIndices()),
+            localBindTransforms_(skeleton.getLocalBindTransforms()),
+            totalBindTransformsInverse_(skeleton.getBindTransformsInverse()),
+            globalInverseTransform_(skeleton.getGlobalInverseTransform()),
+            instanceCount_(instanceCount),
+            boneCount_(skeleton.getBonesCount())
+    {
+        const auto& pose = skeleton.getLocalTransforms();
+        localTransforms_.reserve(instanceCount_ * pose.size());
+        for(size_t i = 0; i < instanceCount_; i++) localTransforms_.insert(localTransforms_.end(), pose.begin(), pose.end());
+
+        finalTransforms_.resize(instanceCount_ * boneCount_, math::Mat4<float>(1.0f));
+        update();
+    }
+
+    /**
+     * Вычисление поз всех экземпляров
+     * @param pThreadPool Пул потоков (nullptr - вычисление в вызывающем потоке)
+     * @param instancesPerTask Кол-во экземпляров, обрабатываемых потоком за раз
+     */
+    void update(tools::ThreadPool* pThreadPool = nullptr, size_t instancesPerTask = 16)
+    {
+        const size_t count = boneIndices_.size();
+        const unsigned threadCount = pThreadPool != nullptr ? pThreadPool->getThreadCount() : 1;
+
+        // Память выделяется только при первом вызове (или при смене пула на пул с большим кол-вом потоков)
+        if(totalTransformsScratch_.size() < threadCount * count) totalTransformsScratch_.resize(threadCount * count);
+
+        if(pThreadPool == nullptr){
+            for(size_t i = 0; i < instanceCount_; i++) updateInstance(i, totalTransformsScratch_.data());
+            return;
+        }
+
+        pThreadPool->parallelFor(instanceCount_, instancesPerTask, [&](size_t begin, size_t end, unsigned workerIndex){
+            math::Transform<float>* pTotal = totalTransformsScratch_.data() + workerIndex * count;
+            for(size_t i = begin; i < end; i++) updateInstance(i, pTotal);
+        });
+    }
+
+    /**
+     * Установить локальную (анимируемую) трансформацию кости экземпляра (поза пересчитывается при вызове update)
+     * @param instance Индекс экземпляра
+     * @param flatIndex Плоский индекс кости (см. FlatSkeleton::getFlatIndex)
+     * @param transform Трансформация (перенос, поворот, масштаб)
+     */
+    void setLocalTransform(size_t instance, size_t flatIndex, const math::Transform<float>& transform)
+    {
+        if(instance < instanceCount_ && flatIndex < boneIndices_.size())
+            localTransforms_[instance * boneIndices_.size() + flatIndex] = transform;
+    }
+
+    /**
+     * Получить локальные трансформации экземпляра в плоском порядке
+     * @param instance Индекс экземпляра
+     * @return Указатель на блок из getFlatBonesCount() трансформаций
+     */
+    math::Transform<float>* getLocalTransforms(size_t instance)
+    {
+        return localTransforms_.data() + instance * boneIndices_.size();
+    }
+
+    /**
+     * Получить итоговые трансформации костей экземпляра
+     * @param instance Индекс экземпляра
+     * @return Указатель на блок из getBonesCount() матриц (по исходным индексам костей)
+     */
+    const math::Mat4<float>* getFinalBoneTransforms(size_t instance) const
+    {
+        return finalTransforms_.data() + instance * boneCount_;
+    }
+
+    /**
+     * Получить итоговые трансформации костей всех экземпляров
+     * @return Ссылка на непрерывный массив из getInstanceCount() * getBonesCount() матриц
+     */
+    const std::vector<math::Mat4<float>>& getAllFinalBoneTransforms() const
+    {
+        return finalTransforms_;
+    }
+
+    /**
+     * Получить кол-во экземпляров
+     * @return Целое положительное число
+     */
+    size_t getInstanceCount() const
+    {
+        return instanceCount_;
+    }
+
+    /**
+     * Получить общее кол-во костей
+     * @return Целое положительное число
+     */
+    size_t getBonesCount() const
+    {
+        return boneCount_;
+    }
+
+    /**
+     * Получить кол-во костей в иерархии (размер блока локальных трансформаций экземпляра)
+     * @return Целое положительное число
+     */
+    size_t getFlatBonesCount() const
+    {
+        return boneIndices_.size();
+    }
+};
@@ -0,0 +1,306 @@
+/**
+ * Скиннинг вершин на CPU (матрицами и дуальными кватернионами). Используется для деформации меша по позе скелета
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+#include <Math.hpp>
+#include <ThreadPool.hpp>
+
+/**
+ * Вершина меша с привязкой к костям (до 4-х костей на вершину)
+ */
+struct SkinVertex
+{
+    /// Положение в пространстве модели
+    math::Vec3<float> position;
+    /// Нормаль в пространстве модели
+    math::Vec3<float> normal;
+    /// Индексы костей (должны быть меньше кол-ва костей в палитре)
+    std::uint16_t boneIndices[4] = {0, 0, 0, 0};
+    /// Веса костей (сумма весов должна быть равна 1, неиспользуемые веса - 0)
+    float boneWeights[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+};
+
+/**
+ * Вершина после скиннинга
+ */
+struct SkinnedVertex
+{
+    /// Положение в пространстве модели
+    math::Vec3<float> position;
+    /// Нормаль в пространстве модели (нормализованная)
+    math::Vec3<float> normal;
+};
+
+/**
+ * Скиннинг вершин
+ * @details Матрицы костей (например Skeleton::getFinalBoneTransforms()) один раз за кадр копируются в палитру
+ * в транспонированном виде - тогда столбцы матрицы лежат в памяти подряд и смешиваются/применяются к вершине
+ * SIMD-операциями без перестановок. Вершины независимы, поэтому могут обрабатываться параллельно отрезками.
+ * Нормали преобразуются линейной частью смешанной матрицы и нормализуются (точно для поворота и равномерного масштаба)
+ */
+class Skinner
+{
+private:
+    /// Транспонированные матрицы костей
+    std::vector<math::Mat4<float>> palette_;
+
+    /**
+     * Скиннинг отрезка вершин
+     * @param pIn Исходные вершины
+     * @param count Кол-во вершин
+     * @param pOut Вершины после скиннинга
+     */
+    void skinRange(const SkinVertex* pIn, size_t count, SkinnedVertex* pOut) const
+    {
+        const math::Mat4<float>* pPalette = palette_.data();
+
+#ifdef MATH_SIMD_SSE
+        for(size_t i = 0; i < count; i++)
+        {
+            const SkinVertex& v = pIn[i];
+
+            // Смешивание столбцов матриц костей (первая кость всегда, остальные - только с ненулевым весом)
+            const float* m = pPalette[v.boneIndices[0]].data;
+            __m128 w = _mm_set1_ps(v.boneWeights[0]);
+            __m128 c0 = _mm_mul_ps(_mm_loadu_ps(m), w);
+            __m128 c1 = _mm_mul_ps(_mm_loadu_ps(m + 4), w);
+            __m128 c2 = _mm_mul_ps(_mm_loadu_ps(m + 8), w);
+            __m128 c3 = _mm_mul_ps(_mm_loadu_ps(m + 12), w);
+
+            for(unsigned j = 1; j < 4; j++)
+            {
+                if(v.boneWeights[j] == 0.0f) continue;
+                m = pPalette[v.boneIndices[j]].data;
+                w = _mm_set1_ps(v.boneWeights[j]);
+                c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_loadu_ps(m), w));
+                c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_loadu_ps(m + 4), w));
+                c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_loadu_ps(m + 8), w));
+                c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_loadu_ps(m + 12), w));
+            }
+
+            // Положение: c0*x + c1*y + c2*z + c3
+            const __m128 p = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v.position.x)), _mm_mul_ps(c1, _mm_set1_ps(v.position.y))),
+                    _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(v.position.z)), c3));
+
+            // Нормаль: c0*x + c1*y + c2*z, затем нормализация (rsqrt + шаг Ньютона)
+            __m128 n = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v.normal.x)), _mm_mul_ps(c1, _mm_set1_ps(v.normal.y))),
+                    _mm_mul_ps(c2, _mm_set1_ps(v.normal.z)));
+            n = _mm_and_ps(n, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+
+            __m128 lenSq = _mm_mul_ps(n, n);
+            lenSq = _mm_add_ps(lenSq, _mm_shuffle_ps(lenSq, lenSq, _MM_SHUFFLE(2, 3, 0, 1)));
+            lenSq = _mm_add_ps(lenSq, _mm_shuffle_ps(lenSq, lenSq, _MM_SHUFFLE(1, 0, 3, 2)));
+            const __m128 r = _mm_rsqrt_ps(lenSq);
+            const __m128 rn = _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), lenSq), _mm_mul_ps(r, r))));
+            n = _mm_and_ps(_mm_mul_ps(n, rn), _mm_cmpgt_ps(lenSq, _mm_setzero_ps()));
+
+            alignas(16) float tmp[8];
+            _mm_store_ps(tmp, p);
+            _mm_store_ps(tmp + 4, n);
+            pOut[i].position = {tmp[0], tmp[1], tmp[2]};
+            pOut[i].normal = {tmp[4], tmp[5], tmp[6]};
+        }
+#else
+        for(size_t i = 0; i < count; i++)
+        {
+            const SkinVertex& v = pIn[i];
+
+            float c[16] = {};
+            for(unsigned j = 0; j < 4; j++)
+            {
+                if(j > 0 && v.boneWeights[j] == 0.0f) continue;
+                const float* m = pPalette[v.boneIndices[j]].data;
+                for(unsigned k = 0; k < 16; k++) c[k] += m[k] * v.boneWeights[j];
+            }
+
+            const math::Vec3<float>& p = v.position;
+            const math::Vec3<float>& n = v.normal;
+            pOut[i].position = {
+                    c[0] * p.x + c[4] * p.y + c[8] * p.z + c[12],
+                    c[1] * p.x + c[5] * p.y + c[9] * p.z + c[13],
+                    c[2] * p.x + c[6] * p.y + c[10] * p.z + c[14]};
+            const math::Vec3<float> normal(
+                    c[0] * n.x + c[4] * n.y + c[8] * n.z,
+                    c[1] * n.x + c[5] * n.y + c[9] * n.z,
+                    c[2] * n.x + c[6] * n.y + c[10] * n.z);
+
+            // Нормаль нулевой длины (например при нулевых весах) не нормализуется - как и в SSE-варианте
+            const float lenSq = math::Dot(normal, normal);
+            pOut[i].normal = lenSq > 0.0f ? normal * (1.0f / std::sqrt(lenSq)) : math::Vec3<float>(0.0f, 0.0f, 0.0f);
+        }
+#endif
+    }
+
+public:
+    /**
+     * Установить матрицы костей (один раз за кадр, после вычисления позы скелета)
+     * @param pBoneTransforms Итоговые матрицы костей в пространстве модели
+     * @param count Кол-во матриц
+     */
+    void setBoneTransforms(const math::Mat4<float>* pBoneTransforms, size_t count)
+    {
+        palette_.resize(count);
+        for(size_t i = 0; i < count; i++) palette_[i] = math::Transpose(pBoneTransforms[i]);
+    }
+
+    /**
+     * Установить матрицы костей (один раз за кадр, после вычисления позы скелета)
+     * @param boneTransforms Итоговые матрицы костей в пространстве модели
+     */
+    void setBoneTransforms(const std::vector<math::Mat4<float>>& boneTransforms)
+    {
+        setBoneTransforms(boneTransforms.data(), boneTransforms.size());
+    }
+
+    /**
+     * Скиннинг вершин
+     * @param pIn Исходные вершины
+     * @param count Кол-во вершин
+     * @param pOut Буфер вершин после скиннинга (не меньше count элементов)
+     * @param pThreadPool Пул потоков (nullptr - обработка в вызывающем потоке)
+     * @param verticesPerTask Кол-во вершин, обрабатываемых потоком за раз
+     */
+    void skin(const SkinVertex* pIn, size_t count, SkinnedVertex* pOut, tools::ThreadPool* pThreadPool = nullptr, size_t verticesPerTask = 4096) const
+    {
+        if(pThreadPool == nullptr){
+            skinRange(pIn, count, pOut);
+            return;
+        }
+
+        pThreadPool->parallelFor(count, verticesPerTask, [&](size_t begin, size_t end, unsigned){
+            skinRange(pIn + begin, end - begin, pOut + begin);
+        });
+    }
+
+    /**
+     * Получить кол-во матриц в палитре
+     * @return Целое положительное число
+     */
+    size_t getBonesCount() const
+    {
+        return palette_.size();
+    }
+};
+
+/**
+ * Скиннинг вершин дуальными кватернионами (dual quaternion skinning)
+ * @details Дуальные кватернионы костей (Skeleton::getFinalBoneDualQuats(), включаются через setDualQuatsEnabled) смешиваются с весами
+ * (с выравниванием знака по первой кости) и нормализуются. Результат - всегда жесткая трансформация, поэтому
+ * при закрутке суставов объем не теряется. Палитра занимает 8 чисел на кость вместо 16 у матриц.
+ * Масштаб костей не учитывается
+ */
+class DualQuatSkinner
+{
+private:
+    /// Дуальные кватернионы костей
+    std::vector<math::DualQuat<float>> palette_;
+
+    /**
+     * Скиннинг отрезка вершин
+     * @param pIn Исходные вершины
+     * @param count Кол-во вершин
+     * @param pOut Вершины после скиннинга
+     */
+    void skinRange(const SkinVertex* pIn, size_t count, SkinnedVertex* pOut) const
+    {
+        const math::DualQuat<float>* pPalette = palette_.data();
+
+        for(size_t i = 0; i < count; i++)
+        {
+            const SkinVertex& v = pIn[i];
+            const math::DualQuat<float>& first = pPalette[v.boneIndices[0]];
+
+#ifdef MATH_SIMD_SSE
+            // Смешивание (основная и дуальная части - по одному регистру)
+            const __m128 reference = _mm_loadu_ps(&first.real.x);
+            __m128 w = _mm_set1_ps(v.boneWeights[0]);
+            __m128 real = _mm_mul_ps(reference, w);
+            __m128 dual = _mm_mul_ps(_mm_loadu_ps(&first.dual.x), w);
+
+            for(unsigned j = 1; j < 4; j++)
+            {
+                if(v.boneWeights[j] == 0.0f) continue;
+                const math::DualQuat<float>& dq = pPalette[v.boneIndices[j]];
+                const float weight = math::Dot(first.real, dq.real) < 0.0f ? -v.boneWeights[j] : v.boneWeights[j];
+                w = _mm_set1_ps(weight);
+                real = _mm_add_ps(real, _mm_mul_ps(_mm_loadu_ps(&dq.real.x), w));
+                dual = _mm_add_ps(dual, _mm_mul_ps(_mm_loadu_ps(&dq.dual.x), w));
+            }
+
+            math::DualQuat<float> blended;
+            _mm_storeu_ps(&blended.real.x, real);
+            _mm_storeu_ps(&blended.dual.x, dual);
+#else
+            math::DualQuat<float> blended = first * v.boneWeights[0];
+            for(unsigned j = 1; j < 4; j++)
+            {
+                if(v.boneWeights[j] == 0.0f) continue;
+                const math::DualQuat<float>& dq = pPalette[v.boneIndices[j]];
+                blended = blended + dq * (math::Dot(first.real, dq.real) < 0.0f ? -v.boneWeights[j] : v.boneWeights[j]);
+            }
+#endif
+
+            blended = math::Normalize(blended);
+            pOut[i].position = blended * v.position;
+            pOut[i].normal = blended.real * v.normal;
+        }
+    }
+
+public:
+    /**
+     * Установить дуальные кватернионы костей (один раз за кадр, после вычисления позы скелета)
+     * @param pBoneDualQuats Итоговые трансформации костей в пространстве модели
+     * @param count Кол-во трансформаций
+     */
+    void setBoneDualQuats(const math::DualQuat<float>* pBoneDualQuats, size_t count)
+    {
+        palette_.assign(pBoneDualQuats, pBoneDualQuats + count);
+    }
+
+    /**
+     * Установить дуальные кватернионы костей (один раз за кадр, после вычисления позы скелета)
+     * @param boneDualQuats Итоговые трансформации костей в пространстве модели
+     */
+    void setBoneDualQuats(const std::vector<math::DualQuat<float>>& boneDualQuats)
+    {
+        setBoneDualQuats(boneDualQuats.data(), boneDualQuats.size());
+    }
+
+    /**
+     * Скиннинг вершин
+     * @param pIn Исходные вершины
+     * @param count Кол-во вершин
+     * @param pOut Буфер вершин после скиннинга (не меньше count элементов)
+     * @param pThreadPool Пул потоков (nullptr - обработка в вызывающем потоке)
+     * @param verticesPerTask Кол-во вершин, обрабатываемых потоком за раз
+     */
+    void skin(const SkinVertex* pIn, size_t count, SkinnedVertex* pOut, tools::ThreadPool* pThreadPool = nullptr, size_t verticesPerTask = 4096) const
+    {
+        if(pThreadPool == nullptr){
+            skinRange(pIn, count, pOut);
+            return;
+        }
+
+        pThreadPool->parallelFor(count, verticesPerTask, [&](size_t begin, size_t end, unsigned){
+            skinRange(pIn + begin, end - begin, pOut + begin);
+        });
+    }
+
+    /**
+     * Получить кол-во дуальных кватернионов в палитре
+     * @return Целое положительное число
+     */
+    size_t getBonesCount() const
+    {
+        return palette_.size();
+    }
+};
@@ -54,18 +54,12 @@ void PresentFrame(void *pixels, int width, int height, HWND hWnd);
 /**
  * Нарисовать линейные примитивы
  * @param imageBuffer Указатель на кадровый буфер
- * @param projectedToNdcPoints Точки спроецированные в NDC пространство
+ * @param screenX Координаты X точек на экране
+ * @param screenY Координаты Y точек на экране
+ * @param count Количество точек
  * @param pointsPerPrimitive Количество точек на один примитив
  */
-void DrawLinePrimitives(gfx::ImageBuffer<RGBQUAD>* imageBuffer, const std::vector<math::Vec2<float>>& projectedToNdcPoints, uint32_t pointsPerPrimitive);
-
-/**
- * Спроецировать точки в NDC
- * @param mProjection Матрица проекции
- * @param points Массив точек в пространстве мира
- * @return Массив спроецированных точек (без учета глубины)
- */
-std::vector<math::Vec2<float>> ProjectPoints(const math::Mat4<float>& mProjection, const std::vector<math::Vec3<float>>& points);
+void DrawLinePrimitives(gfx::ImageBuffer<RGBQUAD>* imageBuffer, const float* screenX, const float* screenY, size_t count, uint32_t pointsPerPrimitive);
 
 /**
  * Точка входа
@@ -138,17 +132,19 @@ int main(int argc, char* argv[])
         // Матрица проекции
         math::Mat4<float> mProjection = math::GetProjectionMatPerspective(90.0f,aspectRatio,0.0f,100.0f);
 
-        // Точки линий
-        std::vector<math::Vec3<float>> linePoints {
-        };
+        // Кол-во линий
+        const size_t lineCount = 100;
+
+        // Точки линий (отдельные массивы координат, память выделяется один раз)
+        std::vector<float> lineX(lineCount * 2), lineY(lineCount * 2), lineZ(lineCount * 2);
 
         // Точки квадрата (квадрат впереди на -4 единицы)
-        std::vector<math::Vec3<float>> quadPoints = {
-                {-1.0f,1.0f,-2.0f},
-                {1.0f,1.0f,-2.0f},
-                {1.0f,-1.0f,-2.0f},
-                {-1.0f,-1.0f,-2.0f}
-        };
+        const float quadX[4] = {-1.0f, 1.0f, 1.0f, -1.0f};
+        const float quadY[4] = {1.0f, 1.0f, -1.0f, -1.0f};
+        const float quadZ[4] = {-2.0f, -2.0f, -2.0f, -2.0f};
+
+        // Точки после преобразований (координаты экрана)
+        std::vector<float> screenX(lineCount * 2), screenY(lineCount * 2);
 
         // Положение источника света
         math::Vec3<float> lightPosition = {0.0f,0.0f,-2.0f};
@@ -181,16 +177,13 @@ int main(int argc, char* argv[])
                 }
             }
 
-            // Очистить точки
-            linePoints.clear();
-
             // Рандомизация
             ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
             rndEngine.seed(static_cast<unsigned>(ms.count()));
             std::uniform_real_distribution<float> vectorDist(-1.0f,1.0f);
             std::uniform_real_distribution<float> radiusDist(0.0f,1.0f);
 
-            for(uint32_t i = 0; i < 100; i++)
+            for(size_t i = 0; i < lineCount; i++)
             {
                 // Случайные значения компонентов вектора для генерации перпендикуряра
                 float xR = vectorDist(rndEngine);
@@ -204,17 +197,21 @@ int main(int argc, char* argv[])
                 auto randomPerpendicular = math::Normalize(math::Cross(toLight, toLight + math::Vec3<float>(xR, yR, zR)));
                 auto edgePoint = lightPosition + (randomPerpendicular * lightRadius * rR);
 
-                linePoints.push_back(lightPosition);
-                linePoints.push_back(edgePoint);
+                lineX[i * 2] = lightPosition.x;
+                lineY[i * 2] = lightPosition.y;
+                lineZ[i * 2] = lightPosition.z;
+                lineX[i * 2 + 1] = edgePoint.x;
+                lineY[i * 2 + 1] = edgePoint.y;
+                lineZ[i * 2 + 1] = edgePoint.z;
             }
 
+            // Спроецировать и нарисовать квадрат
+            math::TransformPoints(mProjection, quadX, quadY, quadZ, 4, frameBuffer.getWidth(), frameBuffer.getHeight(), screenX.data(), screenY.data());
+            DrawLinePrimitives(&frameBuffer, screenX.data(), screenY.data(), 4, 4);
 
-            // Точки после преобразований (2D)
-            std::vector<math::Vec2<float>> quadPointsTransformed = ProjectPoints(mProjection, quadPoints);
-            std::vector<math::Vec2<float>> linePointsTransformed = ProjectPoints(mProjection, linePoints);
-            // Нарисовать спроецированные примитивы
-            DrawLinePrimitives(&frameBuffer,quadPointsTransformed,4);
-            DrawLinePrimitives(&frameBuffer,linePointsTransformed,2);
+            // Спроецировать и нарисовать линии
+            math::TransformPoints(mProjection, lineX.data(), lineY.data(), lineZ.data(), lineX.size(), frameBuffer.getWidth(), frameBuffer.getHeight(), screenX.data(), screenY.data());
+            DrawLinePrimitives(&frameBuffer, screenX.data(), screenY.data(), lineX.size(), 2);
 
             // Показ кадра
             PresentFrame(frameBuffer.getData(), static_cast<int>(frameBuffer.getWidth()), static_cast<int>(frameBuffer.getHeight()), g_hwnd);
@@ -325,12 +322,14 @@ void PresentFrame(void *pixels, int width, int height, HWND hWnd)
 /**
  * Нарисовать линейные примитивы
  * @param imageBuffer Указатель на кадровый буфер
- * @param projectedToNdcPoints Точки спроецированные в NDC пространство
+ * @param screenX Координаты X точек на экране
+ * @param screenY Координаты Y точек на экране
+ * @param count Количество точек
  * @param pointsPerPrimitive Количество точек на один примитив
  */
-void DrawLinePrimitives(gfx::ImageBuffer<RGBQUAD>* imageBuffer, const std::vector<math::Vec2<float>> &projectedToNdcPoints, uint32_t pointsPerPrimitive)
+void DrawLinePrimitives(gfx::ImageBuffer<RGBQUAD>* imageBuffer, const float* screenX, const float* screenY, size_t count, uint32_t pointsPerPrimitive)
 {
-    for(size_t i = 0; i < projectedToNdcPoints.size(); i+=pointsPerPrimitive)
+    for(size_t i = 0; i < count; i+=pointsPerPrimitive)
     {
         for(size_t j = i; j < i + pointsPerPrimitive; j++)
         {
@@ -338,35 +337,11 @@ void DrawLinePrimitives(gfx::ImageBuffer<RGBQUAD>* imageBuffer, const std::vecto
             size_t i0 = j;
             size_t i1 = ((j+1) > (i+pointsPerPrimitive-1) ? i : j+1);
 
-            // Перевести точки в координаты экрана
-            auto ps0 = math::NdcToScreen(projectedToNdcPoints[i0],imageBuffer->getWidth(),imageBuffer->getHeight());
-            auto ps1 = math::NdcToScreen(projectedToNdcPoints[i1],imageBuffer->getWidth(),imageBuffer->getHeight());
-
             // Нарисовать линию соединяющую точки
-            gfx::SetLine(imageBuffer,ps0.x,ps0.y,ps1.x,ps1.y,{0,255,0});
+            gfx::SetLine(imageBuffer,
+                         static_cast<int>(screenX[i0]),static_cast<int>(screenY[i0]),
+                         static_cast<int>(screenX[i1]),static_cast<int>(screenY[i1]),
+                         {0,255,0});
         }
     }
 }
-
-/**
- * Спроецировать точки в NDC
- * @param mProjection Матрица проекции
- * @param points Массив точек в пространстве мира
- * @return Массив спроецированных точек (без учета глубины)
- */
-std::vector<math::Vec2<float>> ProjectPoints(const math::Mat4<float> &mProjection, const std::vector<math::Vec3<float>> &points)
-{
-    std::vector<math::Vec2<float>> result{};
-
-    for(const auto& point : points)
-    {
-        // Проекция
-        auto vt = mProjection * math::Vec4<float>({point.x,point.y,point.z,1.0f});
-        // Перспективное деление
-        vt = vt / vt.w;
-        // Добавить в итоговый массив
-        result.emplace_back(vt.x,vt.y);
-    }
-
-    return result;
-}
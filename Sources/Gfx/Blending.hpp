@@ -0,0 +1,459 @@
+#pragma once
+
+#include "ImageBuffer.hpp"
+#include "Gfx.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+namespace gfx
+{
+    /**
+     * Режим смешивания (состояние смешивания) при записи в буфер изображения
+     * @details Работает с 8-битными 4-компонентными пикселями (порядок BGRA как у RGBQUAD, альфа - 4-й байт)
+     */
+    enum class BlendMode
+    {
+        /// Перезапись (поведение по умолчанию для SetPint/SetSpan и т.д.)
+        eNone,
+        /// Наложение с непремноженной альфой: dst = src * a + dst * (1 - a)
+        eSrcOver,
+        /// Наложение с премноженной альфой: dst = src + dst * (1 - a)
+        ePremultiplied,
+        /// Сложение с насыщением: dst = min(src + dst, 1)
+        eAdditive,
+        /// Умножение: dst = src * dst
+        eMultiply
+    };
+
+    namespace detail
+    {
+        /**
+         * Деление на 255 с округлением для произведения двух 8-битных значений (точное для всего диапазона)
+         * @param v Произведение (0..65025)
+         * @return Результат (0..255)
+         */
+        inline unsigned Div255(unsigned v)
+        {
+            v += 128;
+            return (v + (v >> 8u)) >> 8u;
+        }
+
+        /**
+         * Скалярное смешивание одного пикселя
+         * @tparam MODE Режим смешивания
+         * @param dst Байты пикселя назначения (BGRA)
+         * @param src Байты исходного пикселя (BGRA)
+         */
+        template<BlendMode MODE>
+        inline void BlendPixel(std::uint8_t* dst, const std::uint8_t* src)
+        {
+            const unsigned a = src[3];
+
+            for(unsigned i = 0; i < 4; i++)
+            {
+                const unsigned s = src[i];
+                const unsigned d = dst[i];
+
+                switch (MODE)
+                {
+                    case BlendMode::eNone:
+                        dst[i] = static_cast<std::uint8_t>(s);
+                        break;
+                    case BlendMode::eSrcOver:
+                        // Для альфа-канала исходный множитель равен 1 (итоговая альфа a + da * (1 - a))
+                        dst[i] = static_cast<std::uint8_t>(Div255(s * (i == 3 ? 255u : a)) + Div255(d * (255u - a)));
+                        break;
+                    case BlendMode::ePremultiplied:
+                        dst[i] = static_cast<std::uint8_t>(std::min(255u, s + Div255(d * (255u - a))));
+                        break;
+                    case BlendMode::eAdditive:
+                        dst[i] = static_cast<std::uint8_t>(std::min(255u, s + d));
+                        break;
+                    case BlendMode::eMultiply:
+                        dst[i] = static_cast<std::uint8_t>(Div255(s * d));
+                        break;
+                }
+            }
+        }
+
+#ifdef GFX_SIMD_SSE2
+        /**
+         * Деление на 255 с округлением для 16-битных произведений (8 значений)
+         * @param v Произведения (0..65025)
+         * @return Результат (0..255 в 16-битных ячейках)
+         */
+        inline __m128i Div255(__m128i v)
+        {
+            v = _mm_add_epi16(v, _mm_set1_epi16(128));
+            return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+        }
+
+        /**
+         * Размножить альфу каждого пикселя на все 4 канала (2 пикселя в 16-битных ячейках)
+         * @param v Распакованные пиксели
+         * @return Альфа в каждом канале
+         */
+        inline __m128i BroadcastAlpha(__m128i v)
+        {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3,3,3,3));
+            return _mm_shufflehi_epi16(v, _MM_SHUFFLE(3,3,3,3));
+        }
+
+        /**
+         * Смешивание половины регистра (2 пикселя, распакованные в 16 бит)
+         * @tparam MODE Режим смешивания
+         * @param d Пиксели назначения
+         * @param s Исходные пиксели
+         * @return Результат (16-битные ячейки)
+         */
+        template<BlendMode MODE>
+        inline __m128i BlendHalf(__m128i d, __m128i s)
+        {
+            const __m128i full = _mm_set1_epi16(255);
+            const __m128i alphaLanes = _mm_set_epi16(-1,0,0,0,-1,0,0,0);
+
+            switch (MODE)
+            {
+                case BlendMode::eSrcOver:
+                {
+                    __m128i a = BroadcastAlpha(s);
+                    __m128i sf = _mm_or_si128(_mm_andnot_si128(alphaLanes, a), _mm_and_si128(alphaLanes, full));
+                    return _mm_add_epi16(Div255(_mm_mullo_epi16(s, sf)), Div255(_mm_mullo_epi16(d, _mm_sub_epi16(full, a))));
+                }
+                case BlendMode::ePremultiplied:
+                {
+                    __m128i a = BroadcastAlpha(s);
+                    return _mm_add_epi16(s, Div255(_mm_mullo_epi16(d, _mm_sub_epi16(full, a))));
+                }
+                case BlendMode::eMultiply:
+                    return Div255(_mm_mullo_epi16(s, d));
+                default:
+                    return s;
+            }
+        }
+
+        /**
+         * Смешивание 4 пикселей
+         * @tparam MODE Режим смешивания
+         * @param d Пиксели назначения
+         * @param s Исходные пиксели
+         * @return Результат
+         */
+        template<BlendMode MODE>
+        inline __m128i Blend4(__m128i d, __m128i s)
+        {
+            if(MODE == BlendMode::eNone) return s;
+            if(MODE == BlendMode::eAdditive) return _mm_adds_epu8(d, s);
+
+            const __m128i zero = _mm_setzero_si128();
+            __m128i lo = BlendHalf<MODE>(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+            __m128i hi = BlendHalf<MODE>(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+
+            // Упаковка с насыщением (для премноженной альфы сумма может выйти за пределы 255)
+            return _mm_packus_epi16(lo, hi);
+        }
+#endif
+
+        /**
+         * Смешивание отрезка пикселей
+         * @tparam MODE Режим смешивания
+         * @tparam UNIFORM Исходный цвет одинаков для всех пикселей (src указывает на один пиксель)
+         * @param dst Байты пикселей назначения
+         * @param src Байты исходных пикселей
+         * @param count Количество пикселей
+         */
+        template<BlendMode MODE, bool UNIFORM>
+        inline void BlendSpan(std::uint8_t* dst, const std::uint8_t* src, size_t count)
+        {
+            size_t i = 0;
+
+#ifdef GFX_SIMD_SSE2
+            std::int32_t packed;
+            std::memcpy(&packed, src, 4);
+            const __m128i uniform = _mm_set1_epi32(packed);
+
+            for(; i + 4 <= count; i += 4)
+            {
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i * 4));
+                __m128i s = UNIFORM ? uniform : _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), Blend4<MODE>(d, s));
+            }
+#endif
+
+            for(; i < count; i++)
+            {
+                BlendPixel<MODE>(dst + i * 4, UNIFORM ? src : src + i * 4);
+            }
+        }
+
+        /**
+         * Расширить границы рядов пикселями отрезка (тот же алгоритм Брезенхэма, что и в SetLine)
+         * @param pLeft Левые границы рядов (индекс - ряд относительно minY)
+         * @param pRight Правые границы рядов
+         * @param minY Первый ряд
+         * @param x0 Координаты точки начала по X
+         * @param y0 Координаты точки начала по Y
+         * @param x1 Координаты точки конца по X
+         * @param y1 Координаты точки конца по Y
+         */
+        inline void ExtendRowsByLine(int* pLeft, int* pRight, int minY, int x0, int y0, int x1, int y1)
+        {
+            const bool axisSwapped = std::abs(x1 - x0) < std::abs(y1 - y0);
+            if(axisSwapped){
+                std::swap(x0,y0);
+                std::swap(x1,y1);
+            }
+
+            const int deltaX = std::abs(x1 - x0);
+            const int deltaY = std::abs(y1 - y0);
+
+            if(x0 > x1){
+                std::swap(x0, x1);
+                std::swap(y0, y1);
+            }
+
+            int error = 0;
+            const int deltaErr = deltaY + 1;
+            const int dirY = (y1 > y0) - (y1 < y0);
+
+            for(int x = x0, y = y0; x <= x1; x++)
+            {
+                const int px = axisSwapped ? y : x;
+                const int row = (axisSwapped ? x : y) - minY;
+                pLeft[row] = std::min(pLeft[row], px);
+                pRight[row] = std::max(pRight[row], px);
+
+                error += deltaErr;
+                if(error >= (deltaX + 1)){
+                    y += dirY;
+                    error -= (deltaX + 1);
+                }
+            }
+        }
+
+        /**
+         * Выбор ядра смешивания по режиму (один раз на отрезок)
+         * @tparam UNIFORM Исходный цвет одинаков для всех пикселей
+         * @param dst Байты пикселей назначения
+         * @param src Байты исходных пикселей
+         * @param count Количество пикселей
+         * @param mode Режим смешивания
+         */
+        template<bool UNIFORM>
+        inline void BlendSpan(std::uint8_t* dst, const std::uint8_t* src, size_t count, BlendMode mode)
+        {
+            switch (mode)
+            {
+                case BlendMode::eNone:          BlendSpan<BlendMode::eNone, UNIFORM>(dst, src, count); break;
+                case BlendMode::eSrcOver:       BlendSpan<BlendMode::eSrcOver, UNIFORM>(dst, src, count); break;
+                case BlendMode::ePremultiplied: BlendSpan<BlendMode::ePremultiplied, UNIFORM>(dst, src, count); break;
+                case BlendMode::eAdditive:      BlendSpan<BlendMode::eAdditive, UNIFORM>(dst, src, count); break;
+                case BlendMode::eMultiply:      BlendSpan<BlendMode::eMultiply, UNIFORM>(dst, src, count); break;
+            }
+        }
+    }
+
+    /**
+     * Смешать отрезок пикселей с одним цветом
+     * @tparam T Тип пикселей (4 байта, BGRA)
+     * @param dst Указатель на первый пиксель назначения
+     * @param color Цвет
+     * @param count Количество пикселей
+     * @param mode Режим смешивания
+     */
+    template<typename T>
+    void BlendSpan(T* dst, const T& color, size_t count, BlendMode mode)
+    {
+        static_assert(sizeof(T) == 4, "Blending requires 8-bit BGRA pixels");
+        detail::BlendSpan<true>(reinterpret_cast<std::uint8_t*>(dst), reinterpret_cast<const std::uint8_t*>(&color), count, mode);
+    }
+
+    /**
+     * Смешать отрезок пикселей с отрезком исходных пикселей
+     * @tparam T Тип пикселей (4 байта, BGRA)
+     * @param dst Указатель на первый пиксель назначения
+     * @param src Указатель на первый исходный пиксель
+     * @param count Количество пикселей
+     * @param mode Режим смешивания
+     */
+    template<typename T>
+    void BlendSpan(T* dst, const T* src, size_t count, BlendMode mode)
+    {
+        static_assert(sizeof(T) == 4, "Blending requires 8-bit BGRA pixels");
+        detail::BlendSpan<false>(reinterpret_cast<std::uint8_t*>(dst), reinterpret_cast<const std::uint8_t*>(src), count, mode);
+    }
+
+    /**
+     * Задать конкретной точке конкретный цвет с учетом режима смешивания
+     * @tparam T Тип пикселей в буфере изображения (4 байта, BGRA)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x Координаты по X
+     * @param y Координаты по Y
+     * @param color Цвет
+     * @param mode Режим смешивания
+     * @param safeChecks Осуществлять проверку на выход за пределы
+     */
+    template<typename T>
+    void SetPintBlended(ImageBuffer<T>* imageBuffer, int x, int y, const T& color, BlendMode mode, bool safeChecks = true)
+    {
+        if(safeChecks){
+            if(!imageBuffer->isPointIn(x,y)) return;
+        }
+
+        BlendSpan(&(*imageBuffer)[y][x], color, 1, mode);
+    }
+
+    /**
+     * Задать конкретной точке конкретный цвет с учетом глубины точки и режима смешивания
+     * @tparam T0 Тип пикселей в буфере изображения (4 байта, BGRA)
+     * @tparam T1 Тип пикселей в буфере глубины
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param depthBuffer Указатель на объект буфера глубины
+     * @param x Координаты по X
+     * @param y Координаты по Y
+     * @param color Цвет
+     * @param depth Глубина
+     * @param mode Режим смешивания
+     * @param safeChecks Осуществлять проверку на выход за пределы
+     */
+    template<typename T0, typename T1>
+    void SetPointBlended(ImageBuffer<T0>* imageBuffer,
+                         ImageBuffer<T1>* depthBuffer,
+                         int x,
+                         int y,
+                         const T0& color,
+                         const T1 depth,
+                         BlendMode mode,
+                         bool safeChecks = true)
+    {
+        if(safeChecks){
+            if(!imageBuffer->isPointIn(x,y)) return;
+            if(!depthBuffer->isPointIn(x,y)) return;
+        }
+
+        if(depth < (*depthBuffer)[y][x]){
+            BlendSpan(&(*imageBuffer)[y][x], color, 1, mode);
+            (*depthBuffer)[y][x] = depth;
+        }
+    }
+
+    /**
+     * Растеризация горизонтального отрезка (спана) с учетом режима смешивания
+     * @tparam T Тип пикселей в буфере изображения (4 байта, BGRA)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x0 Координаты начала отрезка по X
+     * @param x1 Координаты конца отрезка по X (включительно)
+     * @param y Координаты отрезка по Y
+     * @param color Цвет
+     * @param mode Режим смешивания
+     * @param safeChecks Обрезать отрезок по границам буфера
+     */
+    template<typename T>
+    void SetSpanBlended(ImageBuffer<T>* imageBuffer, int x0, int x1, int y, const T& color, BlendMode mode, bool safeChecks = true)
+    {
+        if(x0 > x1) std::swap(x0,x1);
+
+        if(safeChecks){
+            if(y < 0 || y > static_cast<int>(imageBuffer->getHeight()) - 1) return;
+            x0 = std::max(x0, 0);
+            x1 = std::min(x1, static_cast<int>(imageBuffer->getWidth()) - 1);
+            if(x0 > x1) return;
+        }
+
+        BlendSpan((*imageBuffer)[y] + x0, color, static_cast<size_t>(x1 - x0 + 1), mode);
+    }
+
+    /**
+     * Растеризация закрашенного треугольника с учетом режима смешивания
+     * @details Покрытие то же, что у SetTriangle с заливкой (контур Брезенхэма и внутренние точки), но каждый ряд
+     * пишется одним отрезком через SetSpanBlended - пиксели контура не смешиваются дважды
+     * @tparam T Тип пикселей в буфере изображения (4 байта, BGRA)
+     * @param imageBuffer Буфер изображения
+     * @param x0 Координаты первой точки по X
+     * @param y0 Координаты первой точки по y
+     * @param x1 Координаты второй точки по X
+     * @param y1 Координаты второй точки по Y
+     * @param x2 Координаты третьей точки по X
+     * @param y2 Координаты третьей точки по y
+     * @param color Цвет
+     * @param mode Режим смешивания
+     * @param safeChecks Проверка точек на выход за пределы буфера
+     */
+    template <typename T>
+    void SetTriangleBlended(ImageBuffer<T>* imageBuffer,
+                            int x0, int y0,
+                            int x1, int y1,
+                            int x2, int y2,
+                            const T& color,
+                            BlendMode mode,
+                            std::uint_fast8_t safeChecks = SAFE_CHECK_ALL_POINTS)
+    {
+        if(safeChecks & SAFE_CHECK_KEY_POINTS){
+            if(!imageBuffer->isPointIn(x0,y0)) return;
+            if(!imageBuffer->isPointIn(x1,y1)) return;
+            if(!imageBuffer->isPointIn(x2,y2)) return;
+        }
+
+        const int minX = std::min(x0, std::min(x1, x2));
+        const int minY = std::min(y0, std::min(y1, y2));
+        const int maxX = std::max(x0, std::max(x1, x2));
+        const int maxY = std::max(y0, std::max(y1, y2));
+
+        // Границы рядов по контуру
+        const auto rows = static_cast<size_t>(maxY - minY + 1);
+        std::vector<int> left(rows, maxX + 1);
+        std::vector<int> right(rows, minX - 1);
+        detail::ExtendRowsByLine(left.data(), right.data(), minY, x0, y0, x1, y1);
+        detail::ExtendRowsByLine(left.data(), right.data(), minY, x1, y1, x2, y2);
+        detail::ExtendRowsByLine(left.data(), right.data(), minY, x2, y2, x0, y0);
+
+        // Внутренние точки за пределами контура (та же проверка и тот же прямоугольник, что и в SetTriangle)
+        for(int y = minY; y < maxY; y++)
+        {
+            int& l = left[y - minY];
+            int& r = right[y - minY];
+
+            for(int x = minX; x < std::min(l, maxX); x++){
+                if(IsPointInTriangle<int>({x,y},{x0,y0},{x1,y1},{x2,y2})){ l = x; break; }
+            }
+            for(int x = maxX - 1; x > r; x--){
+                if(IsPointInTriangle<int>({x,y},{x0,y0},{x1,y1},{x2,y2})){ r = x; break; }
+            }
+        }
+
+        const bool check = safeChecks & SAFE_CHECK_ALL_POINTS;
+        for(int y = minY; y <= maxY; y++)
+        {
+            if(left[y - minY] <= right[y - minY]) SetSpanBlended(imageBuffer, left[y - minY], right[y - minY], y, color, mode, check);
+        }
+    }
+
+    /**
+     * Наложение одного буфера изображения на другой (композитинг за один проход)
+     * @details Буферы должны быть одного размера, иначе накладывается пересекающаяся область (от верхнего левого угла)
+     * @tparam T Тип пикселей в буфере изображения (4 байта, BGRA)
+     * @param dstBuffer Указатель на буфер назначения
+     * @param srcBuffer Указатель на накладываемый буфер
+     * @param mode Режим смешивания
+     */
+    template<typename T>
+    void BlendImage(ImageBuffer<T>* dstBuffer, ImageBuffer<T>* srcBuffer, BlendMode mode)
+    {
+        const unsigned width = std::min(dstBuffer->getWidth(), srcBuffer->getWidth());
+        const unsigned height = std::min(dstBuffer->getHeight(), srcBuffer->getHeight());
+
+        // Если ширина совпадает - буферы непрерывны, смешиваем одним отрезком
+        if(dstBuffer->getWidth() == srcBuffer->getWidth()){
+            if(width * height > 0) BlendSpan(dstBuffer->getData(), srcBuffer->getData(), width * height, mode);
+            return;
+        }
+
+        for(unsigned y = 0; y < height; y++){
+            BlendSpan((*dstBuffer)[static_cast<int>(y)], (*srcBuffer)[static_cast<int>(y)], width, mode);
+        }
+    }
+}
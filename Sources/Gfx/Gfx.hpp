@@ -3,7 +3,9 @@
 #include "ImageBuffer.hpp"
 
 #include <cmath>
+#include <cstdint>
 #include <functional>
+#include <vector>
 
 namespace gfx
 {
@@ -34,6 +36,39 @@ namespace gfx
         Point2D<T> max;
     };
 
+#ifdef GFX_TRIANGLE_STATS
+    /**
+     * Счетчики растеризации треугольников (SetTriangle)
+     * @details Включаются макросом GFX_TRIANGLE_STATS. Общие для всей программы и не потокобезопасны,
+     * поэтому пригодны только для отрисовки из одного потока (без ThreadPool)
+     */
+    struct TriangleStats
+    {
+        /// Треугольники, обработанные путем для мелких треугольников (описывающий прямоугольник не больше 8x8)
+        size_t microTriangles = 0;
+        /// Треугольники, обработанные общим путем
+        size_t regularTriangles = 0;
+    };
+
+    /**
+     * Получить счетчики растеризации треугольников
+     * @return Ссылка на счетчики
+     */
+    inline TriangleStats& GetTriangleStats()
+    {
+        static TriangleStats stats;
+        return stats;
+    }
+
+    /**
+     * Сбросить счетчики растеризации треугольников
+     */
+    inline void ResetTriangleStats()
+    {
+        GetTriangleStats() = TriangleStats();
+    }
+#endif
+
     /**
      * Задать конкретной точке конкретный цвет
      * @tparam T Тип пикселей в буфере изображения
@@ -201,6 +236,174 @@ namespace gfx
         }
     }
 
+    /**
+     * Растеризация горизонтального отрезка (спана) в буфере изображения
+     * @details Отрезок записывается одним непрерывным блоком, проверка выполняется один раз на весь отрезок
+     * @tparam T Тип пикселей в буфере изображения
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x0 Координаты начала отрезка по X
+     * @param x1 Координаты конца отрезка по X (включительно)
+     * @param y Координаты отрезка по Y
+     * @param color Цвет
+     * @param safeChecks Обрезать отрезок по границам буфера
+     */
+    template<typename T>
+    void SetSpan(ImageBuffer<T>* imageBuffer, int x0, int x1, int y, const T& color, bool safeChecks = true)
+    {
+        if(x0 > x1) std::swap(x0,x1);
+
+        if(safeChecks){
+            if(y < 0 || y > static_cast<int>(imageBuffer->getHeight()) - 1) return;
+            x0 = std::max(x0, 0);
+            x1 = std::min(x1, static_cast<int>(imageBuffer->getWidth()) - 1);
+            if(x0 > x1) return;
+        }
+
+        std::fill_n((*imageBuffer)[y] + x0, x1 - x0 + 1, color);
+    }
+
+    /**
+     * Заливка скругленной области спанами (общая часть для круга и прямоугольника со скругленными углами)
+     * @details Область - внутренний прямоугольник, расширенный на радиус во все стороны. Протяженность строк
+     * скругленных частей вычисляется алгоритмом средней точки, каждая строка записывается ровно один раз
+     * @tparam T Тип пикселей в буфере изображения
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param left Левая граница внутреннего прямоугольника (центры скруглений)
+     * @param top Верхняя граница внутреннего прямоугольника
+     * @param right Правая граница внутреннего прямоугольника
+     * @param bottom Нижняя граница внутреннего прямоугольника
+     * @param r Радиус скругления
+     * @param color Цвет заливки
+     * @param safeChecks Обрезать спаны по границам буфера
+     */
+    template<typename T>
+    void SetRoundedSpans(ImageBuffer<T>* imageBuffer,
+                         int left, int top,
+                         int right, int bottom,
+                         int r,
+                         const T& color,
+                         bool safeChecks = true)
+    {
+        // Средняя часть (строки между центрами скруглений) - во всю ширину
+        for(int y = top; y <= bottom; y++){
+            SetSpan(imageBuffer, left - r, right + r, y, color, safeChecks);
+        }
+
+        // Скругленные части (смещение строки от центра, полуширина)
+        int x = 0;
+        int y = r;
+        int delta = 1 - r;
+
+        while (x <= y)
+        {
+            // Строка со смещением x всегда новая, её полуширина равна y
+            if(x > 0){
+                SetSpan(imageBuffer, left - y, right + y, top - x, color, safeChecks);
+                SetSpan(imageBuffer, left - y, right + y, bottom + x, color, safeChecks);
+            }
+
+            if(delta < 0){
+                delta += 2 * x + 3;
+            }
+            else{
+                // Перед уменьшением y строка со смещением y получила окончательную полуширину x
+                if(x != y){
+                    SetSpan(imageBuffer, left - x, right + x, top - y, color, safeChecks);
+                    SetSpan(imageBuffer, left - x, right + x, bottom + y, color, safeChecks);
+                }
+                delta += 2 * (x - y) + 5;
+                y--;
+            }
+
+            x++;
+        }
+    }
+
+    /**
+     * Растеризация закрашенного круга в буфере изображения (алгоритм средней точки, заливка спанами)
+     * @tparam T Тип пикселей в буфере изображения
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x1 Координаты точки центра круга по X
+     * @param y1 Координаты точки центра круга по Y
+     * @param r Радиус
+     * @param color Цвет круга
+     * @param safeChecks Осуществлять проверку на выход за пределы
+     */
+    template<typename T>
+    void SetCircleFilled(ImageBuffer<T>* imageBuffer,
+                         int x1, int y1, int r,
+                         const T& color,
+                         std::uint_fast8_t safeChecks = SAFE_CHECK_KEY_POINTS)
+    {
+        if(safeChecks & SAFE_CHECK_KEY_POINTS){
+            if(!imageBuffer->isPointIn(x1+r,y1)) return;
+            if(!imageBuffer->isPointIn(x1-r,y1)) return;
+            if(!imageBuffer->isPointIn(x1,y1+r)) return;
+            if(!imageBuffer->isPointIn(x1,y1-r)) return;
+        }
+
+        SetRoundedSpans(imageBuffer, x1, y1, x1, y1, std::max(r, 0), color, safeChecks & SAFE_CHECK_ALL_POINTS);
+    }
+
+    /**
+     * Растеризация закрашенного эллипса в буфере изображения (заливка спанами)
+     * @details Закрашиваются ровно те пиксели, для которых x²/rx² + y²/ry² <= 1 (смещения от центра).
+     * Полуширина строки вычисляется в целых числах и только уменьшается при удалении от центра, поэтому
+     * на весь эллипс приходится O(rx + ry) проверок. Вырожденные эллипсы (rx == 0 или ry == 0) - отрезки
+     * @tparam T Тип пикселей в буфере изображения
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x1 Координаты точки центра эллипса по X
+     * @param y1 Координаты точки центра эллипса по Y
+     * @param rx Радиус по оси X
+     * @param ry Радиус по оси Y
+     * @param color Цвет эллипса
+     * @param safeChecks Осуществлять проверку на выход за пределы
+     */
+    template<typename T>
+    void SetEllipseFilled(ImageBuffer<T>* imageBuffer,
+                          int x1, int y1, int rx, int ry,
+                          const T& color,
+                          std::uint_fast8_t safeChecks = SAFE_CHECK_KEY_POINTS)
+    {
+        if(rx < 0 || ry < 0) return;
+
+        if(safeChecks & SAFE_CHECK_KEY_POINTS){
+            if(!imageBuffer->isPointIn(x1+rx,y1)) return;
+            if(!imageBuffer->isPointIn(x1-rx,y1)) return;
+            if(!imageBuffer->isPointIn(x1,y1+ry)) return;
+            if(!imageBuffer->isPointIn(x1,y1-ry)) return;
+        }
+
+        bool check = safeChecks & SAFE_CHECK_ALL_POINTS;
+
+        // Вырожденный по Y эллипс - горизонтальный отрезок
+        if(ry == 0){
+            SetSpan(imageBuffer, x1 - rx, x1 + rx, y1, color, check);
+            return;
+        }
+
+        // Вырожденный по X эллипс - вертикальный отрезок (спаны шириной в один пиксель)
+        if(rx == 0){
+            for(int y = -ry; y <= ry; y++) SetSpan(imageBuffer, x1, x1, y1 + y, color, check);
+            return;
+        }
+
+        // Условие x²/rx² + y²/ry² <= 1, умноженное на rx²·ry²: x²·ry² <= rx²·(ry² - y²)
+        const long long rx2 = static_cast<long long>(rx) * rx;
+        const long long ry2 = static_cast<long long>(ry) * ry;
+
+        int x = rx;
+        for(int y = 0; y <= ry; y++)
+        {
+            // Полуширина строки - наибольший x, удовлетворяющий условию (не больше полуширины предыдущей строки)
+            const long long rowLimit = rx2 * (ry2 - static_cast<long long>(y) * y);
+            while (x > 0 && static_cast<long long>(x) * x * ry2 > rowLimit) x--;
+
+            SetSpan(imageBuffer, x1 - x, x1 + x, y1 + y, color, check);
+            if(y != 0) SetSpan(imageBuffer, x1 - x, x1 + x, y1 - y, color, check);
+        }
+    }
+
     /**
      * Растеризация контуров прямоугольника в буфере изображения
      * @tparam T Тип пикселей в буфере изображения
@@ -246,6 +449,41 @@ namespace gfx
         SetBox(imageBuffer,x0,y0,x0+width,y0+height,color,safeChecks);
     }
 
+    /**
+     * Растеризация закрашенного прямоугольника со скругленными углами в буфере изображения (заливка спанами)
+     * @tparam T Тип пикселей в буфере изображения
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x0 Координаты верхней левой точки по X
+     * @param y0 Координаты верхней левой точки по Y
+     * @param width Ширина
+     * @param height Высота
+     * @param r Радиус скругления углов (ограничивается половиной меньшей стороны)
+     * @param color Цвет заливки
+     * @param safeChecks Осуществлять проверку на выход за пределы
+     */
+    template<typename T>
+    void SetRoundedRectangleFilled(ImageBuffer<T>* imageBuffer,
+                                   int x0, int y0,
+                                   int width, int height,
+                                   int r,
+                                   const T& color,
+                                   std::uint_fast8_t safeChecks = SAFE_CHECK_KEY_POINTS)
+    {
+        if(width < 0 || height < 0) return;
+
+        if(safeChecks & SAFE_CHECK_KEY_POINTS){
+            if(!imageBuffer->isPointIn(x0,y0)) return;
+            if(!imageBuffer->isPointIn(x0+width,y0+height)) return;
+        }
+
+        r = std::max(0, std::min(r, std::min(width, height) / 2));
+
+        SetRoundedSpans(imageBuffer,
+                x0 + r, y0 + r,
+                x0 + width - r, y0 + height - r,
+                r, color, safeChecks & SAFE_CHECK_ALL_POINTS);
+    }
+
     /**
      * Заливка фрагмента буфера ограниченного контукром отличным от сцвета фона
      * @tparam T Тип пикселей в буфере изображения
@@ -280,21 +518,36 @@ namespace gfx
     /**
      * Нахождение описывающего прямоугольника
      * @tparam T Тип компонентов точек
-     * @param points Массив точек
+     * @param points Указатель на массив точек
+     * @param count Кол-во точек (больше 0)
      * @return Описывающий прямоугольник (строкутура из двух точек)
      */
     template <typename T>
-    BBox2D<T> FindBoundingBox2D(std::vector<Point2D<T>> points)
+    BBox2D<T> FindBoundingBox2D(const Point2D<T>* points, size_t count)
     {
-        BBox2D<T> result;
-        result.min.x = std::min_element(points.begin(), points.end(), [](Point2D<T> elem1, Point2D<T> elem2) {return elem1.x < elem2.x; })->x;
-        result.min.y = std::min_element(points.begin(), points.end(), [](Point2D<T> elem1, Point2D<T> elem2) {return elem1.y < elem2.y; })->y;
-
-        result.max.x = std::max_element(points.begin(), points.end(), [](Point2D<T> elem1, Point2D<T> elem2) {return elem1.x < elem2.x; })->x;
-        result.max.y = std::max_element(points.begin(), points.end(), [](Point2D<T> elem1, Point2D<T> elem2) {return elem1.y < elem2.y; })->y;
+        BBox2D<T> result = {points[0], points[0]};
+        for(size_t i = 1; i < count; i++)
+        {
+            result.min.x = std::min(result.min.x, points[i].x);
+            result.min.y = std::min(result.min.y, points[i].y);
+            result.max.x = std::max(result.max.x, points[i].x);
+            result.max.y = std::max(result.max.y, points[i].y);
+        }
         return result;
     }
 
+    /**
+     * Нахождение описывающего прямоугольника
+     * @tparam T Тип компонентов точек
+     * @param points Массив точек (не пустой)
+     * @return Описывающий прямоугольник (строкутура из двух точек)
+     */
+    template <typename T>
+    BBox2D<T> FindBoundingBox2D(const std::vector<Point2D<T>>& points)
+    {
+        return FindBoundingBox2D(points.data(), points.size());
+    }
+
     /**
      * Находится ли точка внутри треугольника
      * @tparam T Тип компонентов точки
@@ -319,6 +572,70 @@ namespace gfx
         return (aSide >= 0 && bSide >= 0 && cSide >= 0) || (aSide < 0 && bSide < 0 && cSide < 0);
     }
 
+    namespace detail
+    {
+        /**
+         * Индекс младшего установленного бита (последовательность де Брейна)
+         * @param value Значение (не 0)
+         * @return Индекс бита [0, 63]
+         */
+        inline int LowestBitIndex(std::uint64_t value)
+        {
+            static const int DE_BRUIJN_INDEX[64] = {
+                    0,  1,  2, 53,  3,  7, 54, 27,  4, 38, 41,  8, 34, 55, 48, 28,
+                    62,  5, 39, 46, 44, 42, 22,  9, 24, 35, 59, 56, 49, 18, 29, 11,
+                    63, 52,  6, 26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10,
+                    51, 25, 36, 32, 60, 20, 57, 16, 50, 31, 19, 15, 30, 14, 13, 12
+            };
+            return DE_BRUIJN_INDEX[((value & (0 - value)) * 0x022FDD63CC95386DULL) >> 58];
+        }
+
+        /**
+         * Отметить пиксели отрезка в маске покрытия 8x8 (тот же алгоритм Брезенхэма, что и в SetLine)
+         * @param mask Маска (бит (y * 8 + x) - пиксель x,y относительно начала маски)
+         * @param x0 Координаты точки начала по X (относительно начала маски)
+         * @param y0 Координаты точки начала по Y
+         * @param x1 Координаты точки конца по X
+         * @param y1 Координаты точки конца по Y
+         */
+        inline void SetLineMask8x8(std::uint64_t* mask, int x0, int y0, int x1, int y1)
+        {
+            const bool axisSwapped = std::abs(x1 - x0) < std::abs(y1 - y0);
+            if(axisSwapped){
+                std::swap(x0,y0);
+                std::swap(x1,y1);
+            }
+
+            const int deltaX = std::abs(x1 - x0);
+            const int deltaY = std::abs(y1 - y0);
+
+            if(x0 > x1){
+                std::swap(x0, x1);
+                std::swap(y0, y1);
+            }
+
+            int error = 0;
+            const int deltaErr = deltaY + 1;
+            const int dirY = (y1 > y0) - (y1 < y0);
+
+            // Шаг по X и по Y в индексах маски (с учетом перестановки осей)
+            const int stepX = axisSwapped ? 8 : 1;
+            const int stepY = axisSwapped ? dirY : dirY * 8;
+            int index = axisSwapped ? (x0 * 8 + y0) : (y0 * 8 + x0);
+
+            for(int x = x0; x <= x1; x++, index += stepX)
+            {
+                *mask |= std::uint64_t(1) << index;
+
+                // Шаг по Y без ветвления (направление ошибки непредсказуемо)
+                error += deltaErr;
+                const int step = -static_cast<int>(error >= (deltaX + 1));
+                index += stepY & step;
+                error -= (deltaX + 1) & step;
+            }
+        }
+    }
+
     /**
      * Растеризация треугольника в буфере изображения
      * @tparam T Тип пикселей в буфере изображения
@@ -349,6 +666,69 @@ namespace gfx
             if(!imageBuffer->isPointIn(x2,y2)) return;
         }
 
+        // Описывающий прямоугольник (без выделения памяти)
+        const int minX = std::min(x0, std::min(x1, x2));
+        const int minY = std::min(y0, std::min(y1, y2));
+        const int maxX = std::max(x0, std::max(x1, x2));
+        const int maxY = std::max(y0, std::max(y1, y2));
+
+        // Мелкий треугольник - контур и заливка собираются в 64-битную маску покрытия, затем пиксели пишутся один раз
+        // (одна проверка границ на весь прямоугольник, без вызовов SetLine/SetPint на каждый пиксель)
+        if(maxX - minX < 8 && maxY - minY < 8)
+        {
+#ifdef GFX_TRIANGLE_STATS
+            GetTriangleStats().microTriangles++;
+#endif
+
+            std::uint64_t mask = 0;
+            detail::SetLineMask8x8(&mask, x0 - minX, y0 - minY, x1 - minX, y1 - minY);
+            detail::SetLineMask8x8(&mask, x1 - minX, y1 - minY, x2 - minX, y2 - minY);
+            detail::SetLineMask8x8(&mask, x2 - minX, y2 - minY, x0 - minX, y0 - minY);
+
+            if(fill)
+            {
+                // Функции ребер те же, что в IsPointInTriangle, но считаются приращениями
+                const int aX = y0 - y1, aY = x1 - x0, aC = x0 * y1 - x1 * y0;
+                const int bX = y1 - y2, bY = x2 - x1, bC = x1 * y2 - x2 * y1;
+                const int cX = y2 - y0, cY = x0 - x2, cC = x2 * y0 - x0 * y2;
+
+                for(int y = minY; y < maxY; y++)
+                {
+                    int aSide = aX * minX + aY * y + aC;
+                    int bSide = bX * minX + bY * y + bC;
+                    int cSide = cX * minX + cY * y + cC;
+
+                    // Все три функции одного знака <=> знаковый бит у (a | b | c) и у (a & b & c) совпадает
+                    std::uint64_t bit = std::uint64_t(1) << ((y - minY) * 8);
+                    for(int x = minX; x < maxX; x++, bit <<= 1)
+                    {
+                        const bool inside = ((aSide | bSide | cSide) >= 0) | ((aSide & bSide & cSide) < 0);
+                        mask |= inside ? bit : 0;
+                        aSide += aX;
+                        bSide += bX;
+                        cSide += cX;
+                    }
+                }
+            }
+
+            const bool check = (safeChecks & SAFE_CHECK_ALL_POINTS) &&
+                    !(imageBuffer->isPointIn(minX, minY) && imageBuffer->isPointIn(maxX, maxY));
+
+            // Обход только установленных битов (без ветвления на каждый пиксель прямоугольника)
+            while(mask != 0)
+            {
+                const int index = detail::LowestBitIndex(mask);
+                SetPint(imageBuffer, minX + (index & 7), minY + (index >> 3), color, check);
+                mask &= mask - 1;
+            }
+
+            return;
+        }
+
+#ifdef GFX_TRIANGLE_STATS
+        GetTriangleStats().regularTriangles++;
+#endif
+
         // Написовать линии
         SetLine(imageBuffer,x0,y0,x1,y1,color,safeChecks);
         SetLine(imageBuffer,x1,y1,x2,y2,color,safeChecks);
@@ -357,13 +737,10 @@ namespace gfx
         // Если не надо закрашивать - завершаем
         if(!fill) return;
 
-        // Получить описывающий прямоугольник
-        auto bbox = FindBoundingBox2D<int>({{x0,y0},{x1,y1},{x2,y2}});
-
         // Пройтись по точкам прямугольника, и если точни принадлежат треугольнику - закрасить их
-        for(int y = bbox.min.y; y < bbox.max.y; y++)
+        for(int y = minY; y < maxY; y++)
         {
-            for(int x = bbox.min.x; x < bbox.max.x; x++)
+            for(int x = minX; x < maxX; x++)
             {
                 if(IsPointInTriangle<int>({x,y},{x0,y0},{x1,y1},{x2,y2}))
                 {
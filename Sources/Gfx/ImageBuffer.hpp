@@ -1,5 +1,11 @@
 #pragma once
 #include <algorithm>
+#include <cstring>
+
+#if !defined(GFX_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define GFX_SIMD_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace gfx
 {
@@ -42,7 +48,10 @@ namespace gfx
          * Вызывается при инициализации объекта другим объектом (присвоение во веремя создания - этот же случай)
          * @param other Копируемый объекь
          */
-        ImageBuffer(const ImageBuffer& other): ImageBuffer(other.width_, other.height_)
+        ImageBuffer(const ImageBuffer& other):
+                width_(other.width_),
+                height_(other.height_),
+                data_((other.width_ * other.height_) > 0 ? new T[other.width_ * other.height_] : nullptr)
         {
             if (other.data_)
             {
@@ -199,5 +208,33 @@ namespace gfx
                 static_cast<unsigned>(y) <= (this->getHeight()-1) && static_cast<unsigned>(y) >= 0;
         }
     };
-}
 
+    /**
+     * Набор значений одного пикселя для мульти-сэмплинга (по значению на каждый сэмпл)
+     * @tparam T Тип значения одного сэмпла (цвет или глубина)
+     * @tparam SAMPLES Количество сэмплов на пиксель
+     */
+    template<typename T, unsigned SAMPLES = 4>
+    struct Multisample
+    {
+        T samples[SAMPLES];
+
+        /**
+         * Получить набор, где все сэмплы имеют одно значение (например для очистки буфера)
+         * @param value Значение
+         * @return Набор сэмплов
+         */
+        static Multisample filled(const T& value)
+        {
+            Multisample result;
+            std::fill_n(result.samples, SAMPLES, value);
+            return result;
+        }
+    };
+
+    /**
+     * Буфер изображения с несколькими сэмплами на пиксель (MSAA)
+     */
+    template<typename T, unsigned SAMPLES = 4>
+    using MultisampleImageBuffer = ImageBuffer<Multisample<T, SAMPLES>>;
+}
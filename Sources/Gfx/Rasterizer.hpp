@@ -2,12 +2,20 @@
 
 #include "ImageBuffer.hpp"
 
+#include <cmath>
+#include <cstdint>
 #include <functional>
 #include <vector>
 
 namespace gfx
 {
-
+    /**
+     * Растеризатор треугольников с программируемым конвейером (вершинный и фрагментный шейдеры)
+     * @details Тип вершины должен поддерживать операции VERTEX * float и VERTEX + VERTEX (для интерполяции)
+     * @tparam VERTEX Тип вершины (и данных передаваемых из вершинного шейдера во фрагментный)
+     * @tparam COLOR Тип пикселей буфера цвета
+     * @tparam DEPTH Тип значений буфера глубины
+     */
     template <typename VERTEX, typename COLOR, typename DEPTH>
     class Rasterizer
     {
@@ -26,21 +34,85 @@ namespace gfx
             float w;
         };
 
+        /// Кол-во сэмплов на пиксель в режиме MSAA
+        static constexpr unsigned MSAA_SAMPLES = 4;
+
+        /// Размер кэша обработанных вершин (DrawIndexed)
+        static constexpr unsigned VERTEX_CACHE_SIZE = 16;
+
+        /// Кол-во бит дробной части координат вершин на экране (точность привязки к подпиксельной сетке)
+        static constexpr unsigned SUBPIXEL_BITS = 8;
+        /// Кол-во подпикселей на пиксель
+        static constexpr std::int64_t SUBPIXEL_SCALE = std::int64_t(1) << SUBPIXEL_BITS;
+        /// Предел координат в подпикселях (произведения в функциях ребер не переполняют 64 бита)
+        static constexpr std::int64_t SUBPIXEL_COORD_LIMIT = std::int64_t(1) << 29;
+
     private:
+        /**
+         * Вершина после вершинного шейдера и перевода в координаты экрана
+         */
+        struct ScreenVertex
+        {
+            float x;
+            float y;
+            float z;
+            float invW;
+            VERTEX varyings;
+        };
+
         /// Указатель на буфер цвета
         ImageBuffer<COLOR>* pColorBuffer_;
         /// Указатель на буфер глубины
         ImageBuffer<DEPTH>* pDepthBuffer_;
+        /// Указатель на мульти-сэмпловый буфер цвета (режим MSAA)
+        MultisampleImageBuffer<COLOR, MSAA_SAMPLES>* pColorBufferMs_;
+        /// Указатель на мульти-сэмпловый буфер глубины (режим MSAA)
+        MultisampleImageBuffer<DEPTH, MSAA_SAMPLES>* pDepthBufferMs_;
         /// Как описывается передняя грань
         FrontFace frontFace_;
         /// Отсечение задних граней
         bool backFaceCooling_;
+        /// Кол-во вызовов вершинного шейдера
+        size_t vertexShaderInvocations_;
 
         /// Функция - вершинный шейдер
         std::function<VERTEX(const VERTEX& vertex, Vec4* outPosition)> vertexShaderFn_;
 
         /// Функция - фрагментный шейдер
         std::function<COLOR(const VERTEX& interpolatedVertexInfo)> fragmentShaderFn_;
+
+        /**
+         * Смещения сэмплов относительно центра пикселя (повернутая сетка 4x, как в D3D)
+         * @param index Индекс сэмпла
+         * @param ox Смещение по X
+         * @param oy Смещение по Y
+         */
+        static void getSampleOffset(unsigned index, float* ox, float* oy)
+        {
+            static const float offsets[MSAA_SAMPLES][2] = {
+                    {-2.0f / 16.0f, -6.0f / 16.0f},
+                    { 6.0f / 16.0f, -2.0f / 16.0f},
+                    {-6.0f / 16.0f,  2.0f / 16.0f},
+                    { 2.0f / 16.0f,  6.0f / 16.0f}
+            };
+
+            *ox = offsets[index][0];
+            *oy = offsets[index][1];
+        }
+
+        /**
+         * Проверка значения функции ребра с учетом правила заполнения
+         * @details Ребро общее для двух треугольников обходится ими в противоположных направлениях,
+         * поэтому точки лежащие на ребре достаются ровно одному из них
+         * @param w Значение функции ребра
+         * @param tieIncluded Включать ли точки лежащие на ребре
+         * @return Точка с внутренней стороны ребра
+         */
+        static bool isInside(std::int64_t w, bool tieIncluded)
+        {
+            return w > 0 || (w == 0 && tieIncluded);
+        }
+
     public:
         /**
          * Конструктор по умолчанию
@@ -48,8 +120,11 @@ namespace gfx
         Rasterizer():
                 pColorBuffer_(nullptr),
                 pDepthBuffer_(nullptr),
+                pColorBufferMs_(nullptr),
+                pDepthBufferMs_(nullptr),
                 frontFace_(FrontFace::eClockWise),
-                backFaceCooling_(true)
+                backFaceCooling_(true),
+                vertexShaderInvocations_(0)
         {}
 
         /**
@@ -65,13 +140,404 @@ namespace gfx
                    bool backFaceCooling = true):
                 pColorBuffer_(pColorBuffer),
                 pDepthBuffer_(pDepthBuffer),
+                pColorBufferMs_(nullptr),
+                pDepthBufferMs_(nullptr),
+                frontFace_(frontFace),
+                backFaceCooling_(backFaceCooling),
+                vertexShaderInvocations_(0)
+        {}
+
+        /**
+         * Конструктор для режима MSAA
+         * @details Покрытие вычисляется в 4 сэмплах на пиксель, фрагментный шейдер выполняется один раз на пиксель,
+         * цвет и глубина хранятся для каждого сэмпла. Для показа кадра используется ResolveMultisample
+         * @param pColorBufferMs Указатель на мульти-сэмпловый буфер цвета
+         * @param pDepthBufferMs Указатель на мульти-сэмпловый буфер глубины
+         * @param frontFace Как описывается передняя грань
+         * @param backFaceCooling Отсечение задних граней
+         */
+        Rasterizer(MultisampleImageBuffer<COLOR, MSAA_SAMPLES>* pColorBufferMs,
+                   MultisampleImageBuffer<DEPTH, MSAA_SAMPLES>* pDepthBufferMs,
+                   FrontFace frontFace = FrontFace::eClockWise,
+                   bool backFaceCooling = true):
+                pColorBuffer_(nullptr),
+                pDepthBuffer_(nullptr),
+                pColorBufferMs_(pColorBufferMs),
+                pDepthBufferMs_(pDepthBufferMs),
                 frontFace_(frontFace),
-                backFaceCooling_(backFaceCooling)
+                backFaceCooling_(backFaceCooling),
+                vertexShaderInvocations_(0)
         {}
 
+        /**
+         * Установить вершинный шейдер
+         * @param fn Функция (вершина на входе, положение в clip-пространстве на выходе, возвращает данные для интерполяции)
+         */
+        void setVertexShader(const std::function<VERTEX(const VERTEX& vertex, Vec4* outPosition)>& fn)
+        {
+            vertexShaderFn_ = fn;
+        }
+
+        /**
+         * Установить фрагментный шейдер
+         * @param fn Функция (интерполированные данные вершин на входе, цвет на выходе)
+         */
+        void setFragmentShader(const std::function<COLOR(const VERTEX& interpolatedVertexInfo)>& fn)
+        {
+            fragmentShaderFn_ = fn;
+        }
+
+        /**
+         * Используется ли режим MSAA
+         * @return Да или нет
+         */
+        [[nodiscard]] bool isMultisampled() const
+        {
+            return pColorBufferMs_ != nullptr;
+        }
+
+        /**
+         * Растеризация треугольника
+         * @details Треугольники, вершины которых находятся за наблюдателем (w <= 0) или дальше SUBPIXEL_COORD_LIMIT
+         * подпикселей от начала экрана, отбрасываются целиком (без отсечения)
+         * @param v0 Вершина 0
+         * @param v1 Вершина 1
+         * @param v2 Вершина 2
+         */
         void DrawTriangle(const VERTEX& v0, const VERTEX& v1, const VERTEX& v2)
         {
+            unsigned width, height;
+            if(!getTargetSize(&width, &height)) return;
+
+            ScreenVertex sv[3];
+            if(!transformVertex(v0, width, height, &sv[0]) ||
+               !transformVertex(v1, width, height, &sv[1]) ||
+               !transformVertex(v2, width, height, &sv[2])) return;
+
+            rasterize(sv, width, height);
+        }
+
+        /**
+         * Растеризация индексированного списка треугольников
+         * @details Результаты вершинного шейдера хранятся в FIFO-кэше на VERTEX_CACHE_SIZE вершин, повторно используемые
+         * вершины из кэша не обрабатываются шейдером заново. Чем лучше порядок индексов (см. OptimizeVertexCache),
+         * тем меньше вызовов шейдера
+         * @tparam INDEX Тип индексов
+         * @param pVertices Массив вершин
+         * @param pIndices Массив индексов (тройки вершин)
+         * @param indexCount Кол-во индексов
+         */
+        template <typename INDEX>
+        void DrawIndexed(const VERTEX* pVertices, const INDEX* pIndices, size_t indexCount)
+        {
+            unsigned width, height;
+            if(!getTargetSize(&width, &height)) return;
+
+            size_t cacheTags[VERTEX_CACHE_SIZE];
+            bool cacheVisible[VERTEX_CACHE_SIZE];
+            ScreenVertex cacheValues[VERTEX_CACHE_SIZE];
+            unsigned cacheNext = 0;
+            for(size_t& tag : cacheTags) tag = SIZE_MAX;
+
+            for(size_t i = 0; i + 3 <= indexCount; i += 3)
+            {
+                ScreenVertex sv[3];
+                bool visible = true;
+
+                for(unsigned j = 0; j < 3; j++)
+                {
+                    const auto index = static_cast<size_t>(pIndices[i + j]);
+
+                    unsigned slot = 0;
+                    while(slot < VERTEX_CACHE_SIZE && cacheTags[slot] != index) slot++;
+
+                    if(slot == VERTEX_CACHE_SIZE)
+                    {
+                        slot = cacheNext;
+                        cacheNext = (cacheNext + 1) % VERTEX_CACHE_SIZE;
+                        cacheTags[slot] = index;
+                        cacheVisible[slot] = transformVertex(pVertices[index], width, height, &cacheValues[slot]);
+                    }
+
+                    visible = visible && cacheVisible[slot];
+                    sv[j] = cacheValues[slot];
+                }
+
+                if(visible) rasterize(sv, width, height);
+            }
+        }
+
+        /**
+         * Получить кол-во вызовов вершинного шейдера
+         * @return Кол-во вызовов с момента создания или последнего сброса
+         */
+        [[nodiscard]] size_t getVertexShaderInvocations() const
+        {
+            return vertexShaderInvocations_;
+        }
+
+        /**
+         * Сбросить счетчик вызовов вершинного шейдера
+         */
+        void resetStatistics()
+        {
+            vertexShaderInvocations_ = 0;
+        }
+
+    private:
+        /**
+         * Получить размеры буфера, в который идет растеризация
+         * @param pWidth Ширина
+         * @param pHeight Высота
+         * @return Растеризация возможна (шейдеры заданы, буфер не пустой)
+         */
+        bool getTargetSize(unsigned* pWidth, unsigned* pHeight) const
+        {
+            if(!vertexShaderFn_ || !fragmentShaderFn_) return false;
+
+            const bool ms = isMultisampled();
+            *pWidth = ms ? pColorBufferMs_->getWidth() : (pColorBuffer_ ? pColorBuffer_->getWidth() : 0);
+            *pHeight = ms ? pColorBufferMs_->getHeight() : (pColorBuffer_ ? pColorBuffer_->getHeight() : 0);
+            return *pWidth != 0 && *pHeight != 0;
+        }
+
+        /**
+         * Вершинный шейдер, перспективное деление и перевод в координаты экрана
+         * @details NDC [-1,1] переводится в [0,width]x[0,height] - края экрана совпадают с краями крайних пикселей,
+         * центр пикселя (x,y) находится в точке (x + 0.5, y + 0.5)
+         * @param vertex Вершина
+         * @param width Ширина буфера
+         * @param height Высота буфера
+         * @param pOut Вершина в координатах экрана
+         * @return Вершина перед наблюдателем (w > 0)
+         */
+        bool transformVertex(const VERTEX& vertex, unsigned width, unsigned height, ScreenVertex* pOut)
+        {
+            vertexShaderInvocations_++;
+
+            Vec4 pos{};
+            pOut->varyings = vertexShaderFn_(vertex, &pos);
+            if(pos.w <= 0.0f) return false;
+
+            pOut->invW = 1.0f / pos.w;
+            pOut->x = ((pos.x * pOut->invW + 1.0f) / 2.0f) * static_cast<float>(width);
+            pOut->y = ((-pos.y * pOut->invW + 1.0f) / 2.0f) * static_cast<float>(height);
+            pOut->z = pos.z * pOut->invW;
+            return true;
+        }
+
+        /**
+         * Растеризация треугольника в координатах экрана
+         * @param sv Вершины (могут быть переставлены)
+         * @param width Ширина буфера
+         * @param height Высота буфера
+         */
+        void rasterize(ScreenVertex sv[3], unsigned width, unsigned height)
+        {
+            const bool ms = isMultisampled();
+
+            // Вершины в фиксированной точке (SUBPIXEL_BITS бит дробной части) - функции ребер считаются точно в целых,
+            // поэтому правило заполнения однозначно для общих ребер и вершин
+            const float limit = static_cast<float>(SUBPIXEL_COORD_LIMIT);
+            std::int64_t vx[3], vy[3];
+            for(unsigned i = 0; i < 3; i++)
+            {
+                const float fx = sv[i].x * static_cast<float>(SUBPIXEL_SCALE);
+                const float fy = sv[i].y * static_cast<float>(SUBPIXEL_SCALE);
+                if(!(std::fabs(fx) < limit && std::fabs(fy) < limit)) return;
+                vx[i] = std::llround(fx);
+                vy[i] = std::llround(fy);
+            }
+
+            // Удвоенная площадь со знаком (положительная - обход по часовой стрелке на экране)
+            std::int64_t area = (vx[1] - vx[0]) * (vy[2] - vy[0]) - (vy[1] - vy[0]) * (vx[2] - vx[0]);
+            if(area == 0) return;
+
+            const bool front = (frontFace_ == FrontFace::eClockWise) == (area > 0);
+            if(backFaceCooling_ && !front) return;
+
+            // Привести к одному направлению обхода, чтобы внутренние точки давали положительные функции ребер
+            if(area < 0){
+                std::swap(sv[1], sv[2]);
+                std::swap(vx[1], vx[2]);
+                std::swap(vy[1], vy[2]);
+                area = -area;
+            }
+
+            // Описывающий прямоугольник по центрам пикселей (с запасом на смещения сэмплов), ограниченный размерами буфера
+            const std::int64_t pad = ms ? SUBPIXEL_SCALE / 2 : 0;
+            auto floorDiv = [](std::int64_t a, std::int64_t b){ return a >= 0 ? a / b : -((-a + b - 1) / b); };
+            const auto firstCenter = [&](std::int64_t v){ return -floorDiv(-(v - pad - SUBPIXEL_SCALE / 2), SUBPIXEL_SCALE); };
+            const auto lastCenter = [&](std::int64_t v){ return floorDiv(v + pad - SUBPIXEL_SCALE / 2, SUBPIXEL_SCALE); };
+            const int minX = static_cast<int>(std::max<std::int64_t>(0, firstCenter(std::min({vx[0], vx[1], vx[2]}))));
+            const int minY = static_cast<int>(std::max<std::int64_t>(0, firstCenter(std::min({vy[0], vy[1], vy[2]}))));
+            const int maxX = static_cast<int>(std::min<std::int64_t>(width - 1, lastCenter(std::max({vx[0], vx[1], vx[2]}))));
+            const int maxY = static_cast<int>(std::min<std::int64_t>(height - 1, lastCenter(std::max({vy[0], vy[1], vy[2]}))));
+            if(minX > maxX || minY > maxY) return;
+
+            // Функции ребер w_i(p) = a_i * p.x + b_i * p.y + c_i (ребро напротив вершины i, в единицах подпикселей)
+            std::int64_t ea[3], eb[3], ec[3];
+            bool tie[3];
+            for(unsigned i = 0; i < 3; i++)
+            {
+                const unsigned a = (i + 1) % 3;
+                const unsigned b = (i + 2) % 3;
+                const std::int64_t dx = vx[b] - vx[a];
+                const std::int64_t dy = vy[b] - vy[a];
+
+                ea[i] = -dy;
+                eb[i] = dx;
+                ec[i] = dy * vx[a] - dx * vy[a];
+                tie[i] = dy > 0 || (dy == 0 && dx > 0);
+            }
+
+            // Глубина линейна в пространстве экрана - плоскость глубины (приращения на пиксель)
+            const float invArea = 1.0f / static_cast<float>(area);
+            const float scale = static_cast<float>(SUBPIXEL_SCALE) * invArea;
+            const float dzdx = (static_cast<float>(ea[0]) * sv[0].z + static_cast<float>(ea[1]) * sv[1].z + static_cast<float>(ea[2]) * sv[2].z) * scale;
+            const float dzdy = (static_cast<float>(eb[0]) * sv[0].z + static_cast<float>(eb[1]) * sv[1].z + static_cast<float>(eb[2]) * sv[2].z) * scale;
+
+            for(int y = minY; y <= maxY; y++)
+            {
+                const std::int64_t py = static_cast<std::int64_t>(y) * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2;
+
+                for(int x = minX; x <= maxX; x++)
+                {
+                    const std::int64_t px = static_cast<std::int64_t>(x) * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2;
+
+                    // Значения функций ребер в центре пикселя
+                    std::int64_t wi[3];
+                    float w[3];
+                    for(unsigned i = 0; i < 3; i++){
+                        wi[i] = ea[i] * px + eb[i] * py + ec[i];
+                        w[i] = static_cast<float>(wi[i]);
+                    }
+
+                    const float zc = (w[0] * sv[0].z + w[1] * sv[1].z + w[2] * sv[2].z) * invArea;
+
+                    // Маска покрытых сэмплов, прошедших тест глубины
+                    unsigned mask = 0;
+
+                    if(!ms)
+                    {
+                        if(!isInside(wi[0], tie[0]) || !isInside(wi[1], tie[1]) || !isInside(wi[2], tie[2])) continue;
+                        if(zc < 0.0f || zc > 1.0f) continue;
+                        if(pDepthBuffer_ != nullptr && !(static_cast<DEPTH>(zc) < (*pDepthBuffer_)[y][x])) continue;
+                        mask = 1;
+                    }
+                    else
+                    {
+                        Multisample<DEPTH, MSAA_SAMPLES>* depthSamples = pDepthBufferMs_ != nullptr ? &(*pDepthBufferMs_)[y][x] : nullptr;
+
+                        for(unsigned s = 0; s < MSAA_SAMPLES; s++)
+                        {
+                            float ox, oy;
+                            getSampleOffset(s, &ox, &oy);
+
+                            // Смещения сэмплов кратны 1/16 пикселя - точно представимы в подпикселях
+                            const auto sox = static_cast<std::int64_t>(ox * static_cast<float>(SUBPIXEL_SCALE));
+                            const auto soy = static_cast<std::int64_t>(oy * static_cast<float>(SUBPIXEL_SCALE));
+
+                            bool covered = true;
+                            for(unsigned i = 0; i < 3 && covered; i++){
+                                covered = isInside(wi[i] + ea[i] * sox + eb[i] * soy, tie[i]);
+                            }
+                            if(!covered) continue;
+
+                            const float zs = zc + dzdx * ox + dzdy * oy;
+                            if(zs < 0.0f || zs > 1.0f) continue;
+                            if(depthSamples != nullptr && !(static_cast<DEPTH>(zs) < depthSamples->samples[s])) continue;
+
+                            mask |= (1u << s);
+                        }
+
+                        if(mask == 0) continue;
+                    }
+
+                    // Перспективно-корректные барицентрические координаты (в центре пикселя)
+                    float b0 = w[0] * sv[0].invW;
+                    float b1 = w[1] * sv[1].invW;
+                    float b2 = w[2] * sv[2].invW;
+                    const float bSum = b0 + b1 + b2;
+                    if(bSum == 0.0f) continue;
+                    b0 /= bSum; b1 /= bSum; b2 /= bSum;
+
+                    // Фрагментный шейдер выполняется один раз на пиксель (в том числе и в режиме MSAA)
+                    const COLOR color = fragmentShaderFn_(sv[0].varyings * b0 + sv[1].varyings * b1 + sv[2].varyings * b2);
+
+                    if(!ms)
+                    {
+                        (*pColorBuffer_)[y][x] = color;
+                        if(pDepthBuffer_ != nullptr) (*pDepthBuffer_)[y][x] = static_cast<DEPTH>(zc);
+                        continue;
+                    }
+
+                    for(unsigned s = 0; s < MSAA_SAMPLES; s++)
+                    {
+                        if(!(mask & (1u << s))) continue;
+
+                        (*pColorBufferMs_)[y][x].samples[s] = color;
+
+                        if(pDepthBufferMs_ != nullptr){
+                            float ox, oy;
+                            getSampleOffset(s, &ox, &oy);
+                            (*pDepthBufferMs_)[y][x].samples[s] = static_cast<DEPTH>(zc + dzdx * ox + dzdy * oy);
+                        }
+                    }
+                }
+            }
         }
     };
-}
 
+    /**
+     * Сведение (resolve) мульти-сэмплового буфера цвета в обычный буфер для показа
+     * @details Значение пикселя - среднее значение его 4 сэмплов (с округлением) по каждому 8-битному каналу
+     * @tparam T Тип пикселей (4 байта, 8 бит на канал, например RGBQUAD)
+     * @param pSrc Указатель на мульти-сэмпловый буфер
+     * @param pDst Указатель на буфер назначения (такого же размера)
+     */
+    template<typename T>
+    void ResolveMultisample(MultisampleImageBuffer<T, 4>* pSrc, ImageBuffer<T>* pDst)
+    {
+        static_assert(sizeof(T) == 4, "Resolve requires 8-bit 4-channel pixels");
+        static_assert(sizeof(Multisample<T, 4>) == 16, "Unexpected multisample pixel layout");
+
+        if(pSrc->getWidth() != pDst->getWidth() || pSrc->getHeight() != pDst->getHeight()) return;
+
+        const size_t count = static_cast<size_t>(pSrc->getWidth()) * pSrc->getHeight();
+        const auto* src = reinterpret_cast<const std::uint8_t*>(pSrc->getData());
+        auto* dst = reinterpret_cast<std::uint8_t*>(pDst->getData());
+        size_t i = 0;
+
+#ifdef GFX_SIMD_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16(2);
+
+        // Сумма 4 сэмплов одного пикселя по каналам (в младших 4 16-битных ячейках)
+        auto sumSamples = [&](__m128i px) -> __m128i {
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi8(px, zero), _mm_unpackhi_epi8(px, zero));
+            return _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+        };
+
+        // 4 пикселя (64 байта сэмплов) за итерацию
+        for(; i + 4 <= count; i += 4)
+        {
+            const auto* p = reinterpret_cast<const __m128i*>(src + i * 16);
+            __m128i s01 = _mm_unpacklo_epi64(sumSamples(_mm_loadu_si128(p)), sumSamples(_mm_loadu_si128(p + 1)));
+            __m128i s23 = _mm_unpacklo_epi64(sumSamples(_mm_loadu_si128(p + 2)), sumSamples(_mm_loadu_si128(p + 3)));
+            s01 = _mm_srli_epi16(_mm_add_epi16(s01, round), 2);
+            s23 = _mm_srli_epi16(_mm_add_epi16(s23, round), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(s01, s23));
+        }
+#endif
+
+        for(; i < count; i++)
+        {
+            for(unsigned c = 0; c < 4; c++)
+            {
+                const unsigned sum = src[i * 16 + c] + src[i * 16 + 4 + c] + src[i * 16 + 8 + c] + src[i * 16 + 12 + c];
+                dst[i * 4 + c] = static_cast<std::uint8_t>((sum + 2) >> 2u);
+            }
+        }
+    }
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace gfx
+{
+    /**
+     * Очередь отрисовки кадра (sort-middle)
+     * @details Команды собираются за кадр, сортируются по ключу (состояние отрисовки, затем глубина) и передаются
+     * на отрисовку пакетами с одинаковым состоянием. Память переиспользуется между кадрами (clear не освобождает её)
+     * @tparam COMMAND Тип команды отрисовки (например указатель на меш и его трансформация)
+     */
+    template <typename COMMAND>
+    class RenderQueue
+    {
+    public:
+        /**
+         * Порядок сортировки по глубине внутри одного состояния
+         */
+        enum class DepthOrder
+        {
+            /// От ближних к дальним (эффективнее для раннего теста глубины)
+            eFrontToBack,
+            /// От дальних к ближним (алгоритм художника, для прозрачных объектов или отрисовки без буфера глубины)
+            eBackToFront
+        };
+
+    private:
+        /**
+         * Элемент сортировки
+         */
+        struct Entry
+        {
+            /// Ключ: старшие 32 бита - состояние, младшие 32 - глубина
+            std::uint64_t key;
+            /// Индекс команды
+            std::uint32_t index;
+        };
+
+        /// Команды в порядке добавления
+        std::vector<COMMAND> commands_;
+        /// Команды в порядке отрисовки (после сортировки)
+        std::vector<COMMAND> sortedCommands_;
+        /// Ключи сортировки
+        std::vector<Entry> entries_;
+        /// Временный буфер для поразрядной сортировки
+        std::vector<Entry> entriesTemp_;
+        /// Порядок сортировки по глубине
+        DepthOrder depthOrder_;
+        /// Отсортирована ли очередь
+        bool sorted_;
+
+        /**
+         * Перевод глубины в ключ, сохраняющий порядок при сравнении как целых чисел
+         * @param depth Глубина (расстояние до наблюдателя, отрицательные значения считаются нулем)
+         * @return 32-битный ключ
+         */
+        std::uint32_t depthToKey(float depth) const
+        {
+            if(!(depth > 0.0f)) depth = 0.0f;
+
+            // Для неотрицательных чисел битовое представление IEEE 754 монотонно
+            std::uint32_t bits;
+            std::memcpy(&bits, &depth, sizeof(bits));
+            return depthOrder_ == DepthOrder::eFrontToBack ? bits : ~bits;
+        }
+
+        /**
+         * Поразрядная (LSD) сортировка ключей по 8 бит, проходы с одинаковым разрядом у всех ключей пропускаются
+         */
+        void radixSort()
+        {
+            entriesTemp_.resize(entries_.size());
+
+            for(unsigned shift = 0; shift < 64; shift += 8)
+            {
+                size_t counts[256] = {};
+                for(const Entry& e : entries_) counts[(e.key >> shift) & 0xFFu]++;
+
+                // Если все ключи имеют одинаковый разряд - проход ничего не меняет
+                if(counts[(entries_[0].key >> shift) & 0xFFu] == entries_.size()) continue;
+
+                size_t offset = 0;
+                for(size_t& c : counts){
+                    size_t n = c;
+                    c = offset;
+                    offset += n;
+                }
+
+                for(const Entry& e : entries_) entriesTemp_[counts[(e.key >> shift) & 0xFFu]++] = e;
+                entries_.swap(entriesTemp_);
+            }
+        }
+
+    public:
+        /**
+         * Конструктор
+         * @param depthOrder Порядок сортировки по глубине внутри одного состояния
+         * @param reserve Кол-во команд, под которое заранее выделяется память
+         */
+        explicit RenderQueue(DepthOrder depthOrder = DepthOrder::eFrontToBack, size_t reserve = 0):
+                depthOrder_(depthOrder),
+                sorted_(true)
+        {
+            commands_.reserve(reserve);
+            sortedCommands_.reserve(reserve);
+            entries_.reserve(reserve);
+            entriesTemp_.reserve(reserve);
+        }
+
+        /**
+         * Добавить команду отрисовки
+         * @param stateId Идентификатор состояния отрисовки (шейдеры, режимы и т.д.), команды группируются по нему
+         * @param depth Глубина объекта (расстояние до наблюдателя)
+         * @param command Команда
+         */
+        void push(std::uint32_t stateId, float depth, const COMMAND& command)
+        {
+            entries_.push_back({(static_cast<std::uint64_t>(stateId) << 32u) | depthToKey(depth), static_cast<std::uint32_t>(commands_.size())});
+            commands_.push_back(command);
+            sorted_ = false;
+        }
+
+        /**
+         * Очистить очередь (выделенная память сохраняется для следующего кадра)
+         */
+        void clear()
+        {
+            commands_.clear();
+            sortedCommands_.clear();
+            entries_.clear();
+            sorted_ = true;
+        }
+
+        /**
+         * Отсортировать команды по состоянию и глубине
+         */
+        void sort()
+        {
+            if(sorted_) return;
+
+            if(!entries_.empty()) radixSort();
+
+            // Команды переупорядочиваются в непрерывный массив, чтобы пакеты передавались как отрезки
+            sortedCommands_.clear();
+            for(const Entry& e : entries_) sortedCommands_.push_back(commands_[e.index]);
+
+            sorted_ = true;
+        }
+
+        /**
+         * Передать команды на отрисовку пакетами
+         * @details Очередь сортируется при необходимости. Для каждого пакета (непрерывной группы команд с одним состоянием)
+         * сначала вызывается bindState(stateId), затем drawBatch(stateId, commands, count)
+         * @tparam BIND Тип функции установки состояния
+         * @tparam DRAW Тип функции отрисовки пакета
+         * @param bindState Функция установки состояния
+         * @param drawBatch Функция отрисовки пакета
+         */
+        template <typename BIND, typename DRAW>
+        void submit(BIND bindState, DRAW drawBatch)
+        {
+            sort();
+
+            size_t begin = 0;
+            while (begin < entries_.size())
+            {
+                const auto stateId = static_cast<std::uint32_t>(entries_[begin].key >> 32u);
+
+                size_t end = begin + 1;
+                while (end < entries_.size() && static_cast<std::uint32_t>(entries_[end].key >> 32u) == stateId) end++;
+
+                bindState(stateId);
+                drawBatch(stateId, sortedCommands_.data() + begin, end - begin);
+
+                begin = end;
+            }
+        }
+
+        /**
+         * Получить кол-во команд в очереди
+         * @return Целое положительное число
+         */
+        [[nodiscard]] size_t getSize() const
+        {
+            return commands_.size();
+        }
+    };
+}
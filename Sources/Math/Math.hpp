@@ -6,11 +6,25 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <vector>
 #include <algorithm>
 
+#if !defined(MATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MATH_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+#if defined(MATH_SIMD_SSE) && defined(__AVX__)
+#define MATH_SIMD_AVX
+#include <immintrin.h>
+#endif
+
 #define M_PI 3.14159265358979323846  /* pi */
 
+// При объявленном MATH_FAST_MATH повороты, проекции и нормализация используют приближенные функции
+// (FastSinCos, FastRsqrt) вместо стандартных - см. описание погрешностей у этих функций
+
 namespace math
 {
     /**
@@ -22,35 +36,35 @@ namespace math
     {
         T x, y;
 
-        Vec2() noexcept :x(0.0f),y(0.0f){};
-        Vec2(const T& s1, const T& s2) noexcept :x(s1), y(s2) {}
+        constexpr Vec2() noexcept :x(0.0f),y(0.0f){};
+        constexpr Vec2(const T& s1, const T& s2) noexcept :x(s1), y(s2) {}
 
-        Vec2<T> operator*(const T& value) const
+        constexpr Vec2<T> operator*(const T& value) const
         {
             return {this->x * value, this->y * value};
         }
 
-        Vec2<T> operator/(const T& value) const
+        constexpr Vec2<T> operator/(const T& value) const
         {
             return {this->x / value, this->y / value};
         }
 
-        Vec2<T> operator*(const Vec2<T>& other) const
+        constexpr Vec2<T> operator*(const Vec2<T>& other) const
         {
             return {this->x * other.x, this->y * other.y};
         }
 
-        Vec2<T> operator+(const Vec2<T>& other) const
+        constexpr Vec2<T> operator+(const Vec2<T>& other) const
         {
             return {this->x + other.x, this->y + other.y};
         }
 
-        Vec2<T> operator-(const Vec2<T>& other) const
+        constexpr Vec2<T> operator-(const Vec2<T>& other) const
         {
             return {this->x - other.x, this->y - other.y};
         }
 
-        Vec2<T> operator-() const
+        constexpr Vec2<T> operator-() const
         {
             return {-this->x, -this->y};
         }
@@ -67,37 +81,37 @@ namespace math
         union { public: T y, g; };
         union { public: T z, b; };
 
-        Vec3() noexcept :x(0.0f),y(0.0f),z(0.0f){};
-        Vec3(const T& s1, const T& s2, const T& s3) noexcept :x(s1), y(s2), z(s3) {}
+        constexpr Vec3() noexcept :x(0.0f),y(0.0f),z(0.0f){};
+        constexpr Vec3(const T& s1, const T& s2, const T& s3) noexcept :x(s1), y(s2), z(s3) {}
 
-        Vec2<T> getVec2(){return {this->x,this->y};}
+        constexpr Vec2<T> getVec2() const {return {this->x,this->y};}
 
-        Vec3<T> operator*(const T& value) const
+        constexpr Vec3<T> operator*(const T& value) const
         {
             return {this->x * value, this->y * value, this->z * value};
         }
 
-        Vec3<T> operator/(const T& value) const
+        constexpr Vec3<T> operator/(const T& value) const
         {
             return {this->x / value, this->y / value, this->z / value};
         }
 
-        Vec3<T> operator*(const Vec3<T>& other) const
+        constexpr Vec3<T> operator*(const Vec3<T>& other) const
         {
             return {this->x * other.x, this->y * other.y, this->z * other.z};
         }
 
-        Vec3<T> operator+(const Vec3<T>& other) const
+        constexpr Vec3<T> operator+(const Vec3<T>& other) const
         {
             return {this->x + other.x, this->y + other.y, this->z + other.z};
         }
 
-        Vec3<T> operator-(const Vec3<T>& other) const
+        constexpr Vec3<T> operator-(const Vec3<T>& other) const
         {
             return {this->x - other.x, this->y - other.y, this->z - other.z};
         }
 
-        Vec3<T> operator-() const
+        constexpr Vec3<T> operator-() const
         {
             return {-this->x, -this->y, -this->z};
         }
@@ -115,37 +129,37 @@ namespace math
         union { public: T z, b; };
         union { public: T w, a; };
 
-        Vec4() noexcept :x(0.0f),y(0.0f),z(0.0f),w(0.0f){};
-        Vec4(const T& s1, const T& s2, const T& s3, const T& s4) noexcept :x(s1), y(s2), z(s3), w(s4) {}
+        constexpr Vec4() noexcept :x(0.0f),y(0.0f),z(0.0f),w(0.0f){};
+        constexpr Vec4(const T& s1, const T& s2, const T& s3, const T& s4) noexcept :x(s1), y(s2), z(s3), w(s4) {}
 
-        Vec3<T> getVec3(){return {this->x,this->y,this->z};}
+        constexpr Vec3<T> getVec3() const {return {this->x,this->y,this->z};}
 
-        Vec4<T> operator*(const T& value) const
+        constexpr Vec4<T> operator*(const T& value) const
         {
             return {this->x * value, this->y * value, this->z * value, this->w * value};
         }
 
-        Vec4<T> operator/(const T& value) const
+        constexpr Vec4<T> operator/(const T& value) const
         {
             return {this->x / value, this->y / value, this->z / value, this->w / value};
         }
 
-        Vec4<T> operator*(const Vec4<T>& other) const
+        constexpr Vec4<T> operator*(const Vec4<T>& other) const
         {
             return {this->x * other.x, this->y * other.y, this->z * other.z, this->w * other.w};
         }
 
-        Vec4<T> operator+(const Vec4<T>& other) const
+        constexpr Vec4<T> operator+(const Vec4<T>& other) const
         {
             return {this->x + other.x, this->y + other.y, this->z + other.z, this->w + other.w};
         }
 
-        Vec4<T> operator-(const Vec4<T>& other) const
+        constexpr Vec4<T> operator-(const Vec4<T>& other) const
         {
             return {this->x - other.x, this->y - other.y, this->z - other.z, this->w - other.w};
         }
 
-        Vec4<T> operator-() const
+        constexpr Vec4<T> operator-() const
         {
             return {-this->x, -this->y, -this->z, -this->w};
         }
@@ -162,6 +176,149 @@ namespace math
         T max;
     };
 
+    /// Множитель для перевода градусов в радианы (вычисляется в float, без double-арифметики при каждом вызове)
+    constexpr float DEG_TO_RAD = static_cast<float>(M_PI / 180.0);
+
+    /**
+     * Быстрое вычисление синуса и косинуса одновременно (полиномиальное приближение)
+     * @details Угол приводится к [-pi/4, pi/4] с учетом квадранта, затем считаются полиномы 7-й (синус) и 8-й (косинус) степени.
+     * Максимальная абсолютная погрешность - 1e-7 при |angle| < 8192 (std::sin для float - 3.3e-8),
+     * для больших углов растет погрешность приведения
+     * @param angle Угол в радианах
+     * @param outSin Синус
+     * @param outCos Косинус
+     */
+    inline void FastSinCos(float angle, float* outSin, float* outCos)
+    {
+        // Номер четверти и приведение угла (pi/2 разбито на 3 части для точного вычитания)
+        const float q = angle * 0.63661977236758134f;
+        const int j = static_cast<int>(q + (q >= 0.0f ? 0.5f : -0.5f));
+        const auto jf = static_cast<float>(j);
+        const float x = ((angle - jf * 1.5703125f) - jf * 4.837512969970703125e-4f) - jf * 7.54978995489188216e-8f;
+        const float x2 = x * x;
+
+        const float s = x + x * x2 * (-1.6666654611e-1f + x2 * (8.3321608736e-3f + x2 * -1.9515295891e-4f));
+        const float c = 1.0f - 0.5f * x2 + x2 * x2 * (4.166664568298827e-2f + x2 * (-1.388731625493765e-3f + x2 * 2.443315711809948e-5f));
+
+        switch (j & 3)
+        {
+            case 0: *outSin = s; *outCos = c; break;
+            case 1: *outSin = c; *outCos = -s; break;
+            case 2: *outSin = -s; *outCos = -c; break;
+            default: *outSin = -c; *outCos = s; break;
+        }
+    }
+
+    /**
+     * Быстрое вычисление синусов и косинусов массива углов
+     * @details То же приближение, что и у скалярной версии (на границах четвертей результаты могут отличаться на 1 ulp),
+     * SSE - 4 угла за итерацию. Примерно в 5 раз быстрее поэлементных std::sin и std::cos
+     * @param angles Массив углов в радианах
+     * @param count Кол-во углов
+     * @param outSin Массив для синусов (не менее count элементов)
+     * @param outCos Массив для косинусов (не менее count элементов)
+     */
+    inline void FastSinCos(const float* angles, size_t count, float* outSin, float* outCos)
+    {
+        size_t i = 0;
+
+#ifdef MATH_SIMD_SSE
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i two = _mm_set1_epi32(2);
+
+        for(; i + 4 <= count; i += 4)
+        {
+            const __m128 angle = _mm_loadu_ps(angles + i);
+
+            // Округление к ближнему целому (режим округления по умолчанию)
+            const __m128i j = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(0.63661977236758134f)));
+            const __m128 jf = _mm_cvtepi32_ps(j);
+
+            __m128 x = _mm_sub_ps(angle, _mm_mul_ps(jf, _mm_set1_ps(1.5703125f)));
+            x = _mm_sub_ps(x, _mm_mul_ps(jf, _mm_set1_ps(4.837512969970703125e-4f)));
+            x = _mm_sub_ps(x, _mm_mul_ps(jf, _mm_set1_ps(7.54978995489188216e-8f)));
+            const __m128 x2 = _mm_mul_ps(x, x);
+
+            __m128 s = _mm_add_ps(_mm_set1_ps(8.3321608736e-3f), _mm_mul_ps(x2, _mm_set1_ps(-1.9515295891e-4f)));
+            s = _mm_add_ps(_mm_set1_ps(-1.6666654611e-1f), _mm_mul_ps(x2, s));
+            s = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, x2), s));
+
+            __m128 c = _mm_add_ps(_mm_set1_ps(-1.388731625493765e-3f), _mm_mul_ps(x2, _mm_set1_ps(2.443315711809948e-5f)));
+            c = _mm_add_ps(_mm_set1_ps(4.166664568298827e-2f), _mm_mul_ps(x2, c));
+            c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), x2)), _mm_mul_ps(_mm_mul_ps(x2, x2), c));
+
+            // Нечетная четверть - синус и косинус меняются местами, знаки определяются 2-м битом номера четверти
+            const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, one), one));
+            const __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, two), 30));
+            const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, one), two), 30));
+
+            const __m128 rs = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+            const __m128 rc = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+
+            _mm_storeu_ps(outSin + i, _mm_xor_ps(rs, sinSign));
+            _mm_storeu_ps(outCos + i, _mm_xor_ps(rc, cosSign));
+        }
+#endif
+
+        for(; i < count; i++) FastSinCos(angles[i], outSin + i, outCos + i);
+    }
+
+    /**
+     * Быстрое вычисление обратного квадратного корня
+     * @details SSE: аппаратное приближение (12 бит) и одна итерация Ньютона-Рафсона,
+     * максимальная относительная погрешность - 2.5e-7. Без SSE - точное значение
+     * @param x Положительное число
+     * @return Значение 1/sqrt(x)
+     */
+    inline float FastRsqrt(float x)
+    {
+#ifdef MATH_SIMD_SSE
+        const __m128 v = _mm_set_ss(x);
+        const __m128 r = _mm_rsqrt_ss(v);
+        // r * (1.5 - 0.5 * x * r * r)
+        const __m128 nr = _mm_mul_ss(r, _mm_sub_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), v), _mm_mul_ss(r, r))));
+        return _mm_cvtss_f32(nr);
+#else
+        return 1.0f / std::sqrt(x);
+#endif
+    }
+
+    namespace detail
+    {
+        /**
+         * Синус и косинус угла в градусах (быстрые при MATH_FAST_MATH, иначе стандартные)
+         * @param angle Угол в градусах
+         * @param outSin Синус
+         * @param outCos Косинус
+         */
+        inline void SinCosDeg(float angle, float* outSin, float* outCos)
+        {
+#ifdef MATH_FAST_MATH
+            FastSinCos(angle * DEG_TO_RAD, outSin, outCos);
+#else
+            const float angleRad = angle * DEG_TO_RAD;
+            *outSin = std::sin(angleRad);
+            *outCos = std::cos(angleRad);
+#endif
+        }
+
+        /**
+         * Тангенс угла в градусах (быстрый при MATH_FAST_MATH, иначе стандартный)
+         * @param angle Угол в градусах
+         * @return Тангенс
+         */
+        inline float TanDeg(float angle)
+        {
+#ifdef MATH_FAST_MATH
+            float s, c;
+            FastSinCos(angle * DEG_TO_RAD, &s, &c);
+            return s / c;
+#else
+            return std::tan(angle * DEG_TO_RAD);
+#endif
+        }
+    }
+
     /**
      * Длина 2-мерного вектора
      * @tparam T Тип компонентов вектора
@@ -195,9 +352,18 @@ namespace math
     template <typename T = float>
     Vec2<T> Normalize(const Vec2<T>& v)
     {
+#ifdef MATH_FAST_MATH
+        float lenSq = static_cast<float>((v.x * v.x) + (v.y * v.y));
+        if(lenSq > 0){
+            const T inv = static_cast<T>(FastRsqrt(lenSq));
+            return {v.x * inv, v.y * inv};
+        }
+        return {0,0};
+#else
         float len = Length(v);
         if(len > 0) return {v.x / len, v.y / len};
         return {0,0};
+#endif
     }
 
     /**
@@ -209,9 +375,18 @@ namespace math
     template <typename T = float>
     Vec3<T> Normalize(const Vec3<T>& v)
     {
+#ifdef MATH_FAST_MATH
+        float lenSq = static_cast<float>((v.x * v.x) + (v.y * v.y) + (v.z * v.z));
+        if(lenSq > 0){
+            const T inv = static_cast<T>(FastRsqrt(lenSq));
+            return {v.x * inv, v.y * inv, v.z * inv};
+        }
+        return {0,0,0};
+#else
         float len = Length(v);
         if(len > 0) return {v.x / len, v.y / len, v.z / len};
         return {0,0,0};
+#endif
     }
 
     /**
@@ -222,7 +397,7 @@ namespace math
      * @return Произведение
      */
     template <typename T = float>
-    T Dot(const Vec2<T>& v1, const Vec2<T>& v2)
+    constexpr T Dot(const Vec2<T>& v1, const Vec2<T>& v2)
     {
         return (v1.x + v2.x) * (v1.y + v2.y);
     }
@@ -235,7 +410,7 @@ namespace math
      * @return Произведение
      */
     template <typename T = float>
-    T Dot(const Vec3<T>& v1, const Vec3<T>& v2)
+    constexpr T Dot(const Vec3<T>& v1, const Vec3<T>& v2)
     {
         return (v1.x * v2.x) + (v1.y * v2.y) + (v1.z * v2.z);
     }
@@ -248,7 +423,7 @@ namespace math
      * @return Векторное произведение
      */
     template <typename T = float>
-    Vec3<T> Cross(const Vec3<T>& v1, const Vec3<T>& v2)
+    constexpr Vec3<T> Cross(const Vec3<T>& v1, const Vec3<T>& v2)
     {
         return {
             (v1.y * v2.z - v1.z * v2.y),
@@ -265,7 +440,7 @@ namespace math
      * @return Отраженный вектор
      */
     template <typename T = float>
-    Vec3<T> Reflect(const Vec3<T>& v, const Vec3<T>& normal)
+    constexpr Vec3<T> Reflect(const Vec3<T>& v, const Vec3<T>& normal)
     {
         return v - normal * 2.0f * Dot(v, normal);
     }
@@ -296,7 +471,7 @@ namespace math
      * @return Итоговое значение вектора
      */
     template <typename T = float, typename R = float>
-    T Mix(const T& a, const T& b, R ratio)
+    constexpr T Mix(const T& a, const T& b, R ratio)
     {
         return a + ((b - a) * ratio);
     }
@@ -312,26 +487,26 @@ namespace math
 
         Mat2() = default;
 
-        explicit Mat2(T val){
+        explicit constexpr Mat2(T val){
             data[0] = val;
             data[3] = val;
         }
 
-        explicit Mat2(const Vec2<T>& i, const Vec2<T>& j)
+        explicit constexpr Mat2(const Vec2<T>& i, const Vec2<T>& j)
         {
             data[0] = i.x; data[1] = j.x;
             data[2] = i.y; data[3] = j.y;
         }
 
-        const T* row(size_t row) const {
+        constexpr const T* row(size_t row) const {
             return this->data + 2 * row;
         }
 
-        T* operator[](size_t row) {
+        constexpr T* operator[](size_t row) {
             return this->data + 2 * row;
         }
 
-        Mat2<T> operator*(const T& value)
+        constexpr Mat2<T> operator*(const T& value) const
         {
             Mat2<T> result = *this;
             for(T &n : result.data){
@@ -340,7 +515,7 @@ namespace math
             return result;
         }
 
-        Vec2<T> operator*(const Vec2<T>& v) const
+        constexpr Vec2<T> operator*(const Vec2<T>& v) const
         {
             return {
                 data[0] * v.x + data[1] * v.y,
@@ -348,7 +523,7 @@ namespace math
             };
         }
 
-        Mat2 operator*(const Mat2<T>& m) const
+        constexpr Mat2 operator*(const Mat2<T>& m) const
         {
             return Mat2(
                 (*(this) * Vec2<T>(m.data[0],m.data[2])),
@@ -368,28 +543,28 @@ namespace math
 
         Mat3() = default;
 
-        explicit Mat3(T val){
+        explicit constexpr Mat3(T val){
             data[0] = val;
             data[4] = val;
             data[8] = val;
         }
 
-        explicit Mat3(const Vec3<T>& i, const Vec3<T>& j, const Vec3<T>& k)
+        explicit constexpr Mat3(const Vec3<T>& i, const Vec3<T>& j, const Vec3<T>& k)
         {
             data[0] = i.x; data[1] = j.x; data[2] = k.x;
             data[3] = i.y; data[4] = j.y; data[5] = k.y;
             data[6] = i.z; data[7] = j.z; data[8] = k.z;
         }
 
-        const T* row(size_t row) const {
+        constexpr const T* row(size_t row) const {
             return this->data + 3 * row;
         }
 
-        T* operator[](size_t row) {
+        constexpr T* operator[](size_t row) {
             return this->data + 3 * row;
         }
 
-        Mat3<T> operator*(const T& value)
+        constexpr Mat3<T> operator*(const T& value) const
         {
             Mat3<T> result = *this;
             for(T &n : result.data){
@@ -398,7 +573,7 @@ namespace math
             return result;
         }
 
-        Vec3<T> operator*(const Vec3<T>& v) const
+        constexpr Vec3<T> operator*(const Vec3<T>& v) const
         {
             return {
                     data[0] * v.x + data[1] * v.y + data[2] * v.z,
@@ -407,7 +582,7 @@ namespace math
             };
         }
 
-        Mat3 operator*(const Mat3<T>& m) const
+        constexpr Mat3 operator*(const Mat3<T>& m) const
         {
             return Mat3(
                     (*(this) * Vec3<T>(m.data[0],m.data[3],m.data[6])),
@@ -428,14 +603,14 @@ namespace math
 
         Mat4() = default;
 
-        explicit Mat4(T val){
+        explicit constexpr Mat4(T val){
             data[0] = val;
             data[5] = val;
             data[10] = val;
             data[15] = val;
         }
 
-        explicit Mat4(const Vec4<T>& i, const Vec4<T>& j, const Vec4<T>& k, const Vec4<T>& t)
+        explicit constexpr Mat4(const Vec4<T>& i, const Vec4<T>& j, const Vec4<T>& k, const Vec4<T>& t)
         {
             data[0] = i.x; data[1] = j.x; data[2] = k.x; data[3] = t.x;
             data[4] = i.y; data[5] = j.y; data[6] = k.y; data[7] = t.y;
@@ -443,7 +618,7 @@ namespace math
             data[12] = i.w; data[13] = j.w; data[14] = k.w; data[15] = t.w;
         }
 
-        explicit Mat4(const Mat3<T>& m3, const Vec4<T>& t = {0.0f,0.0f,0.0f,1.0f})
+        explicit constexpr Mat4(const Mat3<T>& m3, const Vec4<T>& t = {0.0f,0.0f,0.0f,1.0f})
         {
             data[0] = m3.data[0]; data[1] = m3.data[1]; data[2] = m3.data[2]; data[3] = t.x;
             data[4] = m3.data[3]; data[5] = m3.data[4]; data[6] = m3.data[5]; data[7] = t.y;
@@ -451,15 +626,15 @@ namespace math
             data[12] = 0.0f;      data[13] = 0.0f;      data[14] = 0.0f;      data[15] = t.w;
         }
 
-        const T* row(size_t row) const {
+        constexpr const T* row(size_t row) const {
             return this->data + 4 * row;
         }
 
-        T* operator[](size_t row) {
+        constexpr T* operator[](size_t row) {
             return this->data + 4 * row;
         }
 
-        Mat4<T> operator*(const T& value)
+        constexpr Mat4<T> operator*(const T& value) const
         {
             Mat4<T> result = *this;
             for(T &n : result.data){
@@ -468,24 +643,220 @@ namespace math
             return result;
         }
 
-        Vec4<T> operator*(const Vec4<T>& v) const
+        constexpr Vec4<T> operator*(const Vec4<T>& v) const
+        {
+            return MulConstexpr(*this, v);
+        }
+
+        constexpr Mat4 operator*(const Mat4<T>& m) const
+        {
+            return MulConstexpr(*this, m);
+        }
+    };
+
+    /**
+     * Произведение матрицы 4x4 на вектор (скалярное, пригодно для константных выражений при любом типе ячеек)
+     * @details Для float оператор * может выполняться через SIMD и тогда не constexpr - константы времени компиляции
+     * (например, неподвижные матрицы камеры) вычисляются этой функцией
+     * @tparam T Тип ячеек матрицы
+     * @param m Матрица
+     * @param v Вектор
+     * @return Вектор
+     */
+    template <typename T>
+    constexpr Vec4<T> MulConstexpr(const Mat4<T>& m, const Vec4<T>& v)
+    {
+        return {
+                m.data[0] * v.x + m.data[1] * v.y + m.data[2] * v.z + m.data[3] * v.w,
+                m.data[4] * v.x + m.data[5] * v.y + m.data[6] * v.z + m.data[7] * v.w,
+                m.data[8] * v.x + m.data[9] * v.y + m.data[10] * v.z + m.data[11] * v.w,
+                m.data[12] * v.x + m.data[13] * v.y + m.data[14] * v.z + m.data[15] * v.w,
+        };
+    }
+
+    /**
+     * Произведение матриц 4x4 (скалярное, пригодно для константных выражений при любом типе ячеек)
+     * @tparam T Тип ячеек матриц
+     * @param a Левая матрица
+     * @param b Правая матрица
+     * @return Матрица
+     */
+    template <typename T>
+    constexpr Mat4<T> MulConstexpr(const Mat4<T>& a, const Mat4<T>& b)
+    {
+        // Строка результата - линейная комбинация строк правой матрицы (без временных векторов-столбцов)
+        Mat4<T> result;
+        for(size_t i = 0; i < 4; i++)
+        {
+            const T* row = a.data + 4 * i;
+            T* r = result.data + 4 * i;
+            for(size_t j = 0; j < 4; j++){
+                r[j] = row[0] * b.data[j] + row[1] * b.data[4 + j] + row[2] * b.data[8 + j] + row[3] * b.data[12 + j];
+            }
+        }
+        return result;
+    }
+
+#ifdef MATH_SIMD_SSE
+    /**
+     * Произведение матрицы 4x4 на вектор (SSE)
+     * @details Произведения строк на вектор транспонируются и складываются - 4 скалярных произведения за раз.
+     * Специализации для float (здесь и ниже) не constexpr - в константных выражениях используется MulConstexpr
+     */
+    template <>
+    inline Vec4<float> Mat4<float>::operator*(const Vec4<float>& v) const
+    {
+        const __m128 vv = _mm_setr_ps(v.x, v.y, v.z, v.w);
+
+        __m128 p0 = _mm_mul_ps(_mm_loadu_ps(data), vv);
+        __m128 p1 = _mm_mul_ps(_mm_loadu_ps(data + 4), vv);
+        __m128 p2 = _mm_mul_ps(_mm_loadu_ps(data + 8), vv);
+        __m128 p3 = _mm_mul_ps(_mm_loadu_ps(data + 12), vv);
+        _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+
+        alignas(16) float r[4];
+        _mm_store_ps(r, _mm_add_ps(_mm_add_ps(p0, p1), _mm_add_ps(p2, p3)));
+        return {r[0], r[1], r[2], r[3]};
+    }
+
+    /**
+     * Произведение матриц 4x4 (SSE, с AVX - по 2 строки за итерацию)
+     * @details Строки правой матрицы остаются в регистрах, строка результата - сумма строк с весами из левой матрицы
+     */
+    template <>
+    inline Mat4<float> Mat4<float>::operator*(const Mat4<float>& m) const
+    {
+        Mat4<float> result;
+
+#ifdef MATH_SIMD_AVX
+        const __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.data));
+        const __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.data + 4));
+        const __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.data + 8));
+        const __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.data + 12));
+
+        for(size_t i = 0; i < 16; i += 8)
+        {
+            // Две строки левой матрицы, каждый элемент размножается в пределах своей половины регистра
+            const __m256 a = _mm256_loadu_ps(data + i);
+            __m256 r = _mm256_mul_ps(_mm256_permute_ps(a, 0x00), b0);
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(a, 0x55), b1));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(a, 0xAA), b2));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(a, 0xFF), b3));
+            _mm256_storeu_ps(result.data + i, r);
+        }
+#else
+        const __m128 b0 = _mm_loadu_ps(m.data);
+        const __m128 b1 = _mm_loadu_ps(m.data + 4);
+        const __m128 b2 = _mm_loadu_ps(m.data + 8);
+        const __m128 b3 = _mm_loadu_ps(m.data + 12);
+
+        for(size_t i = 0; i < 16; i += 4)
+        {
+            const float* a = data + i;
+            __m128 r = _mm_mul_ps(_mm_set1_ps(a[0]), b0);
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[1]), b1));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[2]), b2));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[3]), b3));
+            _mm_storeu_ps(result.data + i, r);
+        }
+#endif
+
+        return result;
+    }
+#endif
+
+    /**
+     * Аффинная матрица 3x4 (нижняя строка 0 0 0 1 подразумевается и не хранится)
+     * @details Верхняя часть 3x3 - поворот/масштаб, последний столбец - перенос.
+     * Занимает 12 ячеек вместо 16, произведение двух таких матриц требует 36 умножений вместо 64
+     * @tparam T Тип ячеек матрицы
+     */
+    template <typename T = float>
+    struct AffineMat
+    {
+        T data[12] = {};
+
+        AffineMat() = default;
+
+        explicit constexpr AffineMat(T val){
+            data[0] = val;
+            data[5] = val;
+            data[10] = val;
+        }
+
+        explicit constexpr AffineMat(const Mat3<T>& m3, const Vec3<T>& t = {0.0f,0.0f,0.0f})
+        {
+            data[0] = m3.data[0]; data[1] = m3.data[1]; data[2] = m3.data[2]; data[3] = t.x;
+            data[4] = m3.data[3]; data[5] = m3.data[4]; data[6] = m3.data[5]; data[7] = t.y;
+            data[8] = m3.data[6]; data[9] = m3.data[7]; data[10] = m3.data[8]; data[11] = t.z;
+        }
+
+        /**
+         * Построение из матрицы 4x4 (нижняя строка отбрасывается, матрица должна быть аффинной)
+         * @param m Матрица 4x4
+         */
+        explicit constexpr AffineMat(const Mat4<T>& m)
+        {
+            for(size_t i = 0; i < 12; i++) data[i] = m.data[i];
+        }
+
+        /**
+         * Получить полную матрицу 4x4
+         * @return Матрица 4x4
+         */
+        constexpr Mat4<T> toMat4() const
+        {
+            Mat4<T> result;
+            for(size_t i = 0; i < 12; i++) result.data[i] = data[i];
+            result.data[15] = 1;
+            return result;
+        }
+
+        constexpr const T* row(size_t row) const {
+            return this->data + 4 * row;
+        }
+
+        constexpr T* operator[](size_t row) {
+            return this->data + 4 * row;
+        }
+
+        /**
+         * Трансформация точки (w = 1)
+         * @param p Точка
+         * @return Точка после трансформации
+         */
+        constexpr Vec3<T> operator*(const Vec3<T>& p) const
+        {
+            return {
+                    data[0] * p.x + data[1] * p.y + data[2] * p.z + data[3],
+                    data[4] * p.x + data[5] * p.y + data[6] * p.z + data[7],
+                    data[8] * p.x + data[9] * p.y + data[10] * p.z + data[11]
+            };
+        }
+
+        constexpr Vec4<T> operator*(const Vec4<T>& v) const
         {
             return {
                     data[0] * v.x + data[1] * v.y + data[2] * v.z + data[3] * v.w,
                     data[4] * v.x + data[5] * v.y + data[6] * v.z + data[7] * v.w,
                     data[8] * v.x + data[9] * v.y + data[10] * v.z + data[11] * v.w,
-                    data[12] * v.x + data[13] * v.y + data[14] * v.z + data[15] * v.w,
+                    v.w
             };
         }
 
-        Mat4 operator*(const Mat4<T>& m) const
+        constexpr AffineMat operator*(const AffineMat<T>& m) const
         {
-            return Mat4(
-                    (*(this) * Vec4<T>(m.data[0],m.data[4],m.data[8],m.data[12])),
-                    (*(this) * Vec4<T>(m.data[1],m.data[5],m.data[9],m.data[13])),
-                    (*(this) * Vec4<T>(m.data[2],m.data[6],m.data[10],m.data[14])),
-                    (*(this) * Vec4<T>(m.data[3],m.data[7],m.data[11],m.data[15]))
-            );
+            AffineMat<T> result;
+            for(size_t i = 0; i < 3; i++)
+            {
+                const T* a = this->data + 4 * i;
+                T* r = result.data + 4 * i;
+                for(size_t j = 0; j < 4; j++){
+                    r[j] = a[0] * m.data[j] + a[1] * m.data[4 + j] + a[2] * m.data[8 + j];
+                }
+                r[3] += a[3];
+            }
+            return result;
         }
     };
 
@@ -496,7 +867,7 @@ namespace math
      * @return Транспонированная матрица
      */
     template <typename T = float>
-    Mat2<T> Transpose(const Mat2<T>& m)
+    constexpr Mat2<T> Transpose(const Mat2<T>& m)
     {
         return Mat2<T>(
                 {m.data[0],m.data[1]},
@@ -511,7 +882,7 @@ namespace math
      * @return Транспонированная матрица
      */
     template <typename T = float>
-    Mat3<T> Transpose(const Mat3<T>& m)
+    constexpr Mat3<T> Transpose(const Mat3<T>& m)
     {
         return Mat3<T>(
                 {m.data[0],m.data[1],m.data[2]},
@@ -527,7 +898,7 @@ namespace math
      * @return Транспонированная матрица
      */
     template <typename T = float>
-    Mat4<T> Transpose(const Mat4<T>& m)
+    constexpr Mat4<T> Transpose(const Mat4<T>& m)
     {
         return Mat4<T>(
                 {m.data[0],m.data[1],m.data[2],m.data[3]},
@@ -544,7 +915,7 @@ namespace math
      * @return Значение определителя
      */
     template <typename T = float>
-    T Determinant(const Mat2<T>& m)
+    constexpr T Determinant(const Mat2<T>& m)
     {
         return (m.row(0)[0] * m.row(1)[1]) - (m.row(0)[1] * m.row(1)[0]);
     }
@@ -556,7 +927,7 @@ namespace math
      * @return Значение определителя
      */
     template <typename T = float>
-    T Determinant(const Mat3<T>& m)
+    constexpr T Determinant(const Mat3<T>& m)
     {
         return (m.row(0)[0] * m.row(1)[1] * m.row(2)[2])
                + (m.row(0)[1] * m.row(1)[2] * m.row(2)[0])
@@ -573,7 +944,7 @@ namespace math
      * @return Значение определителя
      */
     template <typename T = float>
-    T Determinant(const Mat4<T>& m)
+    constexpr T Determinant(const Mat4<T>& m)
     {
         return (m.row(0)[0] * Determinant(Mat3<T>({m.row(1)[1],m.row(2)[1],m.row(3)[1]},{m.row(1)[2],m.row(2)[2],m.row(3)[2]},{m.row(1)[3],m.row(2)[3],m.row(3)[3]})))
                - (m.row(0)[1] * Determinant(Mat3<T>({m.row(1)[0],m.row(2)[0],m.row(3)[0]},{m.row(1)[2],m.row(2)[2],m.row(3)[2]},{m.row(1)[3],m.row(2)[3],m.row(3)[3]})))
@@ -589,7 +960,7 @@ namespace math
      * @return Обратная матрица
      */
     template <typename T = float>
-    Mat2<T> Inverse(const Mat2<T>& m)
+    constexpr Mat2<T> Inverse(const Mat2<T>& m)
     {
         Mat2<T> result;
         auto det = Determinant(m);
@@ -608,7 +979,7 @@ namespace math
      * @return Обратная матрица
      */
     template <typename T = float>
-    Mat3<T> Inverse(const Mat3<T>& m)
+    constexpr Mat3<T> Inverse(const Mat3<T>& m)
     {
         Mat3<T> result;
         auto det = Determinant(m);
@@ -636,7 +1007,7 @@ namespace math
      * @return Обратная матрица
      */
     template <typename T = float>
-    Mat4<T> Inverse(const Mat4<T>& m)
+    constexpr Mat4<T> Inverse(const Mat4<T>& m)
     {
         Mat4<T> inv;
 
@@ -759,6 +1130,97 @@ namespace math
         return inv * (1/det);
     }
 
+    /**
+     * Обратная матрица для аффинной матрицы (поворот, масштаб, сдвиг и перенос)
+     * @details Обращается только часть 3x3 (9 миноров), перенос получается как -A^-1 * t
+     * @tparam T Тип ячеек матрицы
+     * @param m Исходная аффинная матрица
+     * @return Обратная матрица (нулевая, если часть 3x3 вырождена)
+     */
+    template <typename T = float>
+    constexpr AffineMat<T> InverseAffine(const AffineMat<T>& m)
+    {
+        const T* d = m.data;
+        AffineMat<T> inv;
+
+        inv.data[0] = d[5] * d[10] - d[6] * d[9];
+        inv.data[1] = d[2] * d[9] - d[1] * d[10];
+        inv.data[2] = d[1] * d[6] - d[2] * d[5];
+        inv.data[4] = d[6] * d[8] - d[4] * d[10];
+        inv.data[5] = d[0] * d[10] - d[2] * d[8];
+        inv.data[6] = d[2] * d[4] - d[0] * d[6];
+        inv.data[8] = d[4] * d[9] - d[5] * d[8];
+        inv.data[9] = d[1] * d[8] - d[0] * d[9];
+        inv.data[10] = d[0] * d[5] - d[1] * d[4];
+
+        auto det = d[0] * inv.data[0] + d[1] * inv.data[4] + d[2] * inv.data[8];
+
+        if (det == 0) return AffineMat<T>();
+
+        T detInverse = 1 / det;
+        for(size_t i = 0; i < 12; i += 4){
+            inv.data[i] *= detInverse;
+            inv.data[i + 1] *= detInverse;
+            inv.data[i + 2] *= detInverse;
+            inv.data[i + 3] = -(inv.data[i] * d[3] + inv.data[i + 1] * d[7] + inv.data[i + 2] * d[11]);
+        }
+
+        return inv;
+    }
+
+    /**
+     * Обратная матрица для аффинной матрицы 4x4 (нижняя строка должна быть 0 0 0 1)
+     * @tparam T Тип ячеек матрицы
+     * @param m Исходная аффинная матрица
+     * @return Обратная матрица (нулевая, включая нижнюю строку, если часть 3x3 вырождена)
+     */
+    template <typename T = float>
+    constexpr Mat4<T> InverseAffine(const Mat4<T>& m)
+    {
+        const AffineMat<T> inv = InverseAffine(AffineMat<T>(m));
+
+        // У невырожденной обратной матрицы строка не может быть нулевой
+        if(inv.data[0] == 0 && inv.data[1] == 0 && inv.data[2] == 0) return Mat4<T>();
+
+        return inv.toMat4();
+    }
+
+    /**
+     * Обратная матрица для трансформации твердого тела (только поворот и перенос)
+     * @details Часть 3x3 ортонормирована, поэтому транспонируется, перенос получается как -R^T * t
+     * @tparam T Тип ячеек матрицы
+     * @param m Исходная матрица (без масштаба и сдвига)
+     * @return Обратная матрица
+     */
+    template <typename T = float>
+    constexpr AffineMat<T> InverseRigid(const AffineMat<T>& m)
+    {
+        const T* d = m.data;
+        AffineMat<T> inv;
+
+        inv.data[0] = d[0]; inv.data[1] = d[4]; inv.data[2] = d[8];
+        inv.data[4] = d[1]; inv.data[5] = d[5]; inv.data[6] = d[9];
+        inv.data[8] = d[2]; inv.data[9] = d[6]; inv.data[10] = d[10];
+
+        inv.data[3] = -(d[0] * d[3] + d[4] * d[7] + d[8] * d[11]);
+        inv.data[7] = -(d[1] * d[3] + d[5] * d[7] + d[9] * d[11]);
+        inv.data[11] = -(d[2] * d[3] + d[6] * d[7] + d[10] * d[11]);
+
+        return inv;
+    }
+
+    /**
+     * Обратная матрица 4x4 для трансформации твердого тела (только поворот и перенос)
+     * @tparam T Тип ячеек матрицы
+     * @param m Исходная матрица (без масштаба и сдвига, нижняя строка 0 0 0 1)
+     * @return Обратная матрица
+     */
+    template <typename T = float>
+    constexpr Mat4<T> InverseRigid(const Mat4<T>& m)
+    {
+        return InverseRigid(AffineMat<T>(m)).toMat4();
+    }
+
     /**
      * Вращать вектор или точку вокуруг оси X
      * @tparam T Тип компонентов
@@ -769,12 +1231,13 @@ namespace math
     template <typename T = float>
     Vec3<T> RotateAroundX(const Vec3<T>& v, const float& angle)
     {
-        auto angleRad = angle * (M_PI / 180.0f);
+        float s, c;
+        detail::SinCosDeg(angle, &s, &c);
 
         return {
             v.x,
-            (v.y * cosf(angleRad)) - (v.z * sinf(angleRad)),
-            (v.y * sinf(angleRad)) + (v.z * cosf(angleRad))
+            (v.y * c) - (v.z * s),
+            (v.y * s) + (v.z * c)
         };
     }
 
@@ -788,12 +1251,13 @@ namespace math
     template <typename T = float>
     Vec3<T> RotateAroundY(const Vec3<T>& v, const float& angle)
     {
-        auto angleRad = angle * (M_PI / 180.0f);
+        float s, c;
+        detail::SinCosDeg(angle, &s, &c);
 
         return {
-                (v.x * cosf(angleRad)) + (v.z * sinf(angleRad)),
+                (v.x * c) + (v.z * s),
                 v.y,
-                -(v.x * sinf(angleRad)) + (v.z * cosf(angleRad))
+                -(v.x * s) + (v.z * c)
         };
     }
 
@@ -807,11 +1271,12 @@ namespace math
     template <typename T = float>
     Vec3<T> RotateAroundZ(const Vec3<T>& v, const float& angle)
     {
-        auto angleRad = angle * (M_PI / 180.0f);
+        float s, c;
+        detail::SinCosDeg(angle, &s, &c);
 
         return {
-                (v.x * cosf(angleRad)) - (v.y * sinf(angleRad)),
-                (v.x * sinf(angleRad)) + (v.y * cosf(angleRad)),
+                (v.x * c) - (v.y * s),
+                (v.x * s) + (v.y * c),
                 v.z
         };
     }
@@ -826,11 +1291,12 @@ namespace math
     template <typename T = float>
     Vec2<T> Rotate2D(const Vec2<T>& v, const float& angle)
     {
-        auto angleRad = angle * (M_PI / 180.0f);
+        float s, c;
+        detail::SinCosDeg(angle, &s, &c);
 
         return {
-                (v.x * cosf(angleRad)) - (v.y * sinf(angleRad)),
-                (v.x * sinf(angleRad)) + (v.y * cosf(angleRad))
+                (v.x * c) - (v.y * s),
+                (v.x * s) + (v.y * c)
         };
     }
 
@@ -844,11 +1310,12 @@ namespace math
     template <typename T = float>
     Mat3<T> GetRotationMatX(const float& angle)
     {
-        auto angleRad = angle * (M_PI / 180.0f);
+        float s, c;
+        detail::SinCosDeg(angle, &s, &c);
         return Mat3<T>(
                 {1.0f,0.0f,0.0f},
-                {0.0f,cosf(angleRad),sinf(angleRad)},
-                {0.0f,-sinf(angleRad),cosf(angleRad)});
+                {0.0f,c,s},
+                {0.0f,-s,c});
     }
 
     /**
@@ -860,11 +1327,12 @@ namespace math
     template <typename T = float>
     Mat3<T> GetRotationMatY(const float& angle)
     {
-        auto angleRad = angle * (M_PI / 180.0f);
+        float s, c;
+        detail::SinCosDeg(angle, &s, &c);
         return Mat3<T>(
-                {cosf(angleRad),0.0f,-sinf(angleRad)},
+                {c,0.0f,-s},
                 {0.0f,1.0f,0.0f},
-                {sinf(angleRad),0.0f,cosf(angleRad)});
+                {s,0.0f,c});
     }
 
     /**
@@ -876,10 +1344,11 @@ namespace math
     template <typename T = float>
     Mat3<T> GetRotationMatZ(const float& angle)
     {
-        auto angleRad = angle * (M_PI / 180.0f);
+        float s, c;
+        detail::SinCosDeg(angle, &s, &c);
         return Mat3<T>(
-                {cosf(angleRad),sinf(angleRad),0.0f},
-                {-sinf(angleRad),cosf(angleRad),0.0f},
+                {c,s,0.0f},
+                {-s,c,0.0f},
                 {0.0f,0.0f,1.0f});
     }
 
@@ -919,7 +1388,7 @@ namespace math
      * @return Матрица 3*3
      */
     template <typename T = float>
-    Mat3<T> GetScaleMat(const Vec3<T>& scale)
+    constexpr Mat3<T> GetScaleMat(const Vec3<T>& scale)
     {
         return Mat3<T>({scale.x,0.0f,0.0f},{0.0f,scale.y,0.0f},{0.0f,0.0f,scale.z});
     }
@@ -931,7 +1400,7 @@ namespace math
      * @return Матрица 4*4
      */
     template <typename T = float>
-    Mat4<T> GetScaleMat4(const Vec3<T>& scale)
+    constexpr Mat4<T> GetScaleMat4(const Vec3<T>& scale)
     {
         auto scaleMat3 = GetScaleMat<T>(scale);
         return math::Mat4<T>(
@@ -948,7 +1417,7 @@ namespace math
      * @return Матрица 4*4
      */
     template <typename T = float>
-    Mat4<T> GetTranslationMat4(const Vec3<T>& v)
+    constexpr Mat4<T> GetTranslationMat4(const Vec3<T>& v)
     {
         return math::Mat4<T>(
                 {1,0,0,0},
@@ -996,11 +1465,11 @@ namespace math
     template <typename T = float>
     Vec3<T> ProjectPerspective(const Vec3<T>& point, const float& fov, T zNear, T zFar, T aspectRatio = 1)
     {
-        auto halfFovRad = (fov / 2) * (M_PI / 180.0f);
+        const float tanHalfFov = detail::TanDeg(fov / 2);
 
         return {
-                (point.x * (-1/(tanf(halfFovRad) * aspectRatio))) / point.z,
-                (point.y * (-1/tanf(halfFovRad))) / point.z,
+                (point.x * (-1/(tanHalfFov * aspectRatio))) / point.z,
+                (point.y * (-1/tanHalfFov)) / point.z,
                 //(point.z + zNear) / (zNear - zFar)
                 ((point.z * (-zFar / (zNear - zFar))) + ((zFar * zNear) / (zFar - zNear))) / point.z
         };
@@ -1047,13 +1516,13 @@ namespace math
     template <typename T = float>
     Mat4<T> GetProjectionMatPerspective(T fov, T aspectRatio, T zNear, T zFar)
     {
-        auto halfFovRad = (fov / 2) * (M_PI / 180.0f);
+        const auto tanHalfFov = static_cast<T>(detail::TanDeg(static_cast<float>(fov / 2)));
 
         return Mat4<T>(
-                {static_cast<T>(1)/(tanf(halfFovRad) * aspectRatio), 0, 0, 0},
-                {0,static_cast<T>(1)/tanf(halfFovRad), 0, 0},
-                {0,0,-zFar / (zNear - zFar),-1},
-                {0,0,(zFar * zNear) / (zFar - zNear),0});
+                {static_cast<T>(1)/(tanHalfFov * aspectRatio), 0, 0, 0},
+                {0,static_cast<T>(1)/tanHalfFov, 0, 0},
+                {0,0,zFar / (zNear - zFar),-1},
+                {0,0,-(zFar * zNear) / (zFar - zNear),0});
     }
 
     /**
@@ -1072,4 +1541,928 @@ namespace math
                 static_cast<int>(((-point.y + 1.0f)/2.0f) * (height-1)),
         };
     }
-}
\ No newline at end of file
+
+    /**
+     * Описывающий прямоугольник набора точек
+     * @tparam T Тип компонентов точек
+     * @param points Указатель на массив точек
+     * @param count Кол-во точек
+     * @return Описывающий параллелепипед (для пустого массива - нулевой)
+     */
+    template <typename T = float>
+    constexpr BBox<Vec3<T>> FindBoundingBox(const Vec3<T>* points, size_t count)
+    {
+        BBox<Vec3<T>> result;
+        if(count == 0) return result;
+
+        result.min = points[0];
+        result.max = points[0];
+
+        for(size_t i = 1; i < count; i++)
+        {
+            const Vec3<T>& p = points[i];
+            result.min = {std::min(result.min.x, p.x), std::min(result.min.y, p.y), std::min(result.min.z, p.z)};
+            result.max = {std::max(result.max.x, p.x), std::max(result.max.y, p.y), std::max(result.max.z, p.z)};
+        }
+
+        return result;
+    }
+
+    /**
+     * Описывающий прямоугольник набора точек
+     * @tparam T Тип компонентов точек
+     * @param points Массив точек
+     * @return Описывающий параллелепипед (для пустого массива - нулевой)
+     */
+    template <typename T = float>
+    BBox<Vec3<T>> FindBoundingBox(const std::vector<Vec3<T>>& points)
+    {
+        return FindBoundingBox(points.data(), points.size());
+    }
+
+    /**
+     * Трансформация описывающего параллелепипеда (результат снова выровнен по осям)
+     * @tparam T Тип компонентов
+     * @param box Исходный параллелепипед
+     * @param m Матрица трансформации (аффинная)
+     * @return Параллелепипед, описывающий трансформированный исходный
+     */
+    template <typename T = float>
+    BBox<Vec3<T>> TransformBBox(const BBox<Vec3<T>>& box, const Mat4<T>& m)
+    {
+        // Центр трансформируется как точка, полуразмеры - через модули элементов матрицы
+        Vec3<T> c = (box.min + box.max) * static_cast<T>(0.5);
+        Vec3<T> e = (box.max - box.min) * static_cast<T>(0.5);
+
+        Vec3<T> tc = {
+                m.data[0] * c.x + m.data[1] * c.y + m.data[2] * c.z + m.data[3],
+                m.data[4] * c.x + m.data[5] * c.y + m.data[6] * c.z + m.data[7],
+                m.data[8] * c.x + m.data[9] * c.y + m.data[10] * c.z + m.data[11]
+        };
+
+        Vec3<T> te = {
+                std::abs(m.data[0]) * e.x + std::abs(m.data[1]) * e.y + std::abs(m.data[2]) * e.z,
+                std::abs(m.data[4]) * e.x + std::abs(m.data[5]) * e.y + std::abs(m.data[6]) * e.z,
+                std::abs(m.data[8]) * e.x + std::abs(m.data[9]) * e.y + std::abs(m.data[10]) * e.z
+        };
+
+        return {tc - te, tc + te};
+    }
+
+    /**
+     * Плоскость (точки p, для которых Dot(normal, p) + d = 0)
+     * @tparam T Тип компонентов
+     */
+    template <typename T = float>
+    struct Plane
+    {
+        Vec3<T> normal;
+        T d = 0;
+    };
+
+    /**
+     * Пирамида видимости (6 плоскостей, нормали направлены внутрь)
+     * @tparam T Тип компонентов
+     */
+    template <typename T = float>
+    struct Frustum
+    {
+        /// Плоскости: левая, правая, нижняя, верхняя, ближняя, дальняя
+        Plane<T> planes[6];
+    };
+
+    /**
+     * Получить пирамиду видимости из матрицы проекции (или произведения проекции и вида)
+     * @details Метод Gribb/Hartmann для соглашения текущей библиотеки: видимы точки, для которых
+     * -w <= x <= w, -w <= y <= w, 0 <= z <= w (как у GetProjectionMatPerspective и GetProjectionMatOrthogonal).
+     * Плоскости получаются в пространстве, из которого матрица переводит точки в clip-пространство
+     * @tparam T Тип компонентов
+     * @param m Матрица 4*4
+     * @return Пирамида видимости с нормализованными плоскостями
+     */
+    template <typename T = float>
+    Frustum<T> GetFrustum(const Mat4<T>& m)
+    {
+        const T* r0 = m.row(0);
+        const T* r1 = m.row(1);
+        const T* r2 = m.row(2);
+        const T* r3 = m.row(3);
+
+        const T coefficients[6][4] = {
+                {r3[0] + r0[0], r3[1] + r0[1], r3[2] + r0[2], r3[3] + r0[3]},
+                {r3[0] - r0[0], r3[1] - r0[1], r3[2] - r0[2], r3[3] - r0[3]},
+                {r3[0] + r1[0], r3[1] + r1[1], r3[2] + r1[2], r3[3] + r1[3]},
+                {r3[0] - r1[0], r3[1] - r1[1], r3[2] - r1[2], r3[3] - r1[3]},
+                {r2[0], r2[1], r2[2], r2[3]},
+                {r3[0] - r2[0], r3[1] - r2[1], r3[2] - r2[2], r3[3] - r2[3]}
+        };
+
+        Frustum<T> result;
+        for(size_t i = 0; i < 6; i++)
+        {
+            Vec3<T> n = {coefficients[i][0], coefficients[i][1], coefficients[i][2]};
+            T len = static_cast<T>(Length(n));
+            if(len > 0){
+                result.planes[i].normal = n / len;
+                result.planes[i].d = coefficients[i][3] / len;
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * Находится ли параллелепипед (хотя бы частично) внутри пирамиды видимости
+     * @details Консервативная проверка - параллелепипед у угла пирамиды может быть ошибочно сочтен видимым
+     * @tparam T Тип компонентов
+     * @param frustum Пирамида видимости
+     * @param box Параллелепипед
+     * @return Да или нет
+     */
+    template <typename T = float>
+    bool IsBBoxInFrustum(const Frustum<T>& frustum, const BBox<Vec3<T>>& box)
+    {
+        for(const auto& plane : frustum.planes)
+        {
+            // Вершина параллелепипеда, наиболее удаленная в направлении нормали
+            Vec3<T> p = {
+                    plane.normal.x >= 0 ? box.max.x : box.min.x,
+                    plane.normal.y >= 0 ? box.max.y : box.min.y,
+                    plane.normal.z >= 0 ? box.max.z : box.min.z
+            };
+
+            if(Dot(plane.normal, p) + plane.d < 0) return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Находится ли сфера (хотя бы частично) внутри пирамиды видимости
+     * @tparam T Тип компонентов
+     * @param frustum Пирамида видимости
+     * @param center Центр сферы
+     * @param radius Радиус сферы
+     * @return Да или нет
+     */
+    template <typename T = float>
+    bool IsSphereInFrustum(const Frustum<T>& frustum, const Vec3<T>& center, T radius)
+    {
+        for(const auto& plane : frustum.planes)
+        {
+            if(Dot(plane.normal, center) + plane.d < -radius) return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Пакетное отсечение параллелепипедов по пирамиде видимости (SSE - 4 объекта за итерацию)
+     * @param frustum Пирамида видимости
+     * @param boxes Массив параллелепипедов
+     * @param count Кол-во параллелепипедов
+     * @param outVisible Массив результатов (1 - видим, 0 - нет), не менее count элементов
+     */
+    inline void CullBBoxes(const Frustum<float>& frustum, const BBox<Vec3<float>>* boxes, size_t count, std::uint8_t* outVisible)
+    {
+        size_t i = 0;
+
+#ifdef MATH_SIMD_SSE
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 zero = _mm_setzero_ps();
+
+        for(; i + 4 <= count; i += 4)
+        {
+            const BBox<Vec3<float>>* b = boxes + i;
+
+            // Центры и полуразмеры 4 параллелепипедов (SoA)
+            __m128 minX = _mm_setr_ps(b[0].min.x, b[1].min.x, b[2].min.x, b[3].min.x);
+            __m128 minY = _mm_setr_ps(b[0].min.y, b[1].min.y, b[2].min.y, b[3].min.y);
+            __m128 minZ = _mm_setr_ps(b[0].min.z, b[1].min.z, b[2].min.z, b[3].min.z);
+            __m128 maxX = _mm_setr_ps(b[0].max.x, b[1].max.x, b[2].max.x, b[3].max.x);
+            __m128 maxY = _mm_setr_ps(b[0].max.y, b[1].max.y, b[2].max.y, b[3].max.y);
+            __m128 maxZ = _mm_setr_ps(b[0].max.z, b[1].max.z, b[2].max.z, b[3].max.z);
+
+            __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+            __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+            __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+            __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+            __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+            __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+            __m128 outside = _mm_setzero_ps();
+            for(const auto& plane : frustum.planes)
+            {
+                // Расстояние от центра до плоскости плюс проекция полуразмеров на нормаль
+                __m128 dist = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.normal.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.normal.y))),
+                        _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.normal.z)), _mm_set1_ps(plane.d)));
+                __m128 radius = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::abs(plane.normal.x))), _mm_mul_ps(ey, _mm_set1_ps(std::abs(plane.normal.y)))),
+                        _mm_mul_ps(ez, _mm_set1_ps(std::abs(plane.normal.z))));
+
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, radius), zero));
+            }
+
+            int mask = _mm_movemask_ps(outside);
+            for(size_t j = 0; j < 4; j++) outVisible[i + j] = (mask & (1 << j)) ? 0 : 1;
+        }
+#endif
+
+        for(; i < count; i++)
+        {
+            outVisible[i] = IsBBoxInFrustum(frustum, boxes[i]) ? 1 : 0;
+        }
+    }
+
+    /**
+     * Пакетное отсечение сфер по пирамиде видимости (SSE - 4 объекта за итерацию)
+     * @param frustum Пирамида видимости
+     * @param spheres Массив сфер (x,y,z - центр, w - радиус)
+     * @param count Кол-во сфер
+     * @param outVisible Массив результатов (1 - видима, 0 - нет), не менее count элементов
+     */
+    inline void CullSpheres(const Frustum<float>& frustum, const Vec4<float>* spheres, size_t count, std::uint8_t* outVisible)
+    {
+        size_t i = 0;
+
+#ifdef MATH_SIMD_SSE
+        for(; i + 4 <= count; i += 4)
+        {
+            // Загрузить 4 сферы и транспонировать в SoA (x, y, z, радиус)
+            __m128 cx = _mm_loadu_ps(&spheres[i].x);
+            __m128 cy = _mm_loadu_ps(&spheres[i + 1].x);
+            __m128 cz = _mm_loadu_ps(&spheres[i + 2].x);
+            __m128 r = _mm_loadu_ps(&spheres[i + 3].x);
+            _MM_TRANSPOSE4_PS(cx, cy, cz, r);
+
+            __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+            __m128 outside = _mm_setzero_ps();
+            for(const auto& plane : frustum.planes)
+            {
+                __m128 dist = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.normal.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.normal.y))),
+                        _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.normal.z)), _mm_set1_ps(plane.d)));
+
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, negR));
+            }
+
+            int mask = _mm_movemask_ps(outside);
+            for(size_t j = 0; j < 4; j++) outVisible[i + j] = (mask & (1 << j)) ? 0 : 1;
+        }
+#endif
+
+        for(; i < count; i++)
+        {
+            outVisible[i] = IsSphereInFrustum(frustum, {spheres[i].x, spheres[i].y, spheres[i].z}, spheres[i].w) ? 1 : 0;
+        }
+    }
+
+    /**
+     * Пакетная трансформация точек матрицей 4x4 с перспективным делением и переводом в координаты экрана
+     * @details Точки задаются структурой массивов (отдельные массивы X, Y, Z; W считается равным 1).
+     * Перевод в координаты экрана тот же, что у NdcToScreen (без округления). Память не выделяется,
+     * результат пишется в массивы вызывающей стороны. AVX - 8 точек за итерацию, SSE - 4
+     * @param m Матрица трансформации (например произведение проекции, вида и модели)
+     * @param xs Массив координат X
+     * @param ys Массив координат Y
+     * @param zs Массив координат Z
+     * @param count Кол-во точек
+     * @param width Ширина экрана в пикселях
+     * @param height Высота экрана в пикселях
+     * @param outX Массив для координат X на экране (не менее count элементов)
+     * @param outY Массив для координат Y на экране (не менее count элементов)
+     * @param outZ Массив для глубины в NDC (может быть nullptr)
+     */
+    inline void TransformPoints(const Mat4<float>& m,
+                                const float* xs, const float* ys, const float* zs,
+                                size_t count,
+                                unsigned width, unsigned height,
+                                float* outX, float* outY, float* outZ = nullptr)
+    {
+        const float* d = m.data;
+        const float halfWidth = static_cast<float>(width - 1) / 2.0f;
+        const float halfHeight = static_cast<float>(height - 1) / 2.0f;
+        size_t i = 0;
+
+#ifdef MATH_SIMD_AVX
+        {
+            __m256 r[16];
+            for(size_t k = 0; k < 16; k++) r[k] = _mm256_set1_ps(d[k]);
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 hw = _mm256_set1_ps(halfWidth);
+            const __m256 hh = _mm256_set1_ps(halfHeight);
+
+            for(; i + 8 <= count; i += 8)
+            {
+                const __m256 x = _mm256_loadu_ps(xs + i);
+                const __m256 y = _mm256_loadu_ps(ys + i);
+                const __m256 z = _mm256_loadu_ps(zs + i);
+
+                __m256 tx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[0], x), _mm256_mul_ps(r[1], y)), _mm256_add_ps(_mm256_mul_ps(r[2], z), r[3]));
+                __m256 ty = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[4], x), _mm256_mul_ps(r[5], y)), _mm256_add_ps(_mm256_mul_ps(r[6], z), r[7]));
+                __m256 tw = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[12], x), _mm256_mul_ps(r[13], y)), _mm256_add_ps(_mm256_mul_ps(r[14], z), r[15]));
+                const __m256 invW = _mm256_div_ps(one, tw);
+
+                _mm256_storeu_ps(outX + i, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(tx, invW), one), hw));
+                _mm256_storeu_ps(outY + i, _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(ty, invW)), hh));
+
+                if(outZ != nullptr){
+                    __m256 tz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[8], x), _mm256_mul_ps(r[9], y)), _mm256_add_ps(_mm256_mul_ps(r[10], z), r[11]));
+                    _mm256_storeu_ps(outZ + i, _mm256_mul_ps(tz, invW));
+                }
+            }
+        }
+#endif
+
+#ifdef MATH_SIMD_SSE
+        {
+            __m128 r[16];
+            for(size_t k = 0; k < 16; k++) r[k] = _mm_set1_ps(d[k]);
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 hw = _mm_set1_ps(halfWidth);
+            const __m128 hh = _mm_set1_ps(halfHeight);
+
+            for(; i + 4 <= count; i += 4)
+            {
+                const __m128 x = _mm_loadu_ps(xs + i);
+                const __m128 y = _mm_loadu_ps(ys + i);
+                const __m128 z = _mm_loadu_ps(zs + i);
+
+                __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0], x), _mm_mul_ps(r[1], y)), _mm_add_ps(_mm_mul_ps(r[2], z), r[3]));
+                __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[4], x), _mm_mul_ps(r[5], y)), _mm_add_ps(_mm_mul_ps(r[6], z), r[7]));
+                __m128 tw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[12], x), _mm_mul_ps(r[13], y)), _mm_add_ps(_mm_mul_ps(r[14], z), r[15]));
+                const __m128 invW = _mm_div_ps(one, tw);
+
+                _mm_storeu_ps(outX + i, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(tx, invW), one), hw));
+                _mm_storeu_ps(outY + i, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(ty, invW)), hh));
+
+                if(outZ != nullptr){
+                    __m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[8], x), _mm_mul_ps(r[9], y)), _mm_add_ps(_mm_mul_ps(r[10], z), r[11]));
+                    _mm_storeu_ps(outZ + i, _mm_mul_ps(tz, invW));
+                }
+            }
+        }
+#endif
+
+        for(; i < count; i++)
+        {
+            const float x = xs[i];
+            const float y = ys[i];
+            const float z = zs[i];
+            const float invW = 1.0f / (d[12] * x + d[13] * y + d[14] * z + d[15]);
+
+            outX[i] = ((d[0] * x + d[1] * y + d[2] * z + d[3]) * invW + 1.0f) * halfWidth;
+            outY[i] = (1.0f - (d[4] * x + d[5] * y + d[6] * z + d[7]) * invW) * halfHeight;
+            if(outZ != nullptr) outZ[i] = (d[8] * x + d[9] * y + d[10] * z + d[11]) * invW;
+        }
+    }
+
+    /**
+     * Кватернион (поворот в 3D-пространстве)
+     * @details Компоненты хранятся в порядке x, y, z, w (w - скалярная часть), что позволяет загружать их одним SSE регистром
+     * @tparam T Тип компонентов
+     */
+    template <typename T = float>
+    struct Quat
+    {
+        T x, y, z, w;
+
+        Quat() noexcept :x(0), y(0), z(0), w(1){};
+        Quat(const T& s1, const T& s2, const T& s3, const T& s4) noexcept :x(s1), y(s2), z(s3), w(s4) {}
+
+        Quat<T> operator*(const T& value) const
+        {
+            return {this->x * value, this->y * value, this->z * value, this->w * value};
+        }
+
+        Quat<T> operator+(const Quat<T>& other) const
+        {
+            return {this->x + other.x, this->y + other.y, this->z + other.z, this->w + other.w};
+        }
+
+        Quat<T> operator-() const
+        {
+            return {-this->x, -this->y, -this->z, -this->w};
+        }
+
+        /**
+         * Произведение кватернионов (сначала применяется поворот q, затем текущий)
+         * @param q Кватернион
+         * @return Результирующий кватернион
+         */
+        Quat<T> operator*(const Quat<T>& q) const
+        {
+            return {
+                    w * q.x + x * q.w + y * q.z - z * q.y,
+                    w * q.y - x * q.z + y * q.w + z * q.x,
+                    w * q.z + x * q.y - y * q.x + z * q.w,
+                    w * q.w - x * q.x - y * q.y - z * q.z
+            };
+        }
+
+        /**
+         * Поворот вектора (кватернион должен быть единичным)
+         * @param v Вектор
+         * @return Повернутый вектор
+         */
+        Vec3<T> operator*(const Vec3<T>& v) const
+        {
+            // v' = v + w * t + u x t, где u - векторная часть, t = 2 * (u x v)
+            const Vec3<T> u(x, y, z);
+            const Vec3<T> t = Cross(u, v) * static_cast<T>(2);
+            return v + t * w + Cross(u, t);
+        }
+    };
+
+#ifdef MATH_SIMD_SSE
+    /**
+     * Произведение кватернионов (SSE)
+     * @details Результат - сумма 4-х произведений скалярных компонентов на перестановки второго кватерниона с нужными знаками
+     */
+    template <>
+    inline Quat<float> Quat<float>::operator*(const Quat<float>& q) const
+    {
+        const __m128 b = _mm_loadu_ps(&q.x);
+
+        __m128 r = _mm_mul_ps(_mm_set1_ps(w), b);
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(x), _mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3)), _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f))));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(y), _mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2)), _mm_setr_ps(0.0f, 0.0f, -0.0f, -0.0f))));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(z), _mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_ps(-0.0f, 0.0f, 0.0f, -0.0f))));
+
+        Quat<float> result;
+        _mm_storeu_ps(&result.x, r);
+        return result;
+    }
+#endif
+
+    /**
+     * Скалярное произведение кватернионов
+     * @tparam T Тип компонентов
+     * @param q1 Кватернион 1
+     * @param q2 Кватернион 2
+     * @return Скалярное произведение
+     */
+    template <typename T = float>
+    T Dot(const Quat<T>& q1, const Quat<T>& q2)
+    {
+        return q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
+    }
+
+    /**
+     * Нормализовать кватернион
+     * @tparam T Тип компонентов
+     * @param q Кватернион
+     * @return Единичный кватернион
+     */
+    template <typename T = float>
+    Quat<T> Normalize(const Quat<T>& q)
+    {
+        T len = std::sqrt(Dot(q, q));
+        if(len > 0) return q * (1 / len);
+        return {};
+    }
+
+    /**
+     * Сопряженный кватернион (для единичного кватерниона - обратный поворот)
+     * @tparam T Тип компонентов
+     * @param q Кватернион
+     * @return Сопряженный кватернион
+     */
+    template <typename T = float>
+    Quat<T> Conjugate(const Quat<T>& q)
+    {
+        return {-q.x, -q.y, -q.z, q.w};
+    }
+
+    /**
+     * Обратный кватернион
+     * @tparam T Тип компонентов
+     * @param q Кватернион
+     * @return Обратный кватернион
+     */
+    template <typename T = float>
+    Quat<T> Inverse(const Quat<T>& q)
+    {
+        T lenSq = Dot(q, q);
+        if(lenSq > 0) return Conjugate(q) * (1 / lenSq);
+        return {};
+    }
+
+    /**
+     * Получить кватернион поворота вокруг оси
+     * @tparam T Тип компонентов
+     * @param axis Ось вращения
+     * @param angle Угол в градусах
+     * @return Единичный кватернион
+     */
+    template <typename T = float>
+    Quat<T> GetQuatFromAxisAngle(const Vec3<T>& axis, const float& angle)
+    {
+        float s, c;
+        detail::SinCosDeg(angle / 2, &s, &c);
+        auto n = Normalize(axis) * static_cast<T>(s);
+        return {n.x, n.y, n.z, static_cast<T>(c)};
+    }
+
+    /**
+     * Получить кватернион поворота вокруг всех осей (порядок тот же, что у GetRotationMat - Y * X * Z)
+     * @tparam T Тип компонентов
+     * @param angles Углы (в градусах)
+     * @return Единичный кватернион
+     */
+    template <typename T = float>
+    Quat<T> GetQuatFromEuler(const Vec3<T>& angles)
+    {
+        return GetQuatFromAxisAngle<T>({0, 1, 0}, angles.y) *
+               GetQuatFromAxisAngle<T>({1, 0, 0}, angles.x) *
+               GetQuatFromAxisAngle<T>({0, 0, 1}, angles.z);
+    }
+
+    /**
+     * Получить матрицу поворота из кватерниона
+     * @tparam T Тип компонентов
+     * @param q Единичный кватернион
+     * @return Матрица 3*3
+     */
+    template <typename T = float>
+    Mat3<T> GetRotationMat(const Quat<T>& q)
+    {
+        const T xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        const T xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        const T wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+        Mat3<T> result;
+        result.data[0] = 1 - 2 * (yy + zz); result.data[1] = 2 * (xy - wz);     result.data[2] = 2 * (xz + wy);
+        result.data[3] = 2 * (xy + wz);     result.data[4] = 1 - 2 * (xx + zz); result.data[5] = 2 * (yz - wx);
+        result.data[6] = 2 * (xz - wy);     result.data[7] = 2 * (yz + wx);     result.data[8] = 1 - 2 * (xx + yy);
+        return result;
+    }
+
+    /**
+     * Получить матрицу поворота из кватерниона (4x4)
+     * @tparam T Тип компонентов
+     * @param q Единичный кватернион
+     * @return Матрица 4*4
+     */
+    template <typename T = float>
+    Mat4<T> GetRotationMat4(const Quat<T>& q)
+    {
+        return Mat4<T>(GetRotationMat(q));
+    }
+
+    /**
+     * Получить кватернион из матрицы поворота
+     * @details Вычисление идет от наибольшей из диагональных комбинаций (метод Шеппарда), что исключает деление на малые числа
+     * @tparam T Тип компонентов
+     * @param m Ортонормированная матрица 3*3
+     * @return Единичный кватернион
+     */
+    template <typename T = float>
+    Quat<T> GetQuatFromRotationMat(const Mat3<T>& m)
+    {
+        const T* d = m.data;
+        const T trace = d[0] + d[4] + d[8];
+
+        Quat<T> q;
+        if(trace > d[0] && trace > d[4] && trace > d[8]){
+            const T s = std::sqrt(trace + 1) * 2;
+            q = {(d[7] - d[5]) / s, (d[2] - d[6]) / s, (d[3] - d[1]) / s, s / 4};
+        }
+        else if(d[0] > d[4] && d[0] > d[8]){
+            const T s = std::sqrt(1 + d[0] - d[4] - d[8]) * 2;
+            q = {s / 4, (d[1] + d[3]) / s, (d[2] + d[6]) / s, (d[7] - d[5]) / s};
+        }
+        else if(d[4] > d[8]){
+            const T s = std::sqrt(1 + d[4] - d[0] - d[8]) * 2;
+            q = {(d[1] + d[3]) / s, s / 4, (d[5] + d[7]) / s, (d[2] - d[6]) / s};
+        }
+        else{
+            const T s = std::sqrt(1 + d[8] - d[0] - d[4]) * 2;
+            q = {(d[2] + d[6]) / s, (d[5] + d[7]) / s, s / 4, (d[3] - d[1]) / s};
+        }
+
+        return Normalize(q);
+    }
+
+    /**
+     * Сферическая линейная интерполяция кватернионов (по кратчайшему пути)
+     * @tparam T Тип компонентов
+     * @param a Начальный кватернион
+     * @param b Конечный кватернион
+     * @param ratio Коэффициент интерполяции [0,1]
+     * @return Единичный кватернион
+     */
+    template <typename T = float>
+    Quat<T> Slerp(const Quat<T>& a, const Quat<T>& b, T ratio)
+    {
+        T cosTheta = Dot(a, b);
+        T sign = 1;
+        if(cosTheta < 0){
+            cosTheta = -cosTheta;
+            sign = -1;
+        }
+
+        // Для близких поворотов достаточно линейной интерполяции с нормализацией
+        T wa = 1 - ratio, wb = ratio;
+        if(cosTheta < static_cast<T>(0.9995))
+        {
+            T theta = std::acos(cosTheta);
+            T sinThetaInverse = 1 / std::sin(theta);
+            wa = std::sin(wa * theta) * sinThetaInverse;
+            wb = std::sin(wb * theta) * sinThetaInverse;
+        }
+
+        return Normalize(a * wa + b * (wb * sign));
+    }
+
+#ifdef MATH_SIMD_SSE
+    /**
+     * Сферическая линейная интерполяция кватернионов (SSE)
+     * @details Скалярное произведение, взвешенная сумма и нормализация выполняются в регистрах
+     */
+    template <>
+    inline Quat<float> Slerp<float>(const Quat<float>& a, const Quat<float>& b, float ratio)
+    {
+        const __m128 qa = _mm_loadu_ps(&a.x);
+        const __m128 qb = _mm_loadu_ps(&b.x);
+
+        __m128 dot = _mm_mul_ps(qa, qb);
+        dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(2, 3, 0, 1)));
+        dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(1, 0, 3, 2)));
+        float cosTheta = _mm_cvtss_f32(dot);
+
+        float sign = 1.0f;
+        if(cosTheta < 0.0f){
+            cosTheta = -cosTheta;
+            sign = -1.0f;
+        }
+
+        float wa = 1.0f - ratio, wb = ratio;
+        if(cosTheta < 0.9995f)
+        {
+            float theta = std::acos(cosTheta);
+            float sinThetaInverse = 1.0f / std::sin(theta);
+            wa = std::sin(wa * theta) * sinThetaInverse;
+            wb = std::sin(wb * theta) * sinThetaInverse;
+        }
+
+        __m128 r = _mm_add_ps(_mm_mul_ps(qa, _mm_set1_ps(wa)), _mm_mul_ps(qb, _mm_set1_ps(wb * sign)));
+
+        __m128 lenSq = _mm_mul_ps(r, r);
+        lenSq = _mm_add_ps(lenSq, _mm_shuffle_ps(lenSq, lenSq, _MM_SHUFFLE(2, 3, 0, 1)));
+        lenSq = _mm_add_ps(lenSq, _mm_shuffle_ps(lenSq, lenSq, _MM_SHUFFLE(1, 0, 3, 2)));
+        r = _mm_div_ps(r, _mm_sqrt_ps(lenSq));
+
+        Quat<float> result;
+        _mm_storeu_ps(&result.x, r);
+        return result;
+    }
+#endif
+
+    /**
+     * Трансформация в виде переноса, поворота и масштаба (TRS)
+     * @details Применяется к точке в порядке: масштаб, поворот, перенос. Занимает 40 байт вместо 64 у матрицы 4x4,
+     * композиция требует одного произведения кватернионов и одного поворота вектора.
+     * Композиция и обращение точны при равномерном масштабе (при неравномерном масштабе родителя
+     * и повороте потомка сдвиг не представим в таком виде)
+     * @tparam T Тип компонентов
+     */
+    template <typename T = float>
+    struct Transform
+    {
+        /// Поворот
+        Quat<T> rotation;
+        /// Перенос
+        Vec3<T> translation;
+        /// Масштаб
+        Vec3<T> scale;
+
+        Transform() noexcept :rotation(), translation(), scale(1, 1, 1){};
+
+        explicit Transform(const Vec3<T>& t, const Quat<T>& r = Quat<T>(), const Vec3<T>& s = {1, 1, 1}) noexcept :
+                rotation(r), translation(t), scale(s){}
+
+        /**
+         * Композиция трансформаций (сначала применяется other, затем текущая)
+         * @param other Трансформация
+         * @return Результирующая трансформация
+         */
+        Transform<T> operator*(const Transform<T>& other) const
+        {
+            Transform<T> result;
+            result.rotation = this->rotation * other.rotation;
+            result.scale = this->scale * other.scale;
+            result.translation = this->translation + this->rotation * (this->scale * other.translation);
+            return result;
+        }
+
+        /**
+         * Трансформация точки
+         * @param p Точка
+         * @return Точка после трансформации
+         */
+        Vec3<T> operator*(const Vec3<T>& p) const
+        {
+            return this->translation + this->rotation * (this->scale * p);
+        }
+
+        /**
+         * Равномерный ли масштаб (композиция this * other с такой трансформацией точна для любой other)
+         * @param epsilon Допустимое относительное отклонение компонентов масштаба
+         * @return Да или нет
+         */
+        bool hasUniformScale(T epsilon = static_cast<T>(1e-4)) const
+        {
+            const T maxScale = std::max(std::fabs(this->scale.x), std::max(std::fabs(this->scale.y), std::fabs(this->scale.z)));
+            return std::fabs(this->scale.x - this->scale.y) <= epsilon * maxScale &&
+                   std::fabs(this->scale.y - this->scale.z) <= epsilon * maxScale;
+        }
+
+        /**
+         * Получить аффинную матрицу 3x4
+         * @return Матрица 3x4
+         */
+        AffineMat<T> toAffineMat() const
+        {
+            const Mat3<T> r = GetRotationMat(this->rotation);
+            const T s[3] = {this->scale.x, this->scale.y, this->scale.z};
+            const T t[3] = {this->translation.x, this->translation.y, this->translation.z};
+
+            AffineMat<T> result;
+            for(size_t i = 0; i < 3; i++){
+                result.data[i * 4] = r.data[i * 3] * s[0];
+                result.data[i * 4 + 1] = r.data[i * 3 + 1] * s[1];
+                result.data[i * 4 + 2] = r.data[i * 3 + 2] * s[2];
+                result.data[i * 4 + 3] = t[i];
+            }
+            return result;
+        }
+
+        /**
+         * Получить матрицу 4x4
+         * @return Матрица 4x4
+         */
+        Mat4<T> toMat4() const
+        {
+            return this->toAffineMat().toMat4();
+        }
+    };
+
+    /**
+     * Обратная трансформация (точна при равномерном масштабе)
+     * @tparam T Тип компонентов
+     * @param t Трансформация (с единичным кватернионом поворота)
+     * @return Обратная трансформация
+     */
+    template <typename T = float>
+    Transform<T> Inverse(const Transform<T>& t)
+    {
+        Transform<T> result;
+        result.rotation = Conjugate(t.rotation);
+        result.scale = {1 / t.scale.x, 1 / t.scale.y, 1 / t.scale.z};
+        result.translation = result.scale * (result.rotation * -t.translation);
+        return result;
+    }
+
+    /**
+     * Интерполяция трансформаций (перенос и масштаб - линейно, поворот - сферически)
+     * @tparam T Тип компонентов
+     * @param a Начальная трансформация
+     * @param b Конечная трансформация
+     * @param ratio Коэффициент интерполяции [0,1]
+     * @return Трансформация
+     */
+    template <typename T = float>
+    Transform<T> Slerp(const Transform<T>& a, const Transform<T>& b, T ratio)
+    {
+        Transform<T> result;
+        result.rotation = Slerp(a.rotation, b.rotation, ratio);
+        result.translation = Mix(a.translation, b.translation, ratio);
+        result.scale = Mix(a.scale, b.scale, ratio);
+        return result;
+    }
+
+    /**
+     * Дуальный кватернион (жесткая трансформация: поворот и перенос)
+     * @details Занимает 8 чисел вместо 16 у матрицы. Взвешенная сумма дуальных кватернионов с нормализацией
+     * дает жесткую трансформацию, поэтому при смешивании не возникает эффекта "скручивания" (candy-wrapper),
+     * характерного для смешивания матриц. Масштаб не представим
+     * @tparam T Тип компонентов
+     */
+    template <typename T = float>
+    struct DualQuat
+    {
+        /// Основная часть (поворот)
+        Quat<T> real;
+        /// Дуальная часть (перенос: 0.5 * t * real)
+        Quat<T> dual;
+
+        DualQuat() noexcept :real(), dual(0, 0, 0, 0){};
+        DualQuat(const Quat<T>& r, const Quat<T>& d) noexcept :real(r), dual(d){}
+
+        /**
+         * Построение из поворота и переноса (сначала применяется поворот)
+         * @param rotation Единичный кватернион поворота
+         * @param translation Перенос
+         */
+        DualQuat(const Quat<T>& rotation, const Vec3<T>& translation) noexcept :
+                real(rotation),
+                dual(Quat<T>(translation.x, translation.y, translation.z, 0) * rotation * static_cast<T>(0.5)){}
+
+        /**
+         * Построение из трансформации TRS (масштаб не представим и не учитывается)
+         * @param t Трансформация (перенос, поворот, масштаб)
+         */
+        explicit DualQuat(const Transform<T>& t) noexcept :DualQuat(t.rotation, t.translation){}
+
+        /**
+         * Построение из матрицы жесткой трансформации
+         * @param m Матрица 4*4 (поворот и перенос, без масштаба)
+         */
+        explicit DualQuat(const Mat4<T>& m)
+        {
+            Mat3<T> r;
+            for(size_t i = 0; i < 3; i++) for(size_t j = 0; j < 3; j++) r.data[i * 3 + j] = m.data[i * 4 + j];
+            *this = DualQuat<T>(GetQuatFromRotationMat(r), Vec3<T>(m.data[3], m.data[7], m.data[11]));
+        }
+
+        DualQuat<T> operator*(const T& value) const
+        {
+            return {this->real * value, this->dual * value};
+        }
+
+        DualQuat<T> operator+(const DualQuat<T>& other) const
+        {
+            return {this->real + other.real, this->dual + other.dual};
+        }
+
+        /**
+         * Композиция трансформаций (сначала применяется other, затем текущая)
+         * @param other Дуальный кватернион
+         * @return Результирующий дуальный кватернион
+         */
+        DualQuat<T> operator*(const DualQuat<T>& other) const
+        {
+            return {this->real * other.real, this->real * other.dual + this->dual * other.real};
+        }
+
+        /**
+         * Получить перенос (для единичного дуального кватерниона)
+         * @return Вектор переноса
+         */
+        Vec3<T> getTranslation() const
+        {
+            // t = 2 * dual * conj(real)
+            const Vec3<T> rv(real.x, real.y, real.z);
+            const Vec3<T> dv(dual.x, dual.y, dual.z);
+            return (dv * real.w - rv * dual.w + Cross(rv, dv)) * static_cast<T>(2);
+        }
+
+        /**
+         * Трансформация точки (для единичного дуального кватерниона)
+         * @param p Точка
+         * @return Точка после трансформации
+         */
+        Vec3<T> operator*(const Vec3<T>& p) const
+        {
+            return this->real * p + this->getTranslation();
+        }
+
+        /**
+         * Получить матрицу 4x4
+         * @return Матрица 4x4
+         */
+        Mat4<T> toMat4() const
+        {
+            const Vec3<T> t = this->getTranslation();
+            return Mat4<T>(GetRotationMat(this->real), {t.x, t.y, t.z, 1});
+        }
+    };
+
+    /**
+     * Нормализовать дуальный кватернион (после смешивания)
+     * @tparam T Тип компонентов
+     * @param dq Дуальный кватернион
+     * @return Единичный дуальный кватернион
+     */
+    template <typename T = float>
+    DualQuat<T> Normalize(const DualQuat<T>& dq)
+    {
+        T len = std::sqrt(Dot(dq.real, dq.real));
+        if(len > 0) return dq * (1 / len);
+        return {};
+    }
+
+    /**
+     * Сопряженный дуальный кватернион (для единичного - обратная трансформация)
+     * @tparam T Тип компонентов
+     * @param dq Дуальный кватернион
+     * @return Сопряженный дуальный кватернион
+     */
+    template <typename T = float>
+    DualQuat<T> Conjugate(const DualQuat<T>& dq)
+    {
+        return {Conjugate(dq.real), Conjugate(dq.dual)};
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdio>
+
+/**
+ * Кол-во проваленных проверок (общее для исполняемого файла тестов)
+ * @return Ссылка на счетчик
+ */
+inline int& FailedChecks()
+{
+    static int failed = 0;
+    return failed;
+}
+
+/**
+ * Проверка условия с выводом места провала (тест продолжается)
+ */
+#define CHECK(condition) \
+    do { \
+        if(!(condition)){ \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            FailedChecks()++; \
+        } \
+    } while(false)
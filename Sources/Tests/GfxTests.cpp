@@ -0,0 +1,453 @@
+#include "Check.hpp"
+#include "Gfx.hpp"
+#include "Blending.hpp"
+#include "Rasterizer.hpp"
+#include <MeshOptimizer.hpp>
+
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+/**
+ * Пиксель BGRA (как RGBQUAD)
+ */
+struct Pixel
+{
+    std::uint8_t b, g, r, a;
+
+    bool operator==(const Pixel& other) const
+    {
+        return b == other.b && g == other.g && r == other.r && a == other.a;
+    }
+};
+
+/**
+ * Закрашенный эллипс совпадает с аналитическим x²/rx² + y²/ry² <= 1 (включая вырожденные и плоские)
+ */
+void TestEllipseFilled()
+{
+    const int radiusMax = 60;
+    const int size = radiusMax * 2 + 3;
+    const int center = radiusMax + 1;
+
+    gfx::ImageBuffer<std::uint8_t> buffer(size, size, 0);
+
+    for(int rx = 0; rx <= radiusMax; rx++)
+    {
+        for(int ry = 0; ry <= radiusMax; ry++)
+        {
+            buffer.clear(0);
+            gfx::SetEllipseFilled<std::uint8_t>(&buffer, center, center, rx, ry, 1, gfx::SAFE_CHECK_ALL_POINTS);
+
+            int mismatches = 0;
+            for(int y = 0; y < size; y++)
+            {
+                for(int x = 0; x < size; x++)
+                {
+                    const long long dx = x - center;
+                    const long long dy = y - center;
+
+                    // Для вырожденного эллипса (нулевой радиус) допустимо только нулевое смещение по этой оси
+                    bool inside;
+                    if(rx == 0 || ry == 0){
+                        inside = (rx != 0 || dx == 0) && (ry != 0 || dy == 0) && dx * dx <= 1LL * rx * rx && dy * dy <= 1LL * ry * ry;
+                    }
+                    else{
+                        inside = dx * dx * ry * ry + dy * dy * rx * rx <= 1LL * rx * rx * ry * ry;
+                    }
+
+                    if(inside != (buffer[y][x] != 0)) mismatches++;
+                }
+            }
+
+            if(mismatches != 0) std::printf("ellipse rx=%d ry=%d: %d mismatched pixels\n", rx, ry, mismatches);
+            CHECK(mismatches == 0);
+        }
+    }
+}
+
+/**
+ * Смешивание отрезка (SSE2, если включено) совпадает с поштучным скалярным смешиванием BlendPixel
+ * @tparam MODE Режим смешивания
+ * @param rng Генератор случайных чисел
+ */
+template<gfx::BlendMode MODE>
+void TestBlendSpanMode(std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    // Смещения 0..3 пикселя - начало отрезка не выровнено на 16 байт, длины не кратны 4 - есть "хвосты"
+    for(size_t offset = 0; offset < 4; offset++)
+    {
+        for(size_t count = 0; count <= 37; count++)
+        {
+            std::vector<std::uint8_t> src((offset + count) * 4), dst((offset + count) * 4);
+            for(auto& v : src) v = static_cast<std::uint8_t>(byte(rng));
+            for(auto& v : dst) v = static_cast<std::uint8_t>(byte(rng));
+
+            std::vector<std::uint8_t> expected = dst;
+            std::vector<std::uint8_t> expectedUniform = dst;
+            for(size_t i = offset; i < offset + count; i++){
+                gfx::detail::BlendPixel<MODE>(&expected[i * 4], &src[i * 4]);
+                gfx::detail::BlendPixel<MODE>(&expectedUniform[i * 4], &src[offset * 4]);
+            }
+
+            std::vector<std::uint8_t> actual = dst;
+            std::vector<std::uint8_t> actualUniform = dst;
+            gfx::detail::BlendSpan<MODE, false>(actual.data() + offset * 4, src.data() + offset * 4, count);
+            gfx::detail::BlendSpan<MODE, true>(actualUniform.data() + offset * 4, src.data() + offset * 4, count);
+
+            CHECK(actual == expected);
+            CHECK(actualUniform == expectedUniform);
+        }
+    }
+}
+
+/**
+ * Смешивание отрезков одинаково для векторного и скалярного путей во всех режимах
+ */
+void TestBlendSpan()
+{
+    std::mt19937 rng(27);
+    TestBlendSpanMode<gfx::BlendMode::eNone>(rng);
+    TestBlendSpanMode<gfx::BlendMode::eSrcOver>(rng);
+    TestBlendSpanMode<gfx::BlendMode::ePremultiplied>(rng);
+    TestBlendSpanMode<gfx::BlendMode::eAdditive>(rng);
+    TestBlendSpanMode<gfx::BlendMode::eMultiply>(rng);
+}
+
+/**
+ * Треугольник со смешиванием покрывает те же пиксели, что и SetTriangle с заливкой, и смешивает каждый ровно один раз
+ */
+void TestTriangleBlended()
+{
+    const int size = 48;
+    const Pixel zero{0, 0, 0, 0};
+    const Pixel one{1, 1, 1, 1};
+
+    gfx::ImageBuffer<Pixel> reference(size, size, zero);
+    gfx::ImageBuffer<Pixel> blended(size, size, zero);
+
+    std::mt19937 rng(270);
+    for(int t = 0; t < 500; t++)
+    {
+        // Мелкие (путь маски 8x8) и крупные треугольники, частично выходящие за пределы буфера
+        std::uniform_int_distribution<int> extent(0, t % 2 == 0 ? 7 : size + 8);
+        std::uniform_int_distribution<int> origin(-4, size - 4);
+        const int ox = origin(rng), oy = origin(rng);
+        const int x0 = ox + extent(rng), y0 = oy + extent(rng);
+        const int x1 = ox + extent(rng), y1 = oy + extent(rng);
+        const int x2 = ox + extent(rng), y2 = oy + extent(rng);
+
+        reference.clear(zero);
+        blended.clear(zero);
+        gfx::SetTriangle(&reference, x0, y0, x1, y1, x2, y2, one, true, gfx::SAFE_CHECK_ALL_POINTS);
+        gfx::SetTriangleBlended(&blended, x0, y0, x1, y1, x2, y2, one, gfx::BlendMode::eAdditive, gfx::SAFE_CHECK_ALL_POINTS);
+
+        int mismatches = 0;
+        for(int y = 0; y < size; y++){
+            for(int x = 0; x < size; x++){
+                if(!(reference[y][x] == blended[y][x])) mismatches++;
+            }
+        }
+
+        if(mismatches != 0) std::printf("triangle (%d,%d) (%d,%d) (%d,%d): %d mismatched pixels\n", x0, y0, x1, y1, x2, y2, mismatches);
+        CHECK(mismatches == 0);
+    }
+}
+
+/**
+ * Точка со смешиванием учитывает глубину и обновляет буфер глубины
+ */
+void TestPointBlended()
+{
+    gfx::ImageBuffer<Pixel> image(4, 4, Pixel{100, 100, 100, 255});
+    gfx::ImageBuffer<float> depth(4, 4, 1.0f);
+
+    gfx::SetPointBlended(&image, &depth, 1, 2, Pixel{200, 0, 50, 128}, 0.5f, gfx::BlendMode::eSrcOver);
+    CHECK(depth[2][1] == 0.5f);
+    CHECK(image[2][1].b == 150 && image[2][1].g == 50 && image[2][1].r == 75 && image[2][1].a == 255);
+
+    // Точка дальше записанной - отбрасывается
+    gfx::SetPointBlended(&image, &depth, 1, 2, Pixel{0, 0, 0, 255}, 0.75f, gfx::BlendMode::eSrcOver);
+    CHECK(depth[2][1] == 0.5f);
+    CHECK(image[2][1].b == 150);
+
+    // За пределами буфера - без записи
+    gfx::SetPointBlended(&image, &depth, 4, 0, Pixel{0, 0, 0, 255}, 0.0f, gfx::BlendMode::eNone);
+}
+
+/**
+ * Вершина для тестов растеризатора (положение в NDC, интерполируется до фрагментного шейдера)
+ */
+struct RasterVertex
+{
+    float x, y;
+
+    RasterVertex operator*(float k) const
+    {
+        return {x * k, y * k};
+    }
+
+    RasterVertex operator+(const RasterVertex& other) const
+    {
+        return {x + other.x, y + other.y};
+    }
+};
+
+using TestRasterizer = gfx::Rasterizer<RasterVertex, Pixel, float>;
+
+/**
+ * Шейдеры, считающие вызовы фрагментного шейдера для каждого пикселя (пиксель находится по интерполированному положению)
+ * @param pRasterizer Растеризатор
+ * @param pHits Счетчики вызовов по пикселям
+ */
+void SetCountingShaders(TestRasterizer* pRasterizer, gfx::ImageBuffer<int>* pHits)
+{
+    pRasterizer->setVertexShader([](const RasterVertex& v, TestRasterizer::Vec4* pOut){
+        *pOut = {v.x, v.y, 0.5f, 1.0f};
+        return v;
+    });
+
+    pRasterizer->setFragmentShader([pHits](const RasterVertex& v){
+        const auto x = static_cast<int>(std::floor((v.x + 1.0f) * 0.5f * static_cast<float>(pHits->getWidth())));
+        const auto y = static_cast<int>(std::floor((1.0f - v.y) * 0.5f * static_cast<float>(pHits->getHeight())));
+        if(pHits->isPointIn(x, y)) (*pHits)[y][x]++;
+        return Pixel{255, 255, 255, 255};
+    });
+}
+
+/**
+ * Веер треугольников из точки center, вершины которого лежат на краях экрана ([-1,1]², обход против часовой стрелки)
+ * @param center Общая вершина
+ * @param rng Генератор случайных чисел (промежуточные вершины на краях)
+ * @return Тройки вершин
+ */
+std::vector<RasterVertex> MakeScreenFan(RasterVertex center, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> t(-1.0f, 1.0f);
+
+    std::vector<RasterVertex> rim = {{-1.0f, -1.0f}};
+    for(int i = 0; i < 3; i++) rim.push_back({t(rng), -1.0f});
+    std::sort(rim.begin() + 1, rim.end(), [](const RasterVertex& a, const RasterVertex& b){ return a.x < b.x; });
+    rim.push_back({1.0f, -1.0f});
+    for(int i = 0; i < 2; i++) rim.push_back({1.0f, -0.9f + 0.8f * static_cast<float>(i)});
+    rim.push_back({1.0f, 1.0f});
+    rim.push_back({0.25f, 1.0f});
+    rim.push_back({-1.0f, 1.0f});
+    rim.push_back({-1.0f, 0.0f});
+
+    std::vector<RasterVertex> triangles;
+    for(size_t i = 0; i < rim.size(); i++){
+        triangles.push_back(center);
+        triangles.push_back(rim[i]);
+        triangles.push_back(rim[(i + 1) % rim.size()]);
+    }
+    return triangles;
+}
+
+/**
+ * Треугольники, покрывающие весь экран, закрашивают каждый пиксель (и каждый сэмпл в режиме MSAA) ровно один раз
+ */
+void TestRasterizerCoverage()
+{
+    const unsigned width = 37;
+    const unsigned height = 29;
+
+    std::mt19937 rng(28);
+    std::vector<std::vector<RasterVertex>> meshes = {
+            {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}},
+            MakeScreenFan({0.0f, 0.0f}, rng),
+            MakeScreenFan({0.13f, -0.27f}, rng),
+            MakeScreenFan({-0.61f, 0.4f}, rng)
+    };
+
+    for(const auto& mesh : meshes)
+    {
+        // Обычный режим - без пропусков и двойных записей
+        gfx::ImageBuffer<Pixel> color(width, height, Pixel{0, 0, 0, 0});
+        gfx::ImageBuffer<int> hits(width, height, 0);
+        TestRasterizer rasterizer(&color, nullptr, TestRasterizer::FrontFace::eClockWise, false);
+        SetCountingShaders(&rasterizer, &hits);
+
+        for(size_t i = 0; i + 3 <= mesh.size(); i += 3) rasterizer.DrawTriangle(mesh[i], mesh[i + 1], mesh[i + 2]);
+
+        int gaps = 0, doubles = 0;
+        for(int y = 0; y < static_cast<int>(height); y++){
+            for(int x = 0; x < static_cast<int>(width); x++){
+                if(hits[y][x] == 0 || color[y][x].a != 255) gaps++;
+                if(hits[y][x] > 1) doubles++;
+            }
+        }
+
+        if(gaps != 0 || doubles != 0) std::printf("rasterizer: %d unwritten pixels, %d written twice\n", gaps, doubles);
+        CHECK(gaps == 0);
+        CHECK(doubles == 0);
+
+        // MSAA - все сэмплы записаны, после сведения все пиксели непрозрачны
+        gfx::MultisampleImageBuffer<Pixel> colorMs(width, height, gfx::Multisample<Pixel>::filled(Pixel{0, 0, 0, 0}));
+        TestRasterizer rasterizerMs(&colorMs, nullptr, TestRasterizer::FrontFace::eClockWise, false);
+        SetCountingShaders(&rasterizerMs, &hits);
+
+        for(size_t i = 0; i + 3 <= mesh.size(); i += 3) rasterizerMs.DrawTriangle(mesh[i], mesh[i + 1], mesh[i + 2]);
+
+        gfx::ImageBuffer<Pixel> resolved(width, height, Pixel{0, 0, 0, 0});
+        gfx::ResolveMultisample(&colorMs, &resolved);
+
+        int unwrittenSamples = 0, translucent = 0;
+        for(int y = 0; y < static_cast<int>(height); y++){
+            for(int x = 0; x < static_cast<int>(width); x++){
+                for(const Pixel& sample : colorMs[y][x].samples) unwrittenSamples += sample.a != 255;
+                translucent += resolved[y][x].a != 255;
+            }
+        }
+
+        if(unwrittenSamples != 0 || translucent != 0) std::printf("rasterizer MSAA: %d unwritten samples, %d translucent pixels\n", unwrittenSamples, translucent);
+        CHECK(unwrittenSamples == 0);
+        CHECK(translucent == 0);
+    }
+}
+
+/**
+ * Сведение мульти-сэмплового буфера (SSE2, если включено) совпадает со скалярным средним с округлением
+ */
+void TestResolveMultisample()
+{
+    std::mt19937 rng(280);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    // Ширины, не кратные 4 - есть "хвосты"
+    for(unsigned width = 1; width <= 11; width++)
+    {
+        const unsigned height = 3;
+        gfx::MultisampleImageBuffer<Pixel> src(width, height, gfx::Multisample<Pixel>::filled(Pixel{0, 0, 0, 0}));
+        gfx::ImageBuffer<Pixel> dst(width, height, Pixel{0, 0, 0, 0});
+
+        auto* bytes = reinterpret_cast<std::uint8_t*>(src.getData());
+        for(size_t i = 0; i < static_cast<size_t>(width) * height * 16; i++) bytes[i] = static_cast<std::uint8_t>(byte(rng));
+
+        // Крайние значения (проверка насыщения и округления)
+        if(width == 1) std::memset(bytes, 255, 16);
+
+        gfx::ResolveMultisample(&src, &dst);
+
+        int mismatches = 0;
+        for(size_t i = 0; i < static_cast<size_t>(width) * height; i++)
+        {
+            const auto* out = reinterpret_cast<const std::uint8_t*>(dst.getData() + i);
+            for(unsigned c = 0; c < 4; c++)
+            {
+                const unsigned sum = bytes[i * 16 + c] + bytes[i * 16 + 4 + c] + bytes[i * 16 + 8 + c] + bytes[i * 16 + 12 + c];
+                if(out[c] != static_cast<std::uint8_t>((sum + 2) / 4)) mismatches++;
+            }
+        }
+
+        CHECK(mismatches == 0);
+    }
+}
+
+/**
+ * Кол-во промахов FIFO-кэша вершин (та же модель, что и в CalculateAcmr, но в целых числах)
+ * @param indices Индексы
+ * @param cacheSize Размер кэша
+ * @return Кол-во промахов
+ */
+size_t CountCacheMisses(const std::vector<std::uint32_t>& indices, size_t cacheSize)
+{
+    std::vector<std::uint32_t> fifo;
+    size_t misses = 0;
+    for(const auto index : indices)
+    {
+        if(std::find(fifo.begin(), fifo.end(), index) != fifo.end()) continue;
+        misses++;
+        fifo.push_back(index);
+        if(fifo.size() > cacheSize) fifo.erase(fifo.begin());
+    }
+    return misses;
+}
+
+/**
+ * OptimizeVertexCache снижает ACMR перемешанной сетки, а DrawIndexed вызывает вершинный шейдер ровно столько раз,
+ * сколько промахов насчитывает модель кэша (до и после оптимизации)
+ */
+void TestVertexCacheOptimization()
+{
+    // Сетка в пределах экрана, треугольники в случайном порядке
+    const unsigned gridSize = 24;
+    std::vector<RasterVertex> vertices;
+    for(unsigned y = 0; y <= gridSize; y++){
+        for(unsigned x = 0; x <= gridSize; x++){
+            vertices.push_back({static_cast<float>(x) / gridSize * 1.8f - 0.9f, static_cast<float>(y) / gridSize * 1.8f - 0.9f});
+        }
+    }
+
+    std::vector<std::array<std::uint32_t, 3>> triangles;
+    for(unsigned y = 0; y < gridSize; y++){
+        for(unsigned x = 0; x < gridSize; x++){
+            const std::uint32_t i = y * (gridSize + 1) + x;
+            triangles.push_back({i, i + 1, i + gridSize + 2});
+            triangles.push_back({i, i + gridSize + 2, i + gridSize + 1});
+        }
+    }
+    std::mt19937 rng(48);
+    std::shuffle(triangles.begin(), triangles.end(), rng);
+
+    std::vector<std::uint32_t> indices;
+    for(const auto& t : triangles) indices.insert(indices.end(), t.begin(), t.end());
+
+    std::vector<std::uint32_t> optimized(indices.size());
+    tools::OptimizeVertexCache(indices.data(), indices.size(), vertices.size(), optimized.data());
+
+    // Тот же набор треугольников (с точностью до порядка треугольников и циклического сдвига вершин)
+    const auto canonical = [](const std::vector<std::uint32_t>& in){
+        std::vector<std::array<std::uint32_t, 3>> out;
+        for(size_t i = 0; i + 3 <= in.size(); i += 3)
+        {
+            std::array<std::uint32_t, 3> t = {in[i], in[i + 1], in[i + 2]};
+            while(t[0] != std::min(t[0], std::min(t[1], t[2]))) std::rotate(t.begin(), t.begin() + 1, t.end());
+            out.push_back(t);
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    };
+    CHECK(canonical(indices) == canonical(optimized));
+
+    const size_t cacheSize = TestRasterizer::VERTEX_CACHE_SIZE;
+    const float acmrBefore = tools::CalculateAcmr(indices.data(), indices.size(), vertices.size(), cacheSize);
+    const float acmrAfter = tools::CalculateAcmr(optimized.data(), optimized.size(), vertices.size(), cacheSize);
+    std::printf("vertex cache: ACMR %.3f -> %.3f\n", static_cast<double>(acmrBefore), static_cast<double>(acmrAfter));
+    CHECK(acmrAfter < acmrBefore);
+    CHECK(acmrAfter < 1.0f);
+
+    gfx::ImageBuffer<Pixel> color(32, 32, Pixel{0, 0, 0, 0});
+    gfx::ImageBuffer<int> hits(32, 32, 0);
+    TestRasterizer rasterizer(&color, nullptr, TestRasterizer::FrontFace::eClockWise, false);
+    SetCountingShaders(&rasterizer, &hits);
+
+    for(const auto* pIndices : {&indices, &optimized})
+    {
+        const size_t misses = CountCacheMisses(*pIndices, cacheSize);
+        const float acmr = tools::CalculateAcmr(pIndices->data(), pIndices->size(), vertices.size(), cacheSize);
+        CHECK(static_cast<size_t>(std::lround(acmr * static_cast<float>(pIndices->size() / 3))) == misses);
+
+        rasterizer.resetStatistics();
+        rasterizer.DrawIndexed(vertices.data(), pIndices->data(), pIndices->size());
+        CHECK(rasterizer.getVertexShaderInvocations() == misses);
+    }
+}
+
+int main()
+{
+    TestEllipseFilled();
+    TestBlendSpan();
+    TestTriangleBlended();
+    TestPointBlended();
+    TestRasterizerCoverage();
+    TestResolveMultisample();
+    TestVertexCacheOptimization();
+    return FailedChecks() == 0 ? 0 : 1;
+}
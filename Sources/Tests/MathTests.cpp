@@ -0,0 +1,82 @@
+#include "Check.hpp"
+#include "Math.hpp"
+
+namespace math
+{
+    /**
+     * Проверки вычислений во время компиляции (типы и базовые операции должны быть пригодны для constexpr)
+     */
+    static_assert(Vec3<float>(1.0f, 2.0f, 3.0f).z == 3.0f, "Vec3 must be constexpr");
+    static_assert((Vec4<float>(1.0f, 2.0f, 3.0f, 4.0f) * 2.0f - Vec4<float>(1.0f, 1.0f, 1.0f, 1.0f)).w == 7.0f, "Vec4 operators must be constexpr");
+    static_assert(Dot(Vec3<float>(1.0f, 2.0f, 3.0f), Vec3<float>(4.0f, 5.0f, 6.0f)) == 32.0f, "Dot must be constexpr");
+    static_assert(Cross(Vec3<float>(1.0f, 0.0f, 0.0f), Vec3<float>(0.0f, 1.0f, 0.0f)).z == 1.0f, "Cross must be constexpr");
+    static_assert(Mix(Vec3<float>(0.0f, 0.0f, 0.0f), Vec3<float>(2.0f, 4.0f, 6.0f), 0.5f).y == 2.0f, "Mix must be constexpr");
+    static_assert(Mat4<float>(1.0f).data[15] == 1.0f, "Mat4 must be constexpr");
+    static_assert(GetTranslationMat4<float>({1.0f, 2.0f, 3.0f}).data[11] == 3.0f, "GetTranslationMat4 must be constexpr");
+    static_assert(Transpose(GetTranslationMat4<float>({1.0f, 2.0f, 3.0f})).data[13] == 2.0f, "Transpose must be constexpr");
+    static_assert(Determinant(GetScaleMat4<float>({2.0f, 3.0f, 4.0f})) == 24.0f, "Determinant must be constexpr");
+    static_assert(Determinant(GetScaleMat<float>({2.0f, 3.0f, 4.0f})) == 24.0f, "Determinant must be constexpr");
+    static_assert((GetTranslationMat4<double>({1.0, 2.0, 3.0}) * Vec4<double>(1.0, 1.0, 1.0, 1.0)).z == 4.0, "Mat4 * Vec4 must be constexpr");
+    static_assert((GetTranslationMat4<double>({1.0, 2.0, 3.0}) * GetScaleMat4<double>({2.0, 2.0, 2.0})).data[7] == 2.0, "Mat4 * Mat4 must be constexpr");
+    static_assert(Inverse(GetScaleMat4<double>({2.0, 4.0, 8.0})).data[10] == 0.125, "Inverse must be constexpr");
+    static_assert(InverseAffine(GetTranslationMat4<float>({1.0f, 2.0f, 3.0f})).data[7] == -2.0f, "InverseAffine must be constexpr");
+    static_assert(InverseAffine(GetScaleMat4<float>({1.0f, 0.0f, 1.0f})).data[15] == 0.0f, "InverseAffine of a singular matrix must be zero");
+    static_assert(InverseAffine(AffineMat<float>(GetScaleMat4<float>({1.0f, 0.0f, 1.0f}))).data[0] == 0.0f, "InverseAffine of a singular matrix must be zero");
+    static_assert(InverseRigid(GetTranslationMat4<float>({1.0f, 2.0f, 3.0f})).data[3] == -1.0f, "InverseRigid must be constexpr");
+
+    /// Неподвижная матрица камеры, вычисленная во время компиляции (float, при любом режиме SIMD)
+    constexpr Mat4<float> FIXED_VIEW = MulConstexpr(GetTranslationMat4<float>({1.0f, 2.0f, 3.0f}), GetScaleMat4<float>({2.0f, 4.0f, 8.0f}));
+    static_assert(FIXED_VIEW.data[0] == 2.0f && FIXED_VIEW.data[5] == 4.0f && FIXED_VIEW.data[10] == 8.0f, "Mat4<float> * Mat4<float> must be constexpr");
+    static_assert(FIXED_VIEW.data[3] == 1.0f && FIXED_VIEW.data[7] == 2.0f && FIXED_VIEW.data[11] == 3.0f, "Mat4<float> * Mat4<float> must be constexpr");
+    static_assert(MulConstexpr(FIXED_VIEW, Vec4<float>(1.0f, 1.0f, 1.0f, 1.0f)).z == 11.0f, "Mat4<float> * Vec4<float> must be constexpr");
+    static_assert(MulConstexpr(FIXED_VIEW, Vec4<float>(1.0f, 1.0f, 1.0f, 0.0f)).w == 0.0f, "Mat4<float> * Vec4<float> must be constexpr");
+}
+
+/**
+ * Операторы произведения (в том числе SIMD для float) совпадают с MulConstexpr
+ */
+void TestMat4Products()
+{
+    math::Mat4<float> a;
+    math::Mat4<float> b;
+    for(int i = 0; i < 16; i++){
+        a.data[i] = static_cast<float>(i + 1);
+        b.data[i] = static_cast<float>(16 - i) * 0.5f;
+    }
+
+    const math::Mat4<float> product = a * b;
+    const math::Mat4<float> expected = math::MulConstexpr(a, b);
+    for(int i = 0; i < 16; i++) CHECK(product.data[i] == expected.data[i]);
+
+    const math::Vec4<float> v(1.0f, -2.0f, 3.0f, -4.0f);
+    const math::Vec4<float> pv = a * v;
+    const math::Vec4<float> ev = math::MulConstexpr(a, v);
+    CHECK(pv.x == ev.x && pv.y == ev.y && pv.z == ev.z && pv.w == ev.w);
+}
+
+/**
+ * Композиция TRS совпадает с произведением матриц, если масштаб левой трансформации равномерный
+ */
+void TestTransformComposition()
+{
+    const math::Quat<float> r0 = math::Normalize(math::Quat<float>(0.3f, -0.2f, 0.5f, 0.8f));
+    const math::Quat<float> r1 = math::Normalize(math::Quat<float>(-0.6f, 0.1f, 0.2f, 0.7f));
+
+    const math::Transform<float> parent({1.0f, -2.0f, 0.5f}, r0, {1.5f, 1.5f, 1.5f});
+    const math::Transform<float> child({0.0f, 3.0f, -1.0f}, r1, {2.0f, 0.5f, 1.0f});
+    CHECK(parent.hasUniformScale());
+    CHECK(!child.hasUniformScale());
+
+    const math::Mat4<float> composed = (parent * child).toMat4();
+    const math::Mat4<float> expected = parent.toMat4() * child.toMat4();
+    float error = 0.0f;
+    for(int i = 0; i < 16; i++) error = std::max(error, std::fabs(composed.data[i] - expected.data[i]));
+    CHECK(error < 1e-5f);
+}
+
+int main()
+{
+    TestMat4Products();
+    TestTransformComposition();
+    return FailedChecks() == 0 ? 0 : 1;
+}
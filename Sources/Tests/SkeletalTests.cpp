@@ -0,0 +1,294 @@
+#include "Check.hpp"
+#include "Skinning.hpp"
+#include "AnimationCompression.hpp"
+#include "Skeleton.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+/**
+ * Скиннинг матрицами (SSE или скалярный путь, в зависимости от сборки) совпадает с эталонным смешиванием в double
+ * @details Те же проверки выполняются в сборке с MATH_NO_SIMD, поэтому оба пути сверяются с одним эталоном
+ */
+void TestSkinner()
+{
+    std::mt19937 rng(40);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+
+    // Палитра: поворот, неравномерный масштаб и перенос
+    const size_t boneCount = 6;
+    std::vector<math::Mat4<float>> bones(boneCount);
+    for(auto& bone : bones)
+    {
+        const math::Quat<float> r = math::Normalize(math::Quat<float>(u(rng), u(rng), u(rng), u(rng)));
+        bone = math::Transform<float>({u(rng) * 3.0f, u(rng) * 3.0f, u(rng) * 3.0f}, r, {1.0f + u(rng) * 0.5f, 1.0f, 1.0f + u(rng) * 0.5f}).toMat4();
+    }
+
+    std::vector<SkinVertex> vertices(61);
+    for(size_t i = 0; i < vertices.size(); i++)
+    {
+        SkinVertex& v = vertices[i];
+        v.position = {u(rng) * 2.0f, u(rng) * 2.0f, u(rng) * 2.0f};
+        v.normal = math::Normalize(math::Vec3<float>(u(rng), u(rng), u(rng)));
+
+        // От 1 до 4 влияющих костей, неиспользуемые ячейки с нулевым весом (в том числе в середине)
+        const size_t influences = 1 + i % 4;
+        float sum = 0.0f;
+        for(size_t j = 0; j < 4; j++)
+        {
+            v.boneIndices[j] = static_cast<std::uint16_t>((i + j * 2) % boneCount);
+            v.boneWeights[j] = j < influences ? 0.1f + std::fabs(u(rng)) : 0.0f;
+            sum += v.boneWeights[j];
+        }
+        for(float& w : v.boneWeights) w /= sum;
+        if(i % 7 == 3){
+            v.boneWeights[1] = 0.0f;
+            v.boneWeights[0] = 1.0f - v.boneWeights[2] - v.boneWeights[3];
+        }
+    }
+
+    // Нулевая нормаль и нулевые веса во всех ячейках - нормаль должна остаться нулевой (без NaN)
+    vertices[5].normal = {0.0f, 0.0f, 0.0f};
+    vertices[17].boneWeights[0] = 0.0f;
+    vertices[17].boneWeights[1] = 0.0f;
+    vertices[17].boneWeights[2] = 0.0f;
+    vertices[17].boneWeights[3] = 0.0f;
+
+    Skinner skinner;
+    skinner.setBoneTransforms(bones);
+    std::vector<SkinnedVertex> out(vertices.size());
+    skinner.skin(vertices.data(), vertices.size(), out.data());
+
+    double positionError = 0.0, normalError = 0.0;
+    for(size_t i = 0; i < vertices.size(); i++)
+    {
+        const SkinVertex& v = vertices[i];
+
+        // Эталон: взвешенная сумма матриц в double
+        double m[16] = {};
+        for(size_t j = 0; j < 4; j++){
+            for(size_t k = 0; k < 16; k++) m[k] += static_cast<double>(bones[v.boneIndices[j]].data[k]) * v.boneWeights[j];
+        }
+
+        const double p[3] = {v.position.x, v.position.y, v.position.z};
+        const double n[3] = {v.normal.x, v.normal.y, v.normal.z};
+        double ep[3], en[3];
+        for(size_t r = 0; r < 3; r++){
+            ep[r] = m[r * 4] * p[0] + m[r * 4 + 1] * p[1] + m[r * 4 + 2] * p[2] + m[r * 4 + 3];
+            en[r] = m[r * 4] * n[0] + m[r * 4 + 1] * n[1] + m[r * 4 + 2] * n[2];
+        }
+
+        const double length = std::sqrt(en[0] * en[0] + en[1] * en[1] + en[2] * en[2]);
+        for(double& c : en) c = length > 0.0 ? c / length : 0.0;
+
+        const SkinnedVertex& o = out[i];
+        const double op[3] = {o.position.x, o.position.y, o.position.z};
+        const double on[3] = {o.normal.x, o.normal.y, o.normal.z};
+        for(size_t r = 0; r < 3; r++){
+            positionError = std::max(positionError, std::fabs(op[r] - ep[r]));
+            normalError = std::max(normalError, std::fabs(on[r] - en[r]));
+            CHECK(!std::isnan(on[r]));
+        }
+    }
+
+    CHECK(positionError < 1e-4);
+    CHECK(normalError < 1e-4);
+    CHECK(out[5].normal.x == 0.0f && out[5].normal.y == 0.0f && out[5].normal.z == 0.0f);
+    CHECK(out[17].normal.x == 0.0f && out[17].normal.y == 0.0f && out[17].normal.z == 0.0f);
+}
+
+/**
+ * Максимальное отклонение векторов по компонентам
+ */
+float ComponentError(const math::Vec3<float>& a, const math::Vec3<float>& b)
+{
+    return std::max(std::fabs(a.x - b.x), std::max(std::fabs(a.y - b.y), std::fabs(a.z - b.z)));
+}
+
+/**
+ * Максимальное отклонение кватернионов по компонентам (q и -q - один поворот)
+ */
+float ComponentError(const math::Quat<float>& a, const math::Quat<float>& b)
+{
+    const math::Quat<float> c = math::Dot(a, b) < 0.0f ? -b : b;
+    return std::max(std::max(std::fabs(a.x - c.x), std::fabs(a.y - c.y)), std::max(std::fabs(a.z - c.z), std::fabs(a.w - c.w)));
+}
+
+/**
+ * Максимальная скорость изменения компонент канала (для оценки погрешности квантования времени)
+ * @tparam T Тип значения
+ * @param keys Ключи
+ * @return Скорость (единиц в секунду)
+ */
+template <typename T>
+float MaxChannelSpeed(const std::vector<AnimationClip::Key<T>>& keys)
+{
+    float speed = 0.0f;
+    for(size_t i = 1; i < keys.size(); i++){
+        const T d = keys[i].value - keys[i - 1].value;
+        const float dt = keys[i].time - keys[i - 1].time;
+        speed = std::max(speed, std::max(std::fabs(d.x), std::max(std::fabs(d.y), std::fabs(d.z))) / dt);
+    }
+    return speed;
+}
+
+/**
+ * Сжатый клип меньше ключей-матриц, а сжатое воспроизведение совпадает с исходным в пределах допуска и шага квантования
+ * (в том числе при зацикливании, когда время уходит назад)
+ */
+void TestCompressedAnimation()
+{
+    const size_t boneCount = 60;
+    const size_t keyCount = 300;
+    const float duration = 5.0f;
+    const float tolerance = 1e-3f;
+
+    // Плавные повороты всех костей, перенос только у корневой, пульсирующий масштаб у одной кости
+    AnimationClip clip(duration);
+    for(size_t b = 0; b < boneCount; b++)
+    {
+        AnimationClip::Track& track = clip.addTrack(b);
+        const float phase = static_cast<float>(b) * 0.37f;
+        const math::Vec3<float> axis = math::Normalize(math::Vec3<float>(std::sin(phase), 1.0f, std::cos(phase)));
+
+        for(size_t k = 0; k < keyCount; k++)
+        {
+            const float t = duration * static_cast<float>(k) / static_cast<float>(keyCount - 1);
+            const float angle = 40.0f * std::sin(t * 2.0f + phase);
+            track.rotationKeys.push_back({t, math::GetQuatFromAxisAngle(axis, angle)});
+            track.translationKeys.push_back({t, b == 0 ? math::Vec3<float>(std::sin(t) * 2.0f, 0.1f * t, 0.0f) : math::Vec3<float>(0.0f, 2.5f, 0.0f)});
+            if(b == 7) track.scaleKeys.push_back({t, math::Vec3<float>(1.0f, 1.0f, 1.0f) * (1.0f + 0.25f * std::sin(t * 3.0f))});
+        }
+    }
+
+    const CompressedAnimationClip compressed(clip, tolerance, tolerance, tolerance);
+
+    // Размер: не менее чем в 6 раз меньше, чем ключи в виде матриц 4x4
+    const size_t rawSize = boneCount * keyCount * sizeof(math::Mat4<float>);
+    std::printf("compressed animation: %zu bytes, %.1fx smaller than Mat4 keys\n", compressed.getMemorySize(),
+                static_cast<double>(rawSize) / static_cast<double>(compressed.getMemorySize()));
+    CHECK(compressed.getMemorySize() * 6 < rawSize);
+
+    // Допуски каналов: прореживание + шаг квантования значения + квантование времени ключа
+    const float timeStep = duration / 65535.0f;
+    std::vector<float> translationBound(boneCount), rotationBound(boneCount), scaleBound(boneCount);
+    for(size_t b = 0; b < boneCount; b++)
+    {
+        const AnimationClip::Track& track = clip.getTracks()[b];
+        const CompressedAnimationClip::Channel& translation = compressed.getChannel(b, CompressedAnimationClip::eTranslation);
+        const CompressedAnimationClip::Channel& scale = compressed.getChannel(b, CompressedAnimationClip::eScale);
+        const float translationStep = std::max(translation.extent[0], std::max(translation.extent[1], translation.extent[2])) / 65535.0f;
+        const float scaleStep = std::max(scale.extent[0], std::max(scale.extent[1], scale.extent[2])) / 65535.0f;
+
+        float rotationSpeed = 0.0f;
+        for(size_t k = 1; k < track.rotationKeys.size(); k++){
+            const float dt = track.rotationKeys[k].time - track.rotationKeys[k - 1].time;
+            rotationSpeed = std::max(rotationSpeed, ComponentError(track.rotationKeys[k].value, track.rotationKeys[k - 1].value) / dt);
+        }
+
+        translationBound[b] = tolerance + translationStep + MaxChannelSpeed(track.translationKeys) * timeStep;
+        rotationBound[b] = tolerance + 2.2e-5f + rotationSpeed * timeStep;
+        scaleBound[b] = tolerance + scaleStep + MaxChannelSpeed(track.scaleKeys) * timeStep;
+    }
+
+    AnimationSampler sampler(clip);
+    CompressedAnimationSampler compressedSampler(compressed);
+    std::vector<math::Transform<float>> pose(boneCount), compressedPose(boneCount);
+
+    // Неравномерный шаг: несколько полных циклов с переходом через конец клипа
+    size_t violations = 0;
+    float worst = 0.0f;
+    for(size_t step = 0; step < 1500; step++)
+    {
+        const float delta = 0.013f + 0.004f * static_cast<float>(step % 5);
+        sampler.advance(delta, pose.data());
+        compressedSampler.advance(delta, compressedPose.data());
+        CHECK(sampler.getTime() == compressedSampler.getTime());
+
+        for(size_t b = 0; b < boneCount; b++)
+        {
+            const float translationError = ComponentError(pose[b].translation, compressedPose[b].translation);
+            const float rotationError = ComponentError(pose[b].rotation, compressedPose[b].rotation);
+            const float scaleError = ComponentError(pose[b].scale, compressedPose[b].scale);
+            worst = std::max(worst, std::max(translationError, std::max(rotationError, scaleError)));
+
+            if(translationError > translationBound[b] || rotationError > rotationBound[b] || scaleError > scaleBound[b]) violations++;
+        }
+    }
+
+    // Произвольный доступ с временем, идущим назад (курсоры ключей должны сбрасываться)
+    for(float time = duration * 0.999f; time >= 0.0f; time -= 0.071f)
+    {
+        sampler.sample(time, pose.data());
+        compressedSampler.sample(time, compressedPose.data());
+        for(size_t b = 0; b < boneCount; b++)
+        {
+            if(ComponentError(pose[b].translation, compressedPose[b].translation) > translationBound[b] ||
+               ComponentError(pose[b].rotation, compressedPose[b].rotation) > rotationBound[b] ||
+               ComponentError(pose[b].scale, compressedPose[b].scale) > scaleBound[b]) violations++;
+        }
+    }
+
+    std::printf("compressed animation: max component error %g\n", static_cast<double>(worst));
+    CHECK(violations == 0);
+}
+
+/**
+ * Дуальные кватернионы скелета совпадают с матрицами для жестких костей, в том числе после смены bind-трансформации
+ * (обратная bind-трансформация в виде дуального кватерниона кэшируется и должна пересчитываться вместе с матрицей)
+ */
+void TestSkeletonDualQuats()
+{
+    std::mt19937 rng(43);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+
+    auto randomRigid = [&]() {
+        math::Transform<float> t;
+        t.translation = math::Vec3<float>(u(rng), u(rng), u(rng));
+        t.rotation = math::GetQuatFromAxisAngle(math::Vec3<float>(u(rng), u(rng), 1.0f), u(rng) * 180.0f);
+        return t;
+    };
+
+    // Цепочка с ветвлением
+    const std::vector<std::int32_t> parents = {-1, 0, 1, 2, 1, 4, 0};
+    std::vector<math::Transform<float>> binds(parents.size());
+    for(auto& bind : binds) bind = randomRigid();
+
+    Skeleton skeleton(parents, binds);
+    skeleton.setDualQuatsEnabled(true);
+
+    auto checkDualQuats = [&]() {
+        skeleton.update();
+        const auto& matrices = skeleton.getFinalBoneTransforms();
+        const auto& dualQuats = skeleton.getFinalBoneDualQuats();
+        for(size_t b = 0; b < parents.size(); b++)
+        {
+            const math::Vec3<float> p(u(rng) * 2.0f, u(rng) * 2.0f, u(rng) * 2.0f);
+            const math::Vec4<float> expected = matrices[b] * math::Vec4<float>(p.x, p.y, p.z, 1.0f);
+            const math::Vec3<float> actual = dualQuats[b] * p;
+            CHECK(std::fabs(expected.x - actual.x) < 1e-4f && std::fabs(expected.y - actual.y) < 1e-4f && std::fabs(expected.z - actual.z) < 1e-4f);
+        }
+    };
+
+    // Поза в bind-положении, затем анимированная поза
+    checkDualQuats();
+    for(size_t b = 0; b < parents.size(); b++) skeleton.getBoneByIndex(b)->setLocalTransform(randomRigid());
+    checkDualQuats();
+
+    // Смена bind-трансформации средней кости затрагивает ее ветвь
+    skeleton.getBoneByIndex(1)->setLocalBindTransform(randomRigid());
+    checkDualQuats();
+    skeleton.getBoneByIndex(5)->setTransformations(randomRigid(), randomRigid());
+    checkDualQuats();
+}
+
+int main()
+{
+    TestSkinner();
+    TestCompressedAnimation();
+    TestSkeletonDualQuats();
+    return FailedChecks() == 0 ? 0 : 1;
+}
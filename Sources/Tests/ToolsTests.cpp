@@ -0,0 +1,335 @@
+#include "Check.hpp"
+#include <AssetFile.hpp>
+#include <MeshImporter.hpp>
+#include <MeshSimplifier.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Выбрасывает ли функция std::runtime_error
+ * @tparam F Тип функции
+ * @param f Функция
+ * @return Было ли исключение
+ */
+template <typename F>
+bool Throws(F f)
+{
+    try { f(); }
+    catch(const std::runtime_error&) { return true; }
+    return false;
+}
+
+/**
+ * Прочитать файл целиком
+ * @param path Путь к файлу
+ * @return Содержимое
+ */
+std::vector<char> ReadFileBytes(const std::string& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+}
+
+/**
+ * Записать файл целиком
+ * @param path Путь к файлу
+ * @param bytes Содержимое
+ * @param size Сколько байт записать
+ */
+void WriteFileBytes(const std::string& path, const std::vector<char>& bytes, size_t size)
+{
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    stream.write(bytes.data(), static_cast<std::streamsize>(size));
+}
+
+/**
+ * Запись и чтение файла ассетов: 16- и 32-битные индексы, отсутствующие потоки, скелет, отказ от усеченного файла
+ */
+void TestAssetRoundTrip()
+{
+    const std::string path = "ToolsTests_RoundTrip.bga";
+    const std::string truncatedPath = "ToolsTests_Truncated.bga";
+
+    // Маленький меш: только положения и нормали, 32-битные исходные индексы сужаются до 16 бит
+    const std::vector<math::Vec3<float>> quadPositions = {{-1.0f, -1.0f, 0.0f}, {1.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.5f}, {-1.0f, 1.0f, 0.0f}};
+    const std::vector<math::Vec3<float>> quadNormals(4, math::Vec3<float>(0.0f, 0.0f, 1.0f));
+    const std::vector<std::uint32_t> quadIndices = {0, 1, 2, 2, 3, 0};
+
+    // Большой меш: больше 65536 вершин (32-битные индексы), без нормалей, с текстурными координатами и весами костей
+    const size_t bigCount = 70000;
+    std::vector<math::Vec3<float>> bigPositions(bigCount);
+    std::vector<math::Vec2<float>> bigTexCoords(bigCount);
+    std::vector<std::uint16_t> bigBoneIndices(bigCount * 4);
+    std::vector<float> bigBoneWeights(bigCount * 4);
+    for(size_t i = 0; i < bigCount; i++)
+    {
+        bigPositions[i] = {static_cast<float>(i % 256), static_cast<float>(i / 256), -static_cast<float>(i % 7)};
+        bigTexCoords[i] = {static_cast<float>(i) / bigCount, 1.0f - static_cast<float>(i) / bigCount};
+        for(size_t j = 0; j < 4; j++){
+            bigBoneIndices[i * 4 + j] = static_cast<std::uint16_t>((i + j) % 300);
+            bigBoneWeights[i * 4 + j] = 0.25f;
+        }
+    }
+    std::vector<size_t> bigIndices = {0, bigCount - 1, 65536, 65535, 12345, bigCount - 2};
+
+    // Скелет из трех костей
+    const std::vector<std::int32_t> parents = {-1, 0, 1};
+    std::vector<math::Transform<float>> binds(3);
+    binds[1].translation = {0.0f, 1.0f, 0.0f};
+    binds[2].translation = {0.0f, 2.0f, 0.0f};
+    binds[2].scale = {2.0f, 2.0f, 2.0f};
+    math::Mat4<float> globalInverse(1.0f);
+    globalInverse.data[12] = 5.0f;
+
+    tools::AssetWriter writer;
+    CHECK(writer.addMesh(quadPositions.data(), quadPositions.size(), quadIndices.data(), quadIndices.size(), quadNormals.data()) == 0);
+    CHECK(writer.addMesh(bigPositions.data(), bigCount, bigIndices.data(), bigIndices.size(), nullptr, bigTexCoords.data(), bigBoneIndices.data(), bigBoneWeights.data()) == 1);
+    CHECK(writer.addSkeleton(parents.data(), binds.data(), parents.size(), globalInverse) == 0);
+
+    // Индекс вне диапазона вершин не записывается
+    const std::vector<std::uint32_t> badIndices = {0, 1, 4};
+    CHECK(Throws([&]{ writer.addMesh(quadPositions.data(), quadPositions.size(), badIndices.data(), badIndices.size()); }));
+
+    writer.save(path);
+
+    {
+        tools::AssetFile file(path);
+        CHECK(file.getMeshCount() == 2);
+        CHECK(file.getSkeletonCount() == 1);
+
+        const tools::MeshView quad = file.getMesh(0);
+        CHECK(quad.vertexCount == 4 && quad.indexCount == 6 && quad.indexSize == 2);
+        CHECK(std::memcmp(quad.pPositions, quadPositions.data(), quadPositions.size() * sizeof(quadPositions[0])) == 0);
+        CHECK(std::memcmp(quad.pNormals, quadNormals.data(), quadNormals.size() * sizeof(quadNormals[0])) == 0);
+        CHECK(quad.pTexCoords == nullptr && quad.pBoneIndices == nullptr && quad.pBoneWeights == nullptr);
+        for(size_t i = 0; i < quadIndices.size(); i++) CHECK(quad.getIndex(i) == quadIndices[i]);
+        CHECK(quad.bounds.min.x == -1.0f && quad.bounds.min.z == 0.0f && quad.bounds.max.y == 1.0f && quad.bounds.max.z == 0.5f);
+
+        const tools::MeshView big = file.getMesh(1);
+        CHECK(big.vertexCount == bigCount && big.indexCount == bigIndices.size() && big.indexSize == 4);
+        CHECK(big.pNormals == nullptr);
+        CHECK(std::memcmp(big.pPositions, bigPositions.data(), bigCount * sizeof(bigPositions[0])) == 0);
+        CHECK(std::memcmp(big.pTexCoords, bigTexCoords.data(), bigCount * sizeof(bigTexCoords[0])) == 0);
+        CHECK(std::memcmp(big.pBoneIndices, bigBoneIndices.data(), bigBoneIndices.size() * sizeof(bigBoneIndices[0])) == 0);
+        CHECK(std::memcmp(big.pBoneWeights, bigBoneWeights.data(), bigBoneWeights.size() * sizeof(bigBoneWeights[0])) == 0);
+        for(size_t i = 0; i < bigIndices.size(); i++) CHECK(big.getIndex(i) == bigIndices[i]);
+
+        // Секции выровнены и используются на месте
+        CHECK(reinterpret_cast<std::uintptr_t>(big.pPositions) % tools::asset::SECTION_ALIGNMENT == 0);
+        CHECK(reinterpret_cast<std::uintptr_t>(big.pIndices) % tools::asset::SECTION_ALIGNMENT == 0);
+
+        const tools::SkeletonView skeleton = file.getSkeleton(0);
+        CHECK(skeleton.boneCount == 3);
+        CHECK(std::memcmp(skeleton.pParents, parents.data(), parents.size() * sizeof(parents[0])) == 0);
+        CHECK(std::memcmp(skeleton.pBindTransforms, binds.data(), binds.size() * sizeof(binds[0])) == 0);
+        CHECK(std::memcmp(skeleton.globalInverseTransform.data, globalInverse.data, sizeof(globalInverse.data)) == 0);
+    }
+
+    const std::vector<char> bytes = ReadFileBytes(path);
+    CHECK(bytes.size() > sizeof(tools::asset::FileHeader));
+
+    // Усеченный файл (размер не совпадает с заголовком)
+    WriteFileBytes(truncatedPath, bytes, bytes.size() - 1);
+    CHECK(Throws([&]{ tools::AssetFile file(truncatedPath); }));
+
+    // Усеченный файл с исправленным в заголовке размером (секции выходят за конец файла)
+    std::vector<char> patched(bytes.begin(), bytes.end() - 64);
+    const std::uint64_t patchedSize = patched.size();
+    std::memcpy(patched.data() + offsetof(tools::asset::FileHeader, fileSize), &patchedSize, sizeof(patchedSize));
+    WriteFileBytes(truncatedPath, patched, patched.size());
+    CHECK(Throws([&]{ tools::AssetFile file(truncatedPath); }));
+
+    // Файл короче заголовка и пустой файл
+    WriteFileBytes(truncatedPath, bytes, sizeof(tools::asset::FileHeader) - 1);
+    CHECK(Throws([&]{ tools::AssetFile file(truncatedPath); }));
+    WriteFileBytes(truncatedPath, bytes, 0);
+    CHECK(Throws([&]{ tools::AssetFile file(truncatedPath); }));
+
+    std::remove(path.c_str());
+    std::remove(truncatedPath.c_str());
+}
+
+/**
+ * Положения вершин треугольников меша по порядку индексов
+ * @param mesh Меш
+ * @return Массив положений (по 3 на треугольник)
+ */
+std::vector<math::Vec3<float>> TrianglePositions(const tools::ImportedMesh& mesh)
+{
+    std::vector<math::Vec3<float>> result;
+    for(const auto index : mesh.indices) result.push_back(mesh.positions[index]);
+    return result;
+}
+
+/**
+ * Равны ли массивы векторов
+ */
+bool SameVectors(const std::vector<math::Vec3<float>>& a, const std::vector<math::Vec3<float>>& b)
+{
+    if(a.size() != b.size()) return false;
+    for(size_t i = 0; i < a.size(); i++){
+        if(a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z) return false;
+    }
+    return true;
+}
+
+/**
+ * Импорт OBJ и PLY из файлов-образцов (Data): четырехугольники, отрицательные индексы, CRLF, двоичный PLY с обоими
+ * порядками байт, индексы вне диапазона. Большой OBJ, созданный на месте, разбирается одинаково в одном и в нескольких потоках
+ */
+void TestMeshImporter()
+{
+    const std::string data = TEST_DATA_DIR "/";
+
+    // Четырехугольник (веер из двух треугольников) и треугольник с другой нормалью
+    const std::vector<math::Vec3<float>> p = {{0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {2.0f, 0.0f, 0.5f}};
+    const std::vector<math::Vec3<float>> expected = {p[0], p[1], p[2], p[0], p[2], p[3], p[1], p[4], p[2]};
+
+    const tools::ImportedMesh obj = tools::LoadMesh(data + "QuadTriangle.obj");
+    CHECK(SameVectors(TrianglePositions(obj), expected));
+    CHECK(obj.positions.size() == 7);
+    CHECK(obj.normals.size() == 7 && obj.texCoords.size() == 7);
+    if(obj.indices.size() == expected.size() && obj.normals.size() == 7 && obj.texCoords.size() == 7)
+    {
+        for(size_t i = 0; i < 6; i++) CHECK(obj.normals[obj.indices[i]].z == 1.0f);
+        for(size_t i = 6; i < 9; i++) CHECK(obj.normals[obj.indices[i]].z == -1.0f);
+        CHECK(obj.texCoords[obj.indices[7]].x == 0.5f && obj.texCoords[obj.indices[7]].y == 0.5f);
+        CHECK(obj.texCoords[obj.indices[5]].x == 0.0f && obj.texCoords[obj.indices[5]].y == 1.0f);
+    }
+    CHECK(obj.bounds.max.x == 2.0f && obj.bounds.max.z == 0.5f);
+
+    for(const char* name : {"QuadTriangleLE.ply", "QuadTriangleBE.ply"})
+    {
+        const tools::ImportedMesh ply = tools::LoadMesh(data + name);
+        CHECK(SameVectors(ply.positions, p));
+        CHECK(SameVectors(TrianglePositions(ply), expected));
+        CHECK(ply.normals.empty() && ply.texCoords.empty());
+    }
+
+    CHECK(Throws([&]{ tools::LoadMesh(data + "BadIndex.obj"); }));
+    CHECK(Throws([&]{ tools::LoadMesh(data + "BadIndex.ply"); }));
+    CHECK(Throws([&]{ tools::LoadMesh(data + "Missing.obj"); }));
+
+    // Усеченный двоичный PLY
+    const std::string truncatedPath = "ToolsTests_Truncated.ply";
+    const std::vector<char> ply = ReadFileBytes(data + "QuadTriangleLE.ply");
+    WriteFileBytes(truncatedPath, ply, ply.size() - 3);
+    CHECK(Throws([&]{ tools::LoadMesh(truncatedPath); }));
+    std::remove(truncatedPath.c_str());
+
+    // Сетка из нескольких отрезков разбора (больше 256 Кб), грани ссылаются на вершины относительными индексами
+    const std::string gridPath = "ToolsTests_Grid.obj";
+    const int gridSize = 160;
+    {
+        std::ofstream stream(gridPath, std::ios::binary | std::ios::trunc);
+        for(int y = 0; y <= gridSize; y++)
+        {
+            for(int x = 0; x <= gridSize; x++) stream << "v " << x << " " << y << " " << (x * y) % 13 << "\r\n";
+            if(y == 0) continue;
+
+            // Вершины предыдущего ряда - на (gridSize + 1) * 2 назад от конца текущего
+            const int row = gridSize + 1;
+            for(int x = 0; x < gridSize; x++){
+                stream << "f " << x - 2 * row << " " << x + 1 - 2 * row << " " << x + 1 - row << " " << x - row << "\r\n";
+            }
+        }
+    }
+
+    tools::ThreadPool pool(4);
+    const tools::ImportedMesh serial = tools::LoadObj(gridPath);
+    const tools::ImportedMesh parallel = tools::LoadObj(gridPath, &pool);
+    CHECK(serial.indices.size() == static_cast<size_t>(gridSize * gridSize * 6));
+    CHECK(serial.positions.size() == static_cast<size_t>((gridSize + 1) * (gridSize + 1)));
+    CHECK(serial.indices == parallel.indices);
+    CHECK(SameVectors(serial.positions, parallel.positions));
+
+    // Первый четырехугольник: (0,0) (1,0) (1,1) (0,1)
+    if(serial.indices.size() >= 3){
+        const math::Vec3<float>& c = serial.positions[serial.indices[2]];
+        CHECK(c.x == 1.0f && c.y == 1.0f && c.z == 1.0f);
+    }
+    std::remove(gridPath.c_str());
+}
+
+/**
+ * UV-сфера единичного радиуса со своей вершиной полюса у каждого столбца (треугольники у полюсов нулевой площади)
+ * @param segments Кол-во столбцов
+ * @param rings Кол-во колец
+ * @return Меш
+ */
+tools::ImportedMesh MakeUvSphere(unsigned segments, unsigned rings)
+{
+    tools::ImportedMesh mesh;
+    for(unsigned r = 0; r <= rings; r++)
+    {
+        for(unsigned s = 0; s <= segments; s++)
+        {
+            const float theta = 180.0f * static_cast<float>(r) / static_cast<float>(rings);
+            const float phi = 360.0f * static_cast<float>(s) / static_cast<float>(segments);
+            mesh.positions.push_back(math::RotateAroundY(math::RotateAroundZ(math::Vec3<float>(0.0f, 1.0f, 0.0f), theta), phi));
+        }
+    }
+
+    // Полюсные вершины одного положения - точные копии (как в экспортированных сетках)
+    for(unsigned s = 0; s <= segments; s++){
+        mesh.positions[s] = {0.0f, 1.0f, 0.0f};
+        mesh.positions[rings * (segments + 1) + s] = {0.0f, -1.0f, 0.0f};
+    }
+
+    for(unsigned r = 0; r < rings; r++)
+    {
+        for(unsigned s = 0; s < segments; s++)
+        {
+            const std::uint32_t a = r * (segments + 1) + s, b = a + 1, c = a + segments + 1, d = c + 1;
+            mesh.indices.insert(mesh.indices.end(), {a, c, b, b, c, d});
+        }
+    }
+    mesh.bounds = math::FindBoundingBox(mesh.positions);
+    return mesh;
+}
+
+/**
+ * Измерение отклонения не учитывает вырожденные треугольники, цепочка уровней сферы с вырожденными полюсами строится
+ * с неубывающей ошибкой
+ */
+void TestMeshDeviation()
+{
+    const tools::ImportedMesh sphere = MakeUvSphere(48, 24);
+    const std::vector<std::uint32_t>& indices = sphere.indices;
+
+    CHECK(tools::MeasureMeshDeviation(sphere.positions.data(), indices.data(), indices.size(), indices.data(), indices.size()) < 1e-5f);
+
+    // Треугольник нулевой площади от полюса к полюсу (через центр сферы) поверхность не меняет
+    std::vector<std::uint32_t> withSliver = indices;
+    const std::uint32_t north = 0, south = static_cast<std::uint32_t>(sphere.positions.size() - 1);
+    withSliver.insert(withSliver.end(), {north, south, north + 1});
+    CHECK(tools::MeasureMeshDeviation(sphere.positions.data(), indices.data(), indices.size(), withSliver.data(), withSliver.size()) < 1e-5f);
+
+    // Настоящее отклонение: сфера, от которой отрезана нижняя половина треугольников
+    const std::vector<std::uint32_t> half(indices.begin(), indices.begin() + static_cast<std::ptrdiff_t>(indices.size() / 2));
+    CHECK(tools::MeasureMeshDeviation(sphere.positions.data(), indices.data(), indices.size(), half.data(), half.size()) > 0.1f);
+
+    const std::vector<tools::MeshLod> lods = tools::BuildLodChain(sphere, 6);
+    CHECK(lods.size() >= 3);
+    for(size_t i = 1; i < lods.size(); i++)
+    {
+        CHECK(lods[i].indices.size() < lods[i - 1].indices.size());
+        CHECK(lods[i].error >= lods[i - 1].error);
+    }
+    if(lods.size() >= 2) CHECK(lods[1].error > 0.0f && lods[1].error < 0.05f);
+}
+
+int main()
+{
+    TestAssetRoundTrip();
+    TestMeshImporter();
+    TestMeshDeviation();
+    return FailedChecks() == 0 ? 0 : 1;
+}
@@ -0,0 +1,480 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+#include <Math.hpp>
+
+#include "MappedFile.hpp"
+
+namespace tools
+{
+    /**
+     * Бинарный формат ассетов (меши и скелеты)
+     * @details Файл состоит из заголовка, таблицы мешей, таблицы скелетов и секций данных. Каждая секция (поток вершин,
+     * массив индексов, массив родителей, bind-поза) выровнена по 16 байт, смещения отсчитываются от начала файла.
+     * Данные хранятся в том виде, в каком используются (little-endian, float), поэтому после отображения файла в
+     * память буферы используются на месте - без разбора и копирования
+     */
+    namespace asset
+    {
+        /// Сигнатура файла ("BGA1")
+        constexpr std::uint32_t FILE_MAGIC = 0x31414742u;
+        /// Версия формата
+        constexpr std::uint32_t FILE_VERSION = 1;
+        /// Выравнивание секций данных
+        constexpr std::uint64_t SECTION_ALIGNMENT = 16;
+
+        /**
+         * Потоки вершин (каждый атрибут хранится отдельным массивом)
+         */
+        enum VertexStream : std::uint32_t
+        {
+            ePosition,      ///< Положения (float x 3)
+            eNormal,        ///< Нормали (float x 3)
+            eTexCoord,      ///< Текстурные координаты (float x 2)
+            eBoneIndices,   ///< Индексы костей (uint16 x 4)
+            eBoneWeights,   ///< Веса костей (float x 4)
+            eStreamCount
+        };
+
+        /// Размер элемента каждого потока в байтах
+        constexpr std::uint32_t STREAM_ELEMENT_SIZE[eStreamCount] = {12, 12, 8, 8, 16};
+
+        /**
+         * Заголовок файла
+         */
+        struct FileHeader
+        {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t meshCount;
+            std::uint32_t skeletonCount;
+            std::uint64_t meshTableOffset;
+            std::uint64_t skeletonTableOffset;
+            std::uint64_t fileSize;
+        };
+
+        /**
+         * Запись таблицы мешей
+         */
+        struct MeshRecord
+        {
+            std::uint32_t vertexCount;
+            std::uint32_t indexCount;
+            /// Размер индекса в байтах (2 или 4)
+            std::uint32_t indexSize;
+            /// Маска присутствующих потоков вершин (бит на поток)
+            std::uint32_t streamMask;
+            float boundsMin[3];
+            float boundsMax[3];
+            std::uint64_t indexOffset;
+            /// Смещения потоков вершин (0 для отсутствующих)
+            std::uint64_t streamOffsets[eStreamCount];
+        };
+
+        /**
+         * Запись таблицы скелетов
+         */
+        struct SkeletonRecord
+        {
+            std::uint32_t boneCount;
+            std::uint32_t reserved;
+            /// Смещение массива индексов родителей (int32, -1 для корневой кости)
+            std::uint64_t parentsOffset;
+            /// Смещение массива локальных bind-трансформаций (math::Transform<float>)
+            std::uint64_t bindTransformsOffset;
+            /// Матрица глобальной инверсии
+            float globalInverseTransform[16];
+        };
+
+        static_assert(sizeof(FileHeader) == 40, "Asset file header layout must be fixed");
+        static_assert(sizeof(MeshRecord) == 88, "Asset mesh record layout must be fixed");
+        static_assert(sizeof(SkeletonRecord) == 88, "Asset skeleton record layout must be fixed");
+        static_assert(sizeof(math::Vec3<float>) == 12 && std::is_trivially_copyable<math::Vec3<float>>::value, "Vec3 must be usable in place");
+        static_assert(sizeof(math::Vec2<float>) == 8 && std::is_trivially_copyable<math::Vec2<float>>::value, "Vec2 must be usable in place");
+        static_assert(sizeof(math::Transform<float>) == 40 && std::is_trivially_copyable<math::Transform<float>>::value, "Transform must be usable in place");
+        static_assert(sizeof(math::Mat4<float>) == 64, "Mat4 must be usable in place");
+    }
+
+    /**
+     * Меш из файла ассетов (указатели на данные внутри отображенного файла)
+     */
+    struct MeshView
+    {
+        /// Кол-во вершин
+        std::uint32_t vertexCount = 0;
+        /// Кол-во индексов
+        std::uint32_t indexCount = 0;
+        /// Размер индекса в байтах (2 или 4)
+        std::uint32_t indexSize = 0;
+        /// Описывающий параллелепипед
+        math::BBox<math::Vec3<float>> bounds;
+
+        /// Положения вершин
+        const math::Vec3<float>* pPositions = nullptr;
+        /// Нормали (nullptr если нет)
+        const math::Vec3<float>* pNormals = nullptr;
+        /// Текстурные координаты (nullptr если нет)
+        const math::Vec2<float>* pTexCoords = nullptr;
+        /// Индексы костей, по 4 на вершину (nullptr если нет)
+        const std::uint16_t* pBoneIndices = nullptr;
+        /// Веса костей, по 4 на вершину (nullptr если нет)
+        const float* pBoneWeights = nullptr;
+        /// Индексы (uint16 или uint32 в зависимости от indexSize)
+        const void* pIndices = nullptr;
+
+        /**
+         * Получить индекс
+         * @param i Номер индекса
+         * @return Индекс вершины
+         */
+        [[nodiscard]] std::uint32_t getIndex(size_t i) const
+        {
+            return indexSize == 2 ? static_cast<const std::uint16_t*>(pIndices)[i] : static_cast<const std::uint32_t*>(pIndices)[i];
+        }
+    };
+
+    /**
+     * Скелет из файла ассетов (указатели на данные внутри отображенного файла)
+     */
+    struct SkeletonView
+    {
+        /// Кол-во костей
+        std::uint32_t boneCount = 0;
+        /// Индексы родительских костей (-1 для корневой)
+        const std::int32_t* pParents = nullptr;
+        /// Локальные bind-трансформации
+        const math::Transform<float>* pBindTransforms = nullptr;
+        /// Матрица глобальной инверсии
+        math::Mat4<float> globalInverseTransform;
+    };
+
+    /**
+     * Запись файла ассетов
+     * @details Данные копируются при добавлении, файл пишется одним вызовом save
+     */
+    class AssetWriter
+    {
+    private:
+        /// Записи мешей (смещения относительно начала секций данных)
+        std::vector<asset::MeshRecord> meshes_;
+        /// Записи скелетов (смещения относительно начала секций данных)
+        std::vector<asset::SkeletonRecord> skeletons_;
+        /// Секции данных
+        std::vector<std::uint8_t> data_;
+
+        /**
+         * Добавить секцию данных
+         * @param pData Указатель на данные
+         * @param size Размер в байтах
+         * @return Смещение секции относительно начала секций данных
+         */
+        std::uint64_t appendSection(const void* pData, size_t size)
+        {
+            data_.resize((data_.size() + asset::SECTION_ALIGNMENT - 1) & ~(asset::SECTION_ALIGNMENT - 1), 0);
+            const std::uint64_t offset = data_.size();
+            data_.resize(data_.size() + size);
+            if(size > 0) std::memcpy(data_.data() + offset, pData, size);
+            return offset;
+        }
+
+    public:
+        /**
+         * Добавить меш
+         * @details Для мешей до 65536 вершин индексы сохраняются 16-битными
+         * @tparam IndexType Тип исходных индексов
+         * @param pPositions Положения вершин
+         * @param vertexCount Кол-во вершин
+         * @param pIndices Индексы
+         * @param indexCount Кол-во индексов
+         * @param pNormals Нормали (nullptr если нет)
+         * @param pTexCoords Текстурные координаты (nullptr если нет)
+         * @param pBoneIndices Индексы костей, по 4 на вершину (nullptr если нет)
+         * @param pBoneWeights Веса костей, по 4 на вершину (nullptr если нет)
+         * @return Номер меша в файле
+         */
+        template <typename IndexType>
+        size_t addMesh(const math::Vec3<float>* pPositions,
+                       size_t vertexCount,
+                       const IndexType* pIndices,
+                       size_t indexCount,
+                       const math::Vec3<float>* pNormals = nullptr,
+                       const math::Vec2<float>* pTexCoords = nullptr,
+                       const std::uint16_t* pBoneIndices = nullptr,
+                       const float* pBoneWeights = nullptr)
+        {
+            if(vertexCount > UINT32_MAX || indexCount > UINT32_MAX){
+                throw std::runtime_error("ERROR: Mesh is too large for asset file");
+            }
+
+            asset::MeshRecord record = {};
+            record.vertexCount = static_cast<std::uint32_t>(vertexCount);
+            record.indexCount = static_cast<std::uint32_t>(indexCount);
+            record.indexSize = vertexCount <= 0x10000 ? 2 : 4;
+
+            const auto bounds = math::FindBoundingBox(pPositions, vertexCount);
+            record.boundsMin[0] = bounds.min.x; record.boundsMin[1] = bounds.min.y; record.boundsMin[2] = bounds.min.z;
+            record.boundsMax[0] = bounds.max.x; record.boundsMax[1] = bounds.max.y; record.boundsMax[2] = bounds.max.z;
+
+            const void* streams[asset::eStreamCount] = {pPositions, pNormals, pTexCoords, pBoneIndices, pBoneWeights};
+            for(std::uint32_t s = 0; s < asset::eStreamCount; s++)
+            {
+                if(streams[s] == nullptr) continue;
+                record.streamMask |= 1u << s;
+                record.streamOffsets[s] = appendSection(streams[s], vertexCount * asset::STREAM_ELEMENT_SIZE[s]);
+            }
+
+            // Индексы сужаются до выбранного размера с проверкой диапазона
+            std::vector<std::uint8_t> indices(indexCount * record.indexSize);
+            for(size_t i = 0; i < indexCount; i++)
+            {
+                const auto index = static_cast<std::uint64_t>(pIndices[i]);
+                if(index >= vertexCount){
+                    throw std::runtime_error("ERROR: Mesh index is out of range");
+                }
+
+                if(record.indexSize == 2){
+                    const auto narrow = static_cast<std::uint16_t>(index);
+                    std::memcpy(indices.data() + i * 2, &narrow, 2);
+                }else{
+                    const auto narrow = static_cast<std::uint32_t>(index);
+                    std::memcpy(indices.data() + i * 4, &narrow, 4);
+                }
+            }
+            record.indexOffset = appendSection(indices.data(), indices.size());
+
+            meshes_.push_back(record);
+            return meshes_.size() - 1;
+        }
+
+        /**
+         * Добавить скелет
+         * @param pParents Индексы родительских костей (-1 для корневой)
+         * @param pBindTransforms Локальные bind-трансформации
+         * @param boneCount Кол-во костей
+         * @param globalInverseTransform Матрица глобальной инверсии
+         * @return Номер скелета в файле
+         */
+        size_t addSkeleton(const std::int32_t* pParents,
+                           const math::Transform<float>* pBindTransforms,
+                           size_t boneCount,
+                           const math::Mat4<float>& globalInverseTransform = math::Mat4<float>(1.0f))
+        {
+            if(boneCount > UINT32_MAX){
+                throw std::runtime_error("ERROR: Skeleton is too large for asset file");
+            }
+
+            asset::SkeletonRecord record = {};
+            record.boneCount = static_cast<std::uint32_t>(boneCount);
+            record.parentsOffset = appendSection(pParents, boneCount * sizeof(std::int32_t));
+            record.bindTransformsOffset = appendSection(pBindTransforms, boneCount * sizeof(math::Transform<float>));
+            std::memcpy(record.globalInverseTransform, globalInverseTransform.data, sizeof(record.globalInverseTransform));
+
+            skeletons_.push_back(record);
+            return skeletons_.size() - 1;
+        }
+
+        /**
+         * Записать файл
+         * @param path Путь к файлу
+         */
+        void save(const std::string& path) const
+        {
+            const auto align = [](std::uint64_t value){ return (value + asset::SECTION_ALIGNMENT - 1) & ~(asset::SECTION_ALIGNMENT - 1); };
+
+            asset::FileHeader header = {};
+            header.magic = asset::FILE_MAGIC;
+            header.version = asset::FILE_VERSION;
+            header.meshCount = static_cast<std::uint32_t>(meshes_.size());
+            header.skeletonCount = static_cast<std::uint32_t>(skeletons_.size());
+            header.meshTableOffset = align(sizeof(asset::FileHeader));
+            header.skeletonTableOffset = align(header.meshTableOffset + meshes_.size() * sizeof(asset::MeshRecord));
+
+            const std::uint64_t dataOffset = align(header.skeletonTableOffset + skeletons_.size() * sizeof(asset::SkeletonRecord));
+            header.fileSize = dataOffset + data_.size();
+
+            // Смещения секций переводятся в смещения от начала файла
+            std::vector<asset::MeshRecord> meshes = meshes_;
+            for(auto& mesh : meshes)
+            {
+                mesh.indexOffset += dataOffset;
+                for(std::uint32_t s = 0; s < asset::eStreamCount; s++){
+                    if(mesh.streamMask & (1u << s)) mesh.streamOffsets[s] += dataOffset;
+                }
+            }
+
+            std::vector<asset::SkeletonRecord> skeletons = skeletons_;
+            for(auto& skeleton : skeletons)
+            {
+                skeleton.parentsOffset += dataOffset;
+                skeleton.bindTransformsOffset += dataOffset;
+            }
+
+            std::vector<std::uint8_t> file(static_cast<size_t>(header.fileSize), 0);
+            std::memcpy(file.data(), &header, sizeof(header));
+            if(!meshes.empty()) std::memcpy(file.data() + header.meshTableOffset, meshes.data(), meshes.size() * sizeof(asset::MeshRecord));
+            if(!skeletons.empty()) std::memcpy(file.data() + header.skeletonTableOffset, skeletons.data(), skeletons.size() * sizeof(asset::SkeletonRecord));
+            if(!data_.empty()) std::memcpy(file.data() + dataOffset, data_.data(), data_.size());
+
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            if(!stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()))){
+                throw std::runtime_error("ERROR: Can't write asset file " + path);
+            }
+        }
+    };
+
+    /**
+     * Файл ассетов, отображенный в память
+     * @details Все смещения и размеры проверяются один раз при открытии, после чего меши и скелеты отдаются указателями
+     * прямо в отображенный файл. Указатели действительны все время жизни объекта
+     */
+    class AssetFile
+    {
+    private:
+        /// Отображенный файл
+        MappedFile file_;
+        /// Заголовок
+        const asset::FileHeader* pHeader_ = nullptr;
+        /// Таблица мешей
+        const asset::MeshRecord* pMeshes_ = nullptr;
+        /// Таблица скелетов
+        const asset::SkeletonRecord* pSkeletons_ = nullptr;
+
+        /**
+         * Проверить, что секция лежит внутри файла и выровнена
+         * @param offset Смещение секции
+         * @param count Кол-во элементов
+         * @param elementSize Размер элемента
+         * @return Секция корректна
+         */
+        [[nodiscard]] bool isValidSection(std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize) const
+        {
+            const std::uint64_t size = file_.getSize();
+            return offset % asset::SECTION_ALIGNMENT == 0 && offset <= size && count * elementSize <= size - offset;
+        }
+
+    public:
+        /**
+         * Конструктор
+         * @param path Путь к файлу
+         */
+        explicit AssetFile(const std::string& path):file_(path)
+        {
+            const std::uint8_t* pData = file_.getData();
+
+            if(file_.getSize() < sizeof(asset::FileHeader)){
+                throw std::runtime_error("ERROR: Asset file is too small " + path);
+            }
+
+            pHeader_ = reinterpret_cast<const asset::FileHeader*>(pData);
+            if(pHeader_->magic != asset::FILE_MAGIC || pHeader_->version != asset::FILE_VERSION || pHeader_->fileSize != file_.getSize()){
+                throw std::runtime_error("ERROR: Invalid asset file header " + path);
+            }
+
+            if(!isValidSection(pHeader_->meshTableOffset, pHeader_->meshCount, sizeof(asset::MeshRecord)) ||
+               !isValidSection(pHeader_->skeletonTableOffset, pHeader_->skeletonCount, sizeof(asset::SkeletonRecord))){
+                throw std::runtime_error("ERROR: Invalid asset file tables " + path);
+            }
+
+            pMeshes_ = reinterpret_cast<const asset::MeshRecord*>(pData + pHeader_->meshTableOffset);
+            pSkeletons_ = reinterpret_cast<const asset::SkeletonRecord*>(pData + pHeader_->skeletonTableOffset);
+
+            for(std::uint32_t i = 0; i < pHeader_->meshCount; i++)
+            {
+                const asset::MeshRecord& mesh = pMeshes_[i];
+                bool valid = (mesh.indexSize == 2 || mesh.indexSize == 4) &&
+                        (mesh.streamMask & (1u << asset::ePosition)) != 0 &&
+                        isValidSection(mesh.indexOffset, mesh.indexCount, mesh.indexSize);
+
+                for(std::uint32_t s = 0; s < asset::eStreamCount && valid; s++){
+                    valid = (mesh.streamMask & (1u << s)) == 0 || isValidSection(mesh.streamOffsets[s], mesh.vertexCount, asset::STREAM_ELEMENT_SIZE[s]);
+                }
+
+                if(!valid){
+                    throw std::runtime_error("ERROR: Invalid mesh record in asset file " + path);
+                }
+            }
+
+            for(std::uint32_t i = 0; i < pHeader_->skeletonCount; i++)
+            {
+                const asset::SkeletonRecord& skeleton = pSkeletons_[i];
+                if(!isValidSection(skeleton.parentsOffset, skeleton.boneCount, sizeof(std::int32_t)) ||
+                   !isValidSection(skeleton.bindTransformsOffset, skeleton.boneCount, sizeof(math::Transform<float>))){
+                    throw std::runtime_error("ERROR: Invalid skeleton record in asset file " + path);
+                }
+            }
+        }
+
+        /**
+         * Получить кол-во мешей
+         * @return Кол-во мешей
+         */
+        [[nodiscard]] size_t getMeshCount() const
+        {
+            return pHeader_->meshCount;
+        }
+
+        /**
+         * Получить кол-во скелетов
+         * @return Кол-во скелетов
+         */
+        [[nodiscard]] size_t getSkeletonCount() const
+        {
+            return pHeader_->skeletonCount;
+        }
+
+        /**
+         * Получить меш
+         * @details Индексы вершин не проверяются - файл должен быть записан AssetWriter
+         * @param index Номер меша
+         * @return Меш с указателями на данные в файле
+         */
+        [[nodiscard]] MeshView getMesh(size_t index) const
+        {
+            const asset::MeshRecord& record = pMeshes_[index];
+            const std::uint8_t* pData = file_.getData();
+            const auto stream = [&](asset::VertexStream s) -> const void* {
+                return (record.streamMask & (1u << s)) != 0 ? pData + record.streamOffsets[s] : nullptr;
+            };
+
+            MeshView view;
+            view.vertexCount = record.vertexCount;
+            view.indexCount = record.indexCount;
+            view.indexSize = record.indexSize;
+            view.bounds.min = {record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]};
+            view.bounds.max = {record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]};
+            view.pPositions = static_cast<const math::Vec3<float>*>(stream(asset::ePosition));
+            view.pNormals = static_cast<const math::Vec3<float>*>(stream(asset::eNormal));
+            view.pTexCoords = static_cast<const math::Vec2<float>*>(stream(asset::eTexCoord));
+            view.pBoneIndices = static_cast<const std::uint16_t*>(stream(asset::eBoneIndices));
+            view.pBoneWeights = static_cast<const float*>(stream(asset::eBoneWeights));
+            view.pIndices = pData + record.indexOffset;
+            return view;
+        }
+
+        /**
+         * Получить скелет
+         * @details Для построения Skeleton массивы передаются в конструктор по индексам родителей
+         * @param index Номер скелета
+         * @return Скелет с указателями на данные в файле
+         */
+        [[nodiscard]] SkeletonView getSkeleton(size_t index) const
+        {
+            const asset::SkeletonRecord& record = pSkeletons_[index];
+            const std::uint8_t* pData = file_.getData();
+
+            SkeletonView view;
+            view.boneCount = record.boneCount;
+            view.pParents = reinterpret_cast<const std::int32_t*>(pData + record.parentsOffset);
+            view.pBindTransforms = reinterpret_cast<const math::Transform<float>*>(pData + record.bindTransformsOffset);
+            std::memcpy(view.globalInverseTransform.data, record.globalInverseTransform, sizeof(record.globalInverseTransform));
+            return view;
+        }
+    };
+}
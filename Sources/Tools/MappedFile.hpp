@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tools
+{
+    /**
+     * Файл, отображенный в память (только чтение)
+     * @details Содержимое файла не копируется и не читается заранее - страницы подгружаются системой при первом обращении.
+     * Указатель на данные выровнен по границе страницы и действителен все время жизни объекта
+     */
+    class MappedFile
+    {
+    private:
+#ifdef _WIN32
+        /// Дескриптор файла
+        HANDLE file_ = INVALID_HANDLE_VALUE;
+        /// Дескриптор отображения
+        HANDLE mapping_ = nullptr;
+#else
+        /// Дескриптор файла
+        int file_ = -1;
+#endif
+        /// Указатель на начало отображения
+        const std::uint8_t* pData_ = nullptr;
+        /// Размер файла в байтах
+        size_t size_ = 0;
+
+        /**
+         * Освободить отображение и закрыть файл
+         */
+        void close() noexcept
+        {
+#ifdef _WIN32
+            if(pData_ != nullptr) UnmapViewOfFile(pData_);
+            if(mapping_ != nullptr) CloseHandle(mapping_);
+            if(file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+            mapping_ = nullptr;
+#else
+            if(pData_ != nullptr) munmap(const_cast<std::uint8_t*>(pData_), size_);
+            if(file_ != -1) ::close(file_);
+            file_ = -1;
+#endif
+            pData_ = nullptr;
+            size_ = 0;
+        }
+
+    public:
+        /**
+         * Конструктор
+         * @param path Путь к файлу
+         */
+        explicit MappedFile(const std::string& path)
+        {
+#ifdef _WIN32
+            file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if(file_ == INVALID_HANDLE_VALUE){
+                throw std::runtime_error("ERROR: Can't open file " + path);
+            }
+
+            LARGE_INTEGER fileSize;
+            if(!GetFileSizeEx(file_, &fileSize)){
+                close();
+                throw std::runtime_error("ERROR: Can't get size of file " + path);
+            }
+            size_ = static_cast<size_t>(fileSize.QuadPart);
+
+            // Пустой файл отобразить нельзя - считаем его файлом без данных
+            if(size_ == 0) return;
+
+            mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if(mapping_ == nullptr){
+                close();
+                throw std::runtime_error("ERROR: Can't create mapping of file " + path);
+            }
+
+            pData_ = static_cast<const std::uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+            if(pData_ == nullptr){
+                close();
+                throw std::runtime_error("ERROR: Can't map file " + path);
+            }
+#else
+            file_ = ::open(path.c_str(), O_RDONLY);
+            if(file_ == -1){
+                throw std::runtime_error("ERROR: Can't open file " + path);
+            }
+
+            struct stat fileStat = {};
+            if(fstat(file_, &fileStat) != 0){
+                close();
+                throw std::runtime_error("ERROR: Can't get size of file " + path);
+            }
+            size_ = static_cast<size_t>(fileStat.st_size);
+
+            // Пустой файл отобразить нельзя - считаем его файлом без данных
+            if(size_ == 0) return;
+
+            void* pMapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_, 0);
+            if(pMapped == MAP_FAILED){
+                size_ = 0;
+                close();
+                throw std::runtime_error("ERROR: Can't map file " + path);
+            }
+            pData_ = static_cast<const std::uint8_t*>(pMapped);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * Деструктор
+         */
+        ~MappedFile()
+        {
+            close();
+        }
+
+        /**
+         * Получить указатель на содержимое файла
+         * @return Указатель на первый байт (nullptr для пустого файла)
+         */
+        [[nodiscard]] const std::uint8_t* getData() const
+        {
+            return pData_;
+        }
+
+        /**
+         * Получить размер файла
+         * @return Размер в байтах
+         */
+        [[nodiscard]] size_t getSize() const
+        {
+            return size_;
+        }
+    };
+}
@@ -0,0 +1,1079 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <Math.hpp>
+
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+namespace tools
+{
+    /**
+     * Импортированный меш (индексированные буферы)
+     */
+    struct ImportedMesh
+    {
+        /// Положения вершин
+        std::vector<math::Vec3<float>> positions;
+        /// Нормали (пустой массив если в файле их нет)
+        std::vector<math::Vec3<float>> normals;
+        /// Текстурные координаты (пустой массив если в файле их нет)
+        std::vector<math::Vec2<float>> texCoords;
+        /// Индексы (тройки вершин)
+        std::vector<std::uint32_t> indices;
+        /// Описывающий параллелепипед
+        math::BBox<math::Vec3<float>> bounds;
+    };
+
+    namespace detail
+    {
+        /// Степени 10, точно представимые в double
+        constexpr double POW10[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        /**
+         * Отрезок текста
+         */
+        struct TextChunk
+        {
+            const char* pBegin;
+            const char* pEnd;
+        };
+
+        inline bool IsSpace(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        inline bool IsDigit(char c)
+        {
+            return static_cast<unsigned>(c - '0') < 10u;
+        }
+
+        /**
+         * Является ли символ концом значения (пробел, конец строки или начало комментария)
+         * @param p Указатель на символ
+         * @param pEnd Конец текста
+         * @return Да или нет
+         */
+        inline bool IsTokenEnd(const char* p, const char* pEnd)
+        {
+            return p >= pEnd || IsSpace(*p) || *p == '\n' || *p == '#';
+        }
+
+        inline const char* SkipSpaces(const char* p, const char* pEnd)
+        {
+            while(p < pEnd && IsSpace(*p)) p++;
+            return p;
+        }
+
+        inline const char* SkipToken(const char* p, const char* pEnd)
+        {
+            while(p < pEnd && !IsSpace(*p) && *p != '\n') p++;
+            return p;
+        }
+
+        inline const char* SkipLine(const char* p, const char* pEnd)
+        {
+            const auto* pNewLine = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(pEnd - p)));
+            return pNewLine != nullptr ? pNewLine + 1 : pEnd;
+        }
+
+        /**
+         * Разбор числа с плавающей точкой
+         * @details До 19 значащих цифр мантисса накапливается в целом числе и умножается на точную степень 10
+         * (одно округление в double). Длинные мантиссы, большие порядки, inf и nan разбираются через strtod
+         * @param p Начало числа
+         * @param pEnd Конец текста
+         * @param pOut Результат
+         * @return Указатель на символ после числа (совпадает с p при ошибке)
+         */
+        inline const char* ParseFloat(const char* p, const char* pEnd, float* pOut)
+        {
+            const char* pStart = p;
+            bool negative = false;
+            if(p < pEnd && (*p == '-' || *p == '+')){
+                negative = *p == '-';
+                p++;
+            }
+
+            std::uint64_t mantissa = 0;
+            int digits = 0;
+            int exponent = 0;
+            bool anyDigits = false;
+            bool truncated = false;
+
+            for(; p < pEnd && IsDigit(*p); p++)
+            {
+                anyDigits = true;
+                if(digits < 19){
+                    mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+                    if(mantissa != 0) digits++;
+                }else{
+                    exponent++;
+                    truncated = true;
+                }
+            }
+
+            if(p < pEnd && *p == '.')
+            {
+                for(p++; p < pEnd && IsDigit(*p); p++)
+                {
+                    anyDigits = true;
+                    if(digits < 19){
+                        mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+                        if(mantissa != 0) digits++;
+                        exponent--;
+                    }else{
+                        truncated = true;
+                    }
+                }
+            }
+
+            if(anyDigits && p < pEnd && (*p == 'e' || *p == 'E'))
+            {
+                const char* pExponent = p + 1;
+                bool exponentNegative = false;
+                if(pExponent < pEnd && (*pExponent == '-' || *pExponent == '+')){
+                    exponentNegative = *pExponent == '-';
+                    pExponent++;
+                }
+
+                if(pExponent < pEnd && IsDigit(*pExponent))
+                {
+                    int value = 0;
+                    for(; pExponent < pEnd && IsDigit(*pExponent); pExponent++){
+                        if(value < 10000) value = value * 10 + (*pExponent - '0');
+                    }
+                    exponent += exponentNegative ? -value : value;
+                    p = pExponent;
+                }
+            }
+
+            // Быстрый путь
+            if(anyDigits && !truncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+            {
+                double value = static_cast<double>(mantissa);
+                value = exponent < 0 ? value / POW10[-exponent] : value * POW10[exponent];
+                *pOut = static_cast<float>(negative ? -value : value);
+                return p;
+            }
+
+            // Медленный путь (текст не завершается нулем - значение копируется)
+            char buffer[64];
+            const char* pTokenEnd = SkipToken(pStart, pEnd);
+            const size_t length = static_cast<size_t>(pTokenEnd - pStart) < sizeof(buffer) - 1 ? static_cast<size_t>(pTokenEnd - pStart) : sizeof(buffer) - 1;
+            std::memcpy(buffer, pStart, length);
+            buffer[length] = '\0';
+
+            char* pParsedEnd = nullptr;
+            const double value = std::strtod(buffer, &pParsedEnd);
+            if(pParsedEnd == buffer) return pStart;
+
+            *pOut = static_cast<float>(value);
+            return pStart + (pParsedEnd - buffer);
+        }
+
+        /**
+         * Разбор целого числа
+         * @param p Начало числа
+         * @param pEnd Конец текста
+         * @param pOut Результат
+         * @return Указатель на символ после числа (совпадает с p при ошибке)
+         */
+        inline const char* ParseInt(const char* p, const char* pEnd, std::int64_t* pOut)
+        {
+            const char* pStart = p;
+            bool negative = false;
+            if(p < pEnd && (*p == '-' || *p == '+')){
+                negative = *p == '-';
+                p++;
+            }
+
+            if(p >= pEnd || !IsDigit(*p)) return pStart;
+
+            std::int64_t value = 0;
+            for(; p < pEnd && IsDigit(*p); p++){
+                if(value < (INT64_MAX / 10)) value = value * 10 + (*p - '0');
+            }
+
+            *pOut = negative ? -value : value;
+            return p;
+        }
+
+        /**
+         * Разбить текст на отрезки, выровненные по строкам
+         * @param pBegin Начало текста
+         * @param pEnd Конец текста
+         * @param threadCount Кол-во потоков
+         * @return Массив отрезков
+         */
+        inline std::vector<TextChunk> SplitLines(const char* pBegin, const char* pEnd, unsigned threadCount)
+        {
+            // Несколько отрезков на поток для балансировки, но не меньше 256 Кб на отрезок
+            const size_t size = static_cast<size_t>(pEnd - pBegin);
+            size_t chunkSize = size / (static_cast<size_t>(threadCount) * 8 + 1);
+            if(chunkSize < (256u << 10)) chunkSize = 256u << 10;
+
+            std::vector<TextChunk> chunks;
+            const char* p = pBegin;
+            while(p < pEnd)
+            {
+                const char* pChunkEnd = static_cast<size_t>(pEnd - p) > chunkSize ? SkipLine(p + chunkSize, pEnd) : pEnd;
+                chunks.push_back({p, pChunkEnd});
+                p = pChunkEnd;
+            }
+            return chunks;
+        }
+
+        /**
+         * Обработать элементы [0, count) параллельно (по одному элементу на задачу)
+         * @tparam FN Тип функции обработки
+         * @param pThreadPool Пул потоков (nullptr - в вызывающем потоке)
+         * @param count Кол-во элементов
+         * @param fn Функция обработки fn(index)
+         */
+        template <typename FN>
+        void ForEachIndex(ThreadPool* pThreadPool, size_t count, const FN& fn)
+        {
+            if(pThreadPool == nullptr){
+                for(size_t i = 0; i < count; i++) fn(i);
+                return;
+            }
+
+            pThreadPool->parallelFor(count, 1, [&](size_t begin, size_t end, unsigned){
+                for(size_t i = begin; i < end; i++) fn(i);
+            });
+        }
+
+        /**
+         * Тип строки OBJ
+         */
+        enum class ObjLine
+        {
+            ePosition,
+            eTexCoord,
+            eNormal,
+            eFace,
+            eOther
+        };
+
+        /**
+         * Угол грани OBJ (0-базовые индексы, -1 если отсутствует)
+         */
+        struct ObjCorner
+        {
+            std::int32_t position;
+            std::int32_t texCoord;
+            std::int32_t normal;
+
+            bool operator==(const ObjCorner& other) const
+            {
+                return position == other.position && texCoord == other.texCoord && normal == other.normal;
+            }
+        };
+
+        /**
+         * Состояние отрезка OBJ
+         */
+        struct ObjChunk
+        {
+            TextChunk text;
+            size_t positionCount = 0;
+            size_t texCoordCount = 0;
+            size_t normalCount = 0;
+            size_t triangleCount = 0;
+            size_t positionOffset = 0;
+            size_t texCoordOffset = 0;
+            size_t normalOffset = 0;
+            size_t triangleOffset = 0;
+            bool error = false;
+        };
+
+        /**
+         * Определить тип строки OBJ
+         * @param p Начало строки (сдвигается за ключевое слово)
+         * @param pEnd Конец текста
+         * @return Тип строки
+         */
+        inline ObjLine ClassifyObjLine(const char*& p, const char* pEnd)
+        {
+            p = SkipSpaces(p, pEnd);
+            if(pEnd - p < 2) return ObjLine::eOther;
+
+            if(p[0] == 'v')
+            {
+                if(IsSpace(p[1])){ p += 1; return ObjLine::ePosition; }
+                if(pEnd - p >= 3 && IsSpace(p[2])){
+                    if(p[1] == 't'){ p += 2; return ObjLine::eTexCoord; }
+                    if(p[1] == 'n'){ p += 2; return ObjLine::eNormal; }
+                }
+            }
+            else if(p[0] == 'f' && IsSpace(p[1])){
+                p += 1;
+                return ObjLine::eFace;
+            }
+
+            return ObjLine::eOther;
+        }
+
+        /**
+         * Перевести индекс OBJ (1-базовый или отрицательный относительный) в 0-базовый
+         * @param value Индекс из файла
+         * @param countSoFar Кол-во элементов, объявленных до текущей строки
+         * @param pOut Результат
+         * @return Индекс корректен
+         */
+        inline bool ResolveObjIndex(std::int64_t value, size_t countSoFar, std::int32_t* pOut)
+        {
+            const std::int64_t resolved = value > 0 ? value - 1 : static_cast<std::int64_t>(countSoFar) + value;
+            if(value == 0 || resolved < 0 || resolved > INT32_MAX) return false;
+            *pOut = static_cast<std::int32_t>(resolved);
+            return true;
+        }
+
+        /**
+         * Подсчитать элементы отрезка OBJ
+         * @param chunk Отрезок
+         */
+        inline void CountObjChunk(ObjChunk& chunk)
+        {
+            const char* pEnd = chunk.text.pEnd;
+            for(const char* p = chunk.text.pBegin; p < pEnd; p = SkipLine(p, pEnd))
+            {
+                switch(ClassifyObjLine(p, pEnd))
+                {
+                    case ObjLine::ePosition: chunk.positionCount++; break;
+                    case ObjLine::eTexCoord: chunk.texCoordCount++; break;
+                    case ObjLine::eNormal: chunk.normalCount++; break;
+                    case ObjLine::eFace:
+                    {
+                        size_t corners = 0;
+                        for(p = SkipSpaces(p, pEnd); !IsTokenEnd(p, pEnd); p = SkipSpaces(p, pEnd)){
+                            corners++;
+                            p = SkipToken(p, pEnd);
+                        }
+                        if(corners >= 3) chunk.triangleCount += corners - 2;
+                        break;
+                    }
+                    default: break;
+                }
+            }
+        }
+
+        /**
+         * Разобрать отрезок OBJ
+         * @details Пишет в заранее выделенные массивы по смещениям отрезка. При ошибке разбор отрезка прекращается
+         * @param chunk Отрезок
+         * @param pPositions Массив положений
+         * @param pTexCoords Массив текстурных координат
+         * @param pNormals Массив нормалей
+         * @param pCorners Массив углов треугольников
+         */
+        inline void ParseObjChunk(ObjChunk& chunk,
+                                  math::Vec3<float>* pPositions,
+                                  math::Vec2<float>* pTexCoords,
+                                  math::Vec3<float>* pNormals,
+                                  ObjCorner* pCorners)
+        {
+            size_t positionIndex = chunk.positionOffset;
+            size_t texCoordIndex = chunk.texCoordOffset;
+            size_t normalIndex = chunk.normalOffset;
+            ObjCorner* pCorner = pCorners + chunk.triangleOffset * 3;
+
+            const auto parseFloats = [](const char* p, const char* pEnd, float* pValues, size_t count) -> const char* {
+                for(size_t i = 0; i < count; i++){
+                    const char* pNext = ParseFloat(SkipSpaces(p, pEnd), pEnd, pValues + i);
+                    if(pNext == SkipSpaces(p, pEnd)) return nullptr;
+                    p = pNext;
+                }
+                return p;
+            };
+
+            const char* pEnd = chunk.text.pEnd;
+            for(const char* p = chunk.text.pBegin; p < pEnd; p = SkipLine(p, pEnd))
+            {
+                switch(ClassifyObjLine(p, pEnd))
+                {
+                    case ObjLine::ePosition:
+                    {
+                        float v[3];
+                        if(parseFloats(p, pEnd, v, 3) == nullptr){ chunk.error = true; return; }
+                        pPositions[positionIndex++] = {v[0], v[1], v[2]};
+                        break;
+                    }
+                    case ObjLine::eTexCoord:
+                    {
+                        float v[2] = {0.0f, 0.0f};
+                        if(parseFloats(p, pEnd, v, 1) == nullptr){ chunk.error = true; return; }
+                        parseFloats(parseFloats(p, pEnd, v, 1), pEnd, v + 1, 1);
+                        pTexCoords[texCoordIndex++] = {v[0], v[1]};
+                        break;
+                    }
+                    case ObjLine::eNormal:
+                    {
+                        float v[3];
+                        if(parseFloats(p, pEnd, v, 3) == nullptr){ chunk.error = true; return; }
+                        pNormals[normalIndex++] = {v[0], v[1], v[2]};
+                        break;
+                    }
+                    case ObjLine::eFace:
+                    {
+                        // Многоугольник разбивается веером треугольников
+                        ObjCorner first = {}, previous = {};
+                        size_t corners = 0;
+
+                        for(p = SkipSpaces(p, pEnd); !IsTokenEnd(p, pEnd); p = SkipSpaces(p, pEnd))
+                        {
+                            ObjCorner corner = {-1, -1, -1};
+                            std::int64_t value = 0;
+
+                            const char* pNext = ParseInt(p, pEnd, &value);
+                            bool valid = pNext != p && ResolveObjIndex(value, positionIndex, &corner.position);
+                            p = pNext;
+
+                            if(valid && p < pEnd && *p == '/')
+                            {
+                                p++;
+                                if(p < pEnd && *p != '/'){
+                                    pNext = ParseInt(p, pEnd, &value);
+                                    valid = pNext != p && ResolveObjIndex(value, texCoordIndex, &corner.texCoord);
+                                    p = pNext;
+                                }
+                                if(valid && p < pEnd && *p == '/'){
+                                    p++;
+                                    pNext = ParseInt(p, pEnd, &value);
+                                    valid = pNext != p && ResolveObjIndex(value, normalIndex, &corner.normal);
+                                    p = pNext;
+                                }
+                            }
+
+                            if(!valid || !IsTokenEnd(p, pEnd)){
+                                chunk.error = true;
+                                return;
+                            }
+
+                            if(corners == 0) first = corner;
+                            if(corners >= 2){
+                                *pCorner++ = first;
+                                *pCorner++ = previous;
+                                *pCorner++ = corner;
+                            }
+                            previous = corner;
+                            corners++;
+                        }
+                        break;
+                    }
+                    default: break;
+                }
+            }
+        }
+
+        /**
+         * Тип значения PLY
+         */
+        enum class PlyType
+        {
+            eInt8, eUInt8, eInt16, eUInt16, eInt32, eUInt32, eFloat32, eFloat64, eUnknown
+        };
+
+        /**
+         * Свойство элемента PLY
+         */
+        struct PlyProperty
+        {
+            /// Тип значения (для списка - тип элементов)
+            PlyType type;
+            /// Тип кол-ва элементов списка
+            PlyType countType;
+            /// Является ли свойство списком
+            bool isList;
+            /// Компонент вершины (0-2 положение, 3-5 нормаль, 6-7 текстурные координаты, -1 не используется)
+            int target;
+            /// Индексы вершин грани
+            bool isFaceIndices;
+        };
+
+        /**
+         * Элемент PLY
+         */
+        struct PlyElement
+        {
+            std::string name;
+            size_t count;
+            std::vector<PlyProperty> properties;
+        };
+
+        inline PlyType GetPlyType(const std::string& name)
+        {
+            if(name == "char" || name == "int8") return PlyType::eInt8;
+            if(name == "uchar" || name == "uint8") return PlyType::eUInt8;
+            if(name == "short" || name == "int16") return PlyType::eInt16;
+            if(name == "ushort" || name == "uint16") return PlyType::eUInt16;
+            if(name == "int" || name == "int32") return PlyType::eInt32;
+            if(name == "uint" || name == "uint32") return PlyType::eUInt32;
+            if(name == "float" || name == "float32") return PlyType::eFloat32;
+            if(name == "double" || name == "float64") return PlyType::eFloat64;
+            return PlyType::eUnknown;
+        }
+
+        inline size_t GetPlyTypeSize(PlyType type)
+        {
+            switch(type)
+            {
+                case PlyType::eInt8: case PlyType::eUInt8: return 1;
+                case PlyType::eInt16: case PlyType::eUInt16: return 2;
+                case PlyType::eInt32: case PlyType::eUInt32: case PlyType::eFloat32: return 4;
+                case PlyType::eFloat64: return 8;
+                default: return 0;
+            }
+        }
+
+        inline int GetPlyVertexTarget(const std::string& name)
+        {
+            static const char* names[][2] = {
+                    {"x", nullptr}, {"y", nullptr}, {"z", nullptr},
+                    {"nx", nullptr}, {"ny", nullptr}, {"nz", nullptr},
+                    {"u", "s"}, {"v", "t"}
+            };
+            for(int i = 0; i < 8; i++){
+                if(name == names[i][0] || (names[i][1] != nullptr && name == names[i][1])) return i;
+                if(i >= 6 && name == std::string("texture_") + names[i][0]) return i;
+                if(i >= 6 && name == std::string("texture_") + names[i][1]) return i;
+            }
+            return -1;
+        }
+
+        /**
+         * Прочитать двоичное значение PLY
+         * @param p Указатель на значение
+         * @param type Тип значения
+         * @param swapBytes Порядок байт файла отличается от порядка байт платформы
+         * @return Значение
+         */
+        inline double ReadPlyValue(const std::uint8_t* p, PlyType type, bool swapBytes)
+        {
+            std::uint8_t bytes[8];
+            const size_t size = GetPlyTypeSize(type);
+            for(size_t i = 0; i < size; i++) bytes[i] = swapBytes ? p[size - 1 - i] : p[i];
+
+            switch(type)
+            {
+                case PlyType::eInt8: { std::int8_t v; std::memcpy(&v, bytes, 1); return v; }
+                case PlyType::eUInt8: return bytes[0];
+                case PlyType::eInt16: { std::int16_t v; std::memcpy(&v, bytes, 2); return v; }
+                case PlyType::eUInt16: { std::uint16_t v; std::memcpy(&v, bytes, 2); return v; }
+                case PlyType::eInt32: { std::int32_t v; std::memcpy(&v, bytes, 4); return v; }
+                case PlyType::eUInt32: { std::uint32_t v; std::memcpy(&v, bytes, 4); return v; }
+                case PlyType::eFloat32: { float v; std::memcpy(&v, bytes, 4); return v; }
+                case PlyType::eFloat64: { double v; std::memcpy(&v, bytes, 8); return v; }
+                default: return 0.0;
+            }
+        }
+
+        /**
+         * Записать компонент вершины
+         * @param mesh Меш
+         * @param index Индекс вершины
+         * @param target Компонент вершины
+         * @param value Значение
+         */
+        inline void SetPlyVertexComponent(ImportedMesh& mesh, size_t index, int target, float value)
+        {
+            switch(target)
+            {
+                case 0: mesh.positions[index].x = value; break;
+                case 1: mesh.positions[index].y = value; break;
+                case 2: mesh.positions[index].z = value; break;
+                case 3: mesh.normals[index].x = value; break;
+                case 4: mesh.normals[index].y = value; break;
+                case 5: mesh.normals[index].z = value; break;
+                case 6: mesh.texCoords[index].x = value; break;
+                case 7: mesh.texCoords[index].y = value; break;
+                default: break;
+            }
+        }
+    }
+
+    /**
+     * Загрузка меша из файла Wavefront OBJ
+     * @details Файл отображается в память и делится на отрезки по границам строк. Первый параллельный проход считает
+     * вершины, текстурные координаты, нормали и треугольники каждого отрезка, после чего (по префиксным суммам) все
+     * массивы выделяются один раз и второй параллельный проход пишет в них значения без синхронизации. Уникальные
+     * сочетания индексов (положение/текстура/нормаль) собираются таблицей с цепочками по индексу положения.
+     * Многоугольники разбиваются веером треугольников, материалы и группы игнорируются
+     * @param path Путь к файлу
+     * @param pThreadPool Пул потоков (nullptr - разбор в вызывающем потоке)
+     * @return Меш
+     */
+    inline ImportedMesh LoadObj(const std::string& path, ThreadPool* pThreadPool = nullptr)
+    {
+        MappedFile file(path);
+        const auto* pText = reinterpret_cast<const char*>(file.getData());
+        const unsigned threadCount = pThreadPool != nullptr ? pThreadPool->getThreadCount() : 1;
+
+        std::vector<detail::ObjChunk> chunks;
+        for(const auto& text : detail::SplitLines(pText, pText + file.getSize(), threadCount)){
+            chunks.emplace_back();
+            chunks.back().text = text;
+        }
+
+        // Подсчет и смещения отрезков
+        detail::ForEachIndex(pThreadPool, chunks.size(), [&](size_t i){ detail::CountObjChunk(chunks[i]); });
+
+        size_t positionCount = 0, texCoordCount = 0, normalCount = 0, triangleCount = 0;
+        for(auto& chunk : chunks)
+        {
+            chunk.positionOffset = positionCount;
+            chunk.texCoordOffset = texCoordCount;
+            chunk.normalOffset = normalCount;
+            chunk.triangleOffset = triangleCount;
+            positionCount += chunk.positionCount;
+            texCoordCount += chunk.texCoordCount;
+            normalCount += chunk.normalCount;
+            triangleCount += chunk.triangleCount;
+        }
+
+        if(positionCount > INT32_MAX || triangleCount * 3 > UINT32_MAX){
+            throw std::runtime_error("ERROR: OBJ file is too large " + path);
+        }
+
+        // Разбор
+        std::vector<math::Vec3<float>> positions(positionCount);
+        std::vector<math::Vec2<float>> texCoords(texCoordCount);
+        std::vector<math::Vec3<float>> normals(normalCount);
+        std::vector<detail::ObjCorner> corners(triangleCount * 3);
+
+        detail::ForEachIndex(pThreadPool, chunks.size(), [&](size_t i){
+            detail::ParseObjChunk(chunks[i], positions.data(), texCoords.data(), normals.data(), corners.data());
+        });
+
+        for(const auto& chunk : chunks){
+            if(chunk.error) throw std::runtime_error("ERROR: Can't parse OBJ file " + path);
+        }
+
+        ImportedMesh mesh;
+        mesh.indices.resize(corners.size());
+
+        const auto isValidCorner = [&](const detail::ObjCorner& c){
+            return static_cast<size_t>(c.position) < positionCount &&
+                   (c.texCoord == -1 || static_cast<size_t>(c.texCoord) < texCoordCount) &&
+                   (c.normal == -1 || static_cast<size_t>(c.normal) < normalCount);
+        };
+
+        if(texCoordCount == 0 && normalCount == 0)
+        {
+            // Только положения - вершины уже уникальны
+            for(size_t i = 0; i < corners.size(); i++){
+                if(!isValidCorner(corners[i])) throw std::runtime_error("ERROR: Invalid face index in OBJ file " + path);
+                mesh.indices[i] = static_cast<std::uint32_t>(corners[i].position);
+            }
+            mesh.positions = std::move(positions);
+        }
+        else
+        {
+            // Таблица уникальных углов с цепочками по индексу положения (идеальный хеш без коллизий между положениями):
+            // у положения обычно 1-2 варианта текстурных координат/нормалей, поэтому поиск - 1-2 сравнения
+            std::vector<std::uint32_t> heads(positionCount, UINT32_MAX);
+            std::vector<std::uint32_t> next;
+            std::vector<detail::ObjCorner> unique;
+            next.reserve(positionCount);
+            unique.reserve(positionCount);
+
+            for(size_t i = 0; i < corners.size(); i++)
+            {
+                const detail::ObjCorner& corner = corners[i];
+                if(!isValidCorner(corner)) throw std::runtime_error("ERROR: Invalid face index in OBJ file " + path);
+
+                std::uint32_t vertex = heads[corner.position];
+                while(vertex != UINT32_MAX && !(unique[vertex] == corner)) vertex = next[vertex];
+
+                if(vertex == UINT32_MAX)
+                {
+                    vertex = static_cast<std::uint32_t>(unique.size());
+                    unique.push_back(corner);
+                    next.push_back(heads[corner.position]);
+                    heads[corner.position] = vertex;
+                }
+
+                mesh.indices[i] = vertex;
+            }
+
+            // Сборка вершин
+            mesh.positions.resize(unique.size());
+            if(texCoordCount > 0) mesh.texCoords.resize(unique.size());
+            if(normalCount > 0) mesh.normals.resize(unique.size());
+
+            const size_t blockSize = 65536;
+            detail::ForEachIndex(pThreadPool, (unique.size() + blockSize - 1) / blockSize, [&](size_t block){
+                const size_t end = (block + 1) * blockSize < unique.size() ? (block + 1) * blockSize : unique.size();
+                for(size_t v = block * blockSize; v < end; v++)
+                {
+                    const detail::ObjCorner& c = unique[v];
+                    mesh.positions[v] = positions[c.position];
+                    if(texCoordCount > 0) mesh.texCoords[v] = c.texCoord >= 0 ? texCoords[c.texCoord] : math::Vec2<float>();
+                    if(normalCount > 0) mesh.normals[v] = c.normal >= 0 ? normals[c.normal] : math::Vec3<float>();
+                }
+            });
+        }
+
+        mesh.bounds = math::FindBoundingBox(mesh.positions);
+        return mesh;
+    }
+
+    /**
+     * Загрузка меша из файла PLY (ascii, binary_little_endian, binary_big_endian)
+     * @details Используются элементы vertex (x/y/z, nx/ny/nz, u/v или s/t) и face (vertex_indices), остальные
+     * пропускаются. Двоичные вершины имеют фиксированный размер и разбираются параллельно по диапазонам, двоичные грани
+     * переменного размера - последовательно. Текстовое тело делится на отрезки по строкам: параллельно считаются строки
+     * и треугольники отрезков, затем параллельно разбираются значения. Многоугольники разбиваются веером
+     * @param path Путь к файлу
+     * @param pThreadPool Пул потоков (nullptr - разбор в вызывающем потоке)
+     * @return Меш
+     */
+    inline ImportedMesh LoadPly(const std::string& path, ThreadPool* pThreadPool = nullptr)
+    {
+        MappedFile file(path);
+        const auto* pText = reinterpret_cast<const char*>(file.getData());
+        const char* pEnd = pText + file.getSize();
+
+        const auto fail = [&](const char* message){
+            throw std::runtime_error(std::string("ERROR: ") + message + " " + path);
+        };
+
+        // Заголовок
+        if(file.getSize() < 4 || std::memcmp(pText, "ply", 3) != 0) fail("Not a PLY file");
+
+        enum { eAscii, eBinaryLittleEndian, eBinaryBigEndian } format = eAscii;
+        std::vector<detail::PlyElement> elements;
+        const char* pBody = nullptr;
+
+        for(const char* p = detail::SkipLine(pText, pEnd); p < pEnd && pBody == nullptr; p = detail::SkipLine(p, pEnd))
+        {
+            // Слова строки
+            std::vector<std::string> words;
+            const char* pLineEnd = detail::SkipLine(p, pEnd);
+            for(const char* w = detail::SkipSpaces(p, pLineEnd); w < pLineEnd && *w != '\n'; w = detail::SkipSpaces(w, pLineEnd)){
+                const char* pWordEnd = detail::SkipToken(w, pLineEnd);
+                words.emplace_back(w, pWordEnd);
+                w = pWordEnd;
+            }
+
+            if(words.empty() || words[0] == "comment" || words[0] == "obj_info") continue;
+
+            if(words[0] == "format" && words.size() >= 2){
+                if(words[1] == "ascii") format = eAscii;
+                else if(words[1] == "binary_little_endian") format = eBinaryLittleEndian;
+                else if(words[1] == "binary_big_endian") format = eBinaryBigEndian;
+                else fail("Unknown PLY format in");
+            }
+            else if(words[0] == "element" && words.size() >= 3){
+                elements.push_back({words[1], static_cast<size_t>(std::strtoull(words[2].c_str(), nullptr, 10)), {}});
+            }
+            else if(words[0] == "property" && words.size() >= 3 && !elements.empty()){
+                detail::PlyProperty property = {};
+                property.isList = words[1] == "list";
+                if(property.isList && words.size() < 5) fail("Invalid PLY property in");
+
+                property.countType = property.isList ? detail::GetPlyType(words[2]) : detail::PlyType::eUnknown;
+                property.type = detail::GetPlyType(words[property.isList ? 3 : 1]);
+                if(property.type == detail::PlyType::eUnknown || (property.isList && property.countType == detail::PlyType::eUnknown)){
+                    fail("Unknown PLY property type in");
+                }
+
+                const std::string& name = words.back();
+                property.target = elements.back().name == "vertex" && !property.isList ? detail::GetPlyVertexTarget(name) : -1;
+                property.isFaceIndices = elements.back().name == "face" && property.isList && (name == "vertex_indices" || name == "vertex_index");
+                elements.back().properties.push_back(property);
+            }
+            else if(words[0] == "end_header"){
+                pBody = pLineEnd;
+            }
+        }
+
+        if(pBody == nullptr) fail("Missing PLY header end in");
+
+        // Какие компоненты вершин есть в файле
+        ImportedMesh mesh;
+        size_t vertexCount = 0;
+        bool hasNormals = false, hasTexCoords = false;
+        for(const auto& element : elements)
+        {
+            if(element.name != "vertex") continue;
+            vertexCount = element.count;
+            for(const auto& property : element.properties){
+                if(property.isList) fail("List vertex properties are not supported in");
+                hasNormals |= property.target >= 3 && property.target < 6;
+                hasTexCoords |= property.target >= 6;
+            }
+        }
+
+        if(vertexCount > UINT32_MAX) fail("PLY file is too large");
+        mesh.positions.resize(vertexCount);
+        if(hasNormals) mesh.normals.resize(vertexCount);
+        if(hasTexCoords) mesh.texCoords.resize(vertexCount);
+
+        if(format != eAscii)
+        {
+            // Порядок байт платформы
+            const std::uint16_t probe = 1;
+            std::uint8_t probeByte;
+            std::memcpy(&probeByte, &probe, 1);
+            const bool swapBytes = (probeByte == 1) != (format == eBinaryLittleEndian);
+
+            const auto* p = reinterpret_cast<const std::uint8_t*>(pBody);
+            const auto* pBinaryEnd = reinterpret_cast<const std::uint8_t*>(pEnd);
+
+            for(const auto& element : elements)
+            {
+                size_t stride = 0;
+                bool hasLists = false;
+                for(const auto& property : element.properties){
+                    stride += detail::GetPlyTypeSize(property.type);
+                    hasLists |= property.isList;
+                }
+
+                if(element.name == "vertex")
+                {
+                    if(static_cast<size_t>(pBinaryEnd - p) / (stride > 0 ? stride : 1) < element.count) fail("Truncated PLY file");
+
+                    const size_t blockSize = 65536;
+                    detail::ForEachIndex(pThreadPool, (element.count + blockSize - 1) / blockSize, [&](size_t block){
+                        const size_t end = (block + 1) * blockSize < element.count ? (block + 1) * blockSize : element.count;
+                        for(size_t v = block * blockSize; v < end; v++)
+                        {
+                            const std::uint8_t* pValue = p + v * stride;
+                            for(const auto& property : element.properties){
+                                if(property.target >= 0) detail::SetPlyVertexComponent(mesh, v, property.target, static_cast<float>(detail::ReadPlyValue(pValue, property.type, swapBytes)));
+                                pValue += detail::GetPlyTypeSize(property.type);
+                            }
+                        }
+                    });
+
+                    p += element.count * stride;
+                }
+                else if(element.name == "face" || hasLists)
+                {
+                    const bool isFace = element.name == "face";
+                    if(isFace) mesh.indices.reserve(element.count * 3);
+
+                    for(size_t f = 0; f < element.count; f++)
+                    {
+                        for(const auto& property : element.properties)
+                        {
+                            if(!property.isList){
+                                p += detail::GetPlyTypeSize(property.type);
+                                continue;
+                            }
+
+                            const size_t countSize = detail::GetPlyTypeSize(property.countType);
+                            const size_t valueSize = detail::GetPlyTypeSize(property.type);
+                            if(static_cast<size_t>(pBinaryEnd - p) < countSize) fail("Truncated PLY file");
+
+                            const auto count = static_cast<size_t>(detail::ReadPlyValue(p, property.countType, swapBytes));
+                            p += countSize;
+                            if(static_cast<size_t>(pBinaryEnd - p) / valueSize < count) fail("Truncated PLY file");
+
+                            if(isFace && property.isFaceIndices){
+                                const auto first = static_cast<std::uint32_t>(detail::ReadPlyValue(p, property.type, swapBytes));
+                                for(size_t k = 2; k < count; k++){
+                                    mesh.indices.push_back(first);
+                                    mesh.indices.push_back(static_cast<std::uint32_t>(detail::ReadPlyValue(p + (k - 1) * valueSize, property.type, swapBytes)));
+                                    mesh.indices.push_back(static_cast<std::uint32_t>(detail::ReadPlyValue(p + k * valueSize, property.type, swapBytes)));
+                                }
+                            }
+                            p += count * valueSize;
+                        }
+
+                        if(p > pBinaryEnd) fail("Truncated PLY file");
+                    }
+                }
+                else
+                {
+                    if(static_cast<size_t>(pBinaryEnd - p) / (stride > 0 ? stride : 1) < element.count) fail("Truncated PLY file");
+                    p += element.count * stride;
+                }
+            }
+        }
+        else
+        {
+            // Диапазоны строк элементов
+            size_t vertexLineBegin = 0, faceLineBegin = 0, faceCount = 0, totalLines = 0;
+            const detail::PlyElement* pVertexElement = nullptr;
+            const detail::PlyElement* pFaceElement = nullptr;
+            for(const auto& element : elements)
+            {
+                if(element.name == "vertex"){ vertexLineBegin = totalLines; pVertexElement = &element; }
+                if(element.name == "face"){ faceLineBegin = totalLines; faceCount = element.count; pFaceElement = &element; }
+                totalLines += element.count;
+            }
+
+            struct PlyChunk
+            {
+                detail::TextChunk text;
+                size_t lineCount = 0;
+                size_t firstLine = 0;
+                size_t triangleCount = 0;
+                size_t triangleOffset = 0;
+                bool error = false;
+            };
+
+            const unsigned threadCount = pThreadPool != nullptr ? pThreadPool->getThreadCount() : 1;
+            std::vector<PlyChunk> chunks;
+            for(const auto& text : detail::SplitLines(pBody, pEnd, threadCount)){
+                chunks.emplace_back();
+                chunks.back().text = text;
+            }
+
+            const auto isFaceLine = [&](size_t line){ return line >= faceLineBegin && line < faceLineBegin + faceCount; };
+            const auto isVertexLine = [&](size_t line){ return line >= vertexLineBegin && line < vertexLineBegin + vertexCount; };
+
+            // Кол-во строк в отрезках
+            detail::ForEachIndex(pThreadPool, chunks.size(), [&](size_t i){
+                for(const char* p = chunks[i].text.pBegin; p < chunks[i].text.pEnd; p = detail::SkipLine(p, chunks[i].text.pEnd)) chunks[i].lineCount++;
+            });
+
+            size_t lineCount = 0;
+            for(auto& chunk : chunks){
+                chunk.firstLine = lineCount;
+                lineCount += chunk.lineCount;
+            }
+            if(lineCount < totalLines) fail("Truncated PLY file");
+
+            // Позиция списка индексов среди свойств грани (значения до него пропускаются)
+            size_t faceIndicesProperty = 0;
+            if(pFaceElement != nullptr){
+                while(faceIndicesProperty < pFaceElement->properties.size() && !pFaceElement->properties[faceIndicesProperty].isFaceIndices) faceIndicesProperty++;
+            }
+
+            const auto findFaceIndices = [&](const char* p, const char* pLineEnd) -> const char* {
+                for(size_t k = 0; k < faceIndicesProperty && p != nullptr; k++)
+                {
+                    std::int64_t listCount = 1;
+                    if(pFaceElement->properties[k].isList){
+                        p = detail::SkipSpaces(p, pLineEnd);
+                        const char* pNext = detail::ParseInt(p, pLineEnd, &listCount);
+                        if(pNext == p || listCount < 0) return nullptr;
+                        p = pNext;
+                    }
+                    for(std::int64_t j = 0; j < listCount; j++) p = detail::SkipToken(detail::SkipSpaces(p, pLineEnd), pLineEnd);
+                }
+                return p != nullptr ? detail::SkipSpaces(p, pLineEnd) : nullptr;
+            };
+
+            // Кол-во треугольников в отрезках
+            if(pFaceElement != nullptr && faceIndicesProperty < pFaceElement->properties.size())
+            {
+                detail::ForEachIndex(pThreadPool, chunks.size(), [&](size_t i){
+                    PlyChunk& chunk = chunks[i];
+                    size_t line = chunk.firstLine;
+                    for(const char* p = chunk.text.pBegin; p < chunk.text.pEnd; p = detail::SkipLine(p, chunk.text.pEnd), line++)
+                    {
+                        if(!isFaceLine(line)) continue;
+                        std::int64_t count = 0;
+                        const char* pIndices = findFaceIndices(p, chunk.text.pEnd);
+                        if(pIndices == nullptr || detail::ParseInt(pIndices, chunk.text.pEnd, &count) == pIndices || count < 0){
+                            chunk.error = true;
+                            return;
+                        }
+                        if(count >= 3) chunk.triangleCount += static_cast<size_t>(count) - 2;
+                    }
+                });
+            }
+
+            size_t triangleCount = 0;
+            for(auto& chunk : chunks)
+            {
+                if(chunk.error) fail("Can't parse PLY file");
+                chunk.triangleOffset = triangleCount;
+                triangleCount += chunk.triangleCount;
+            }
+            if(triangleCount * 3 > UINT32_MAX) fail("PLY file is too large");
+            mesh.indices.resize(triangleCount * 3);
+
+            // Разбор значений
+            detail::ForEachIndex(pThreadPool, chunks.size(), [&](size_t i){
+                PlyChunk& chunk = chunks[i];
+                const char* pChunkEnd = chunk.text.pEnd;
+                std::uint32_t* pIndex = mesh.indices.data() + chunk.triangleOffset * 3;
+                size_t line = chunk.firstLine;
+
+                for(const char* p = chunk.text.pBegin; p < pChunkEnd; p = detail::SkipLine(p, pChunkEnd), line++)
+                {
+                    if(isVertexLine(line))
+                    {
+                        const size_t v = line - vertexLineBegin;
+                        for(const auto& property : pVertexElement->properties)
+                        {
+                            float value = 0.0f;
+                            p = detail::SkipSpaces(p, pChunkEnd);
+                            const char* pNext = detail::ParseFloat(p, pChunkEnd, &value);
+                            if(pNext == p){ chunk.error = true; return; }
+                            p = pNext;
+                            if(property.target >= 0) detail::SetPlyVertexComponent(mesh, v, property.target, value);
+                        }
+                    }
+                    else if(isFaceLine(line) && chunk.triangleCount > 0)
+                    {
+                        std::int64_t count = 0, first = 0, previous = 0;
+                        p = findFaceIndices(p, pChunkEnd);
+                        p = detail::ParseInt(p, pChunkEnd, &count);
+
+                        for(std::int64_t k = 0; k < count; k++)
+                        {
+                            std::int64_t index = 0;
+                            p = detail::SkipSpaces(p, pChunkEnd);
+                            const char* pNext = detail::ParseInt(p, pChunkEnd, &index);
+                            if(pNext == p || index < 0 || index > UINT32_MAX){ chunk.error = true; return; }
+                            p = pNext;
+
+                            if(k == 0) first = index;
+                            if(k >= 2){
+                                *pIndex++ = static_cast<std::uint32_t>(first);
+                                *pIndex++ = static_cast<std::uint32_t>(previous);
+                                *pIndex++ = static_cast<std::uint32_t>(index);
+                            }
+                            previous = index;
+                        }
+                    }
+                }
+            });
+
+            for(const auto& chunk : chunks){
+                if(chunk.error) fail("Can't parse PLY file");
+            }
+        }
+
+        for(const auto index : mesh.indices){
+            if(index >= vertexCount) fail("Invalid face index in PLY file");
+        }
+
+        mesh.bounds = math::FindBoundingBox(mesh.positions);
+        return mesh;
+    }
+
+    /**
+     * Загрузка меша (формат определяется по расширению файла: .obj или .ply)
+     * @param path Путь к файлу
+     * @param pThreadPool Пул потоков (nullptr - разбор в вызывающем потоке)
+     * @return Меш
+     */
+    inline ImportedMesh LoadMesh(const std::string& path, ThreadPool* pThreadPool = nullptr)
+    {
+        const size_t dot = path.find_last_of('.');
+        std::string extension = dot != std::string::npos ? path.substr(dot + 1) : std::string();
+        for(auto& c : extension) c = static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+
+        if(extension == "obj") return LoadObj(path, pThreadPool);
+        if(extension == "ply") return LoadPly(path, pThreadPool);
+        throw std::runtime_error("ERROR: Unsupported mesh format " + path);
+    }
+}
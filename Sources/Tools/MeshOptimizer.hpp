@@ -0,0 +1,353 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include <Math.hpp>
+
+#include "MeshImporter.hpp"
+
+namespace tools
+{
+    /**
+     * Результат оптимизации меша
+     */
+    struct MeshOptimizationStats
+    {
+        /// ACMR (среднее кол-во промахов кэша вершин на треугольник) до оптимизации
+        float acmrBefore = 0.0f;
+        /// ACMR после оптимизации
+        float acmrAfter = 0.0f;
+    };
+
+    /**
+     * Вычисление ACMR (average cache miss ratio) для FIFO-кэша вершин
+     * @details Моделируется кэш того же вида, что и в Rasterizer::DrawIndexed. Лучшее возможное значение около 0.5
+     * (каждая вершина обрабатывается один раз), худшее - 3.0
+     * @param pIndices Массив индексов (тройки вершин)
+     * @param indexCount Кол-во индексов
+     * @param vertexCount Кол-во вершин
+     * @param cacheSize Размер кэша
+     * @return Кол-во промахов на треугольник
+     */
+    inline float CalculateAcmr(const std::uint32_t* pIndices, size_t indexCount, size_t vertexCount, size_t cacheSize = 16)
+    {
+        if(indexCount < 3) return 0.0f;
+
+        // Вершина в кэше, если после ее добавления было меньше cacheSize промахов
+        std::vector<size_t> cachedAt(vertexCount, 0);
+        size_t misses = 0;
+
+        for(size_t i = 0; i < indexCount; i++)
+        {
+            const std::uint32_t index = pIndices[i];
+            if(cachedAt[index] == 0 || misses - cachedAt[index] >= cacheSize){
+                misses++;
+                cachedAt[index] = misses;
+            }
+        }
+
+        return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+    }
+
+    /**
+     * Переупорядочивание треугольников для кэша вершин (алгоритм Форсайта)
+     * @details Каждой вершине назначается вес по позиции в модели LRU-кэша и по кол-ву оставшихся треугольников,
+     * на каждом шаге выводится треугольник с наибольшей суммой весов среди треугольников вершин кэша. Веса
+     * пересчитываются только для вершин, позиция которых в кэше изменилась, поэтому время работы линейное
+     * @param pIndices Исходные индексы (тройки вершин)
+     * @param indexCount Кол-во индексов
+     * @param vertexCount Кол-во вершин
+     * @param pOut Результирующие индексы (не должны совпадать с исходными)
+     */
+    inline void OptimizeVertexCache(const std::uint32_t* pIndices, size_t indexCount, size_t vertexCount, std::uint32_t* pOut)
+    {
+        // Размер модели кэша и параметры функции веса
+        const int cacheSize = 32;
+        const unsigned maxValence = 32;
+        float cacheScores[cacheSize];
+        float valenceScores[maxValence + 1];
+
+        for(int i = 0; i < cacheSize; i++){
+            cacheScores[i] = i < 3 ? 0.75f : std::pow(1.0f - static_cast<float>(i - 3) / static_cast<float>(cacheSize - 3), 1.5f);
+        }
+        valenceScores[0] = 0.0f;
+        for(unsigned i = 1; i <= maxValence; i++){
+            valenceScores[i] = 2.0f / std::sqrt(static_cast<float>(i));
+        }
+
+        const size_t triangleCount = indexCount / 3;
+
+        // Списки треугольников вершин (в одном массиве)
+        std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+        for(size_t i = 0; i < triangleCount * 3; i++) offsets[pIndices[i] + 1]++;
+        for(size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+
+        std::vector<std::uint32_t> remaining(vertexCount);
+        std::vector<std::uint32_t> adjacency(triangleCount * 3);
+        for(size_t v = 0; v < vertexCount; v++) remaining[v] = 0;
+        for(size_t t = 0; t < triangleCount; t++){
+            for(size_t j = 0; j < 3; j++){
+                const std::uint32_t v = pIndices[t * 3 + j];
+                adjacency[offsets[v] + remaining[v]++] = static_cast<std::uint32_t>(t);
+            }
+        }
+
+        std::vector<int> cachePositions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        std::vector<float> triangleScores(triangleCount, 0.0f);
+        std::vector<bool> emitted(triangleCount, false);
+
+        const auto score = [&](std::uint32_t v){
+            if(remaining[v] == 0) return -1.0f;
+            const float valence = valenceScores[remaining[v] < maxValence ? remaining[v] : maxValence];
+            return cachePositions[v] >= 0 ? cacheScores[cachePositions[v]] + valence : valence;
+        };
+
+        for(size_t v = 0; v < vertexCount; v++) vertexScores[v] = score(static_cast<std::uint32_t>(v));
+        for(size_t t = 0; t < triangleCount; t++){
+            for(size_t j = 0; j < 3; j++) triangleScores[t] += vertexScores[pIndices[t * 3 + j]];
+        }
+
+        // Кэш (+3 места под вершины нового треугольника перед вытеснением)
+        std::uint32_t cache[cacheSize + 3];
+        int cacheCount = 0;
+
+        size_t bestTriangle = SIZE_MAX;
+        size_t inputCursor = 0;
+
+        for(size_t out = 0; out < triangleCount; out++)
+        {
+            // Нет кандидатов среди вершин кэша - следующий невыведенный треугольник в исходном порядке
+            if(bestTriangle == SIZE_MAX)
+            {
+                while(emitted[inputCursor]) inputCursor++;
+                bestTriangle = inputCursor;
+            }
+
+            const std::uint32_t* tri = pIndices + bestTriangle * 3;
+            pOut[out * 3 + 0] = tri[0];
+            pOut[out * 3 + 1] = tri[1];
+            pOut[out * 3 + 2] = tri[2];
+            emitted[bestTriangle] = true;
+
+            // Удалить треугольник из списков его вершин
+            for(size_t j = 0; j < 3; j++)
+            {
+                const std::uint32_t v = tri[j];
+                std::uint32_t* list = adjacency.data() + offsets[v];
+                for(std::uint32_t k = 0; k < remaining[v]; k++){
+                    if(list[k] == bestTriangle){
+                        list[k] = list[remaining[v] - 1];
+                        break;
+                    }
+                }
+                remaining[v]--;
+            }
+
+            // Новый кэш: вершины треугольника в начало, остальные сдвигаются
+            std::uint32_t newCache[cacheSize + 3];
+            int newCount = 0;
+            for(size_t j = 0; j < 3; j++) newCache[newCount++] = tri[j];
+            for(int k = 0; k < cacheCount; k++){
+                const std::uint32_t v = cache[k];
+                if(v != tri[0] && v != tri[1] && v != tri[2]) newCache[newCount++] = v;
+            }
+
+            // Обновить позиции и веса затронутых вершин и веса их треугольников
+            for(int k = 0; k < newCount; k++)
+            {
+                const std::uint32_t v = newCache[k];
+                cachePositions[v] = k < cacheSize ? k : -1;
+
+                const float newScore = score(v);
+                const float delta = newScore - vertexScores[v];
+                vertexScores[v] = newScore;
+
+                const std::uint32_t* list = adjacency.data() + offsets[v];
+                for(std::uint32_t a = 0; a < remaining[v]; a++) triangleScores[list[a]] += delta;
+            }
+
+            // Лучший треугольник среди треугольников вершин кэша
+            cacheCount = newCount < cacheSize ? newCount : cacheSize;
+            bestTriangle = SIZE_MAX;
+            float bestScore = 0.0f;
+
+            for(int k = 0; k < cacheCount; k++)
+            {
+                const std::uint32_t v = newCache[k];
+                const std::uint32_t* list = adjacency.data() + offsets[v];
+                for(std::uint32_t a = 0; a < remaining[v]; a++)
+                {
+                    if(triangleScores[list[a]] > bestScore){
+                        bestScore = triangleScores[list[a]];
+                        bestTriangle = list[a];
+                    }
+                }
+            }
+
+            std::copy(newCache, newCache + cacheCount, cache);
+        }
+    }
+
+    /**
+     * Переупорядочивание кластеров треугольников для уменьшения перерисовки
+     * @details Упорядоченная для кэша последовательность делится на кластеры в точках, где кэш начинается заново
+     * (все 3 вершины треугольника - промахи), поэтому перестановка кластеров почти не меняет ACMR. Кластеры
+     * сортируются так, чтобы первыми рисовались обращенные наружу (вероятнее закрывающие остальные при тесте глубины)
+     * @param pIndices Индексы (тройки вершин), упорядоченные OptimizeVertexCache
+     * @param indexCount Кол-во индексов
+     * @param pPositions Положения вершин
+     * @param vertexCount Кол-во вершин
+     * @param pOut Результирующие индексы (не должны совпадать с исходными)
+     * @param cacheSize Размер кэша
+     */
+    inline void OptimizeOverdraw(const std::uint32_t* pIndices,
+                                 size_t indexCount,
+                                 const math::Vec3<float>* pPositions,
+                                 size_t vertexCount,
+                                 std::uint32_t* pOut,
+                                 size_t cacheSize = 16)
+    {
+        const size_t triangleCount = indexCount / 3;
+        if(triangleCount == 0) return;
+
+        // Границы кластеров
+        std::vector<size_t> clusterStarts;
+        std::vector<size_t> cachedAt(vertexCount, 0);
+        size_t misses = 0;
+
+        for(size_t t = 0; t < triangleCount; t++)
+        {
+            unsigned triangleMisses = 0;
+            for(size_t j = 0; j < 3; j++)
+            {
+                const std::uint32_t index = pIndices[t * 3 + j];
+                if(cachedAt[index] == 0 || misses - cachedAt[index] >= cacheSize){
+                    misses++;
+                    cachedAt[index] = misses;
+                    triangleMisses++;
+                }
+            }
+            if(t == 0 || triangleMisses == 3) clusterStarts.push_back(t);
+        }
+        clusterStarts.push_back(triangleCount);
+
+        // Центр меша
+        math::Vec3<float> meshCenter(0.0f, 0.0f, 0.0f);
+        for(size_t i = 0; i < triangleCount * 3; i++) meshCenter = meshCenter + pPositions[pIndices[i]];
+        meshCenter = meshCenter / static_cast<float>(triangleCount * 3);
+
+        // Ключ сортировки - насколько кластер обращен от центра меша
+        const size_t clusterCount = clusterStarts.size() - 1;
+        std::vector<float> keys(clusterCount);
+        for(size_t c = 0; c < clusterCount; c++)
+        {
+            math::Vec3<float> center(0.0f, 0.0f, 0.0f);
+            math::Vec3<float> normal(0.0f, 0.0f, 0.0f);
+            float area = 0.0f;
+
+            for(size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+            {
+                const math::Vec3<float>& p0 = pPositions[pIndices[t * 3 + 0]];
+                const math::Vec3<float>& p1 = pPositions[pIndices[t * 3 + 1]];
+                const math::Vec3<float>& p2 = pPositions[pIndices[t * 3 + 2]];
+
+                // Нормаль, взвешенная площадью (удвоенной)
+                const math::Vec3<float> n = math::Cross(p1 - p0, p2 - p0);
+                const float triangleArea = math::Length(n);
+                center = center + (p0 + p1 + p2) * (triangleArea / 3.0f);
+                normal = normal + n;
+                area += triangleArea;
+            }
+
+            const float normalLength = math::Length(normal);
+            keys[c] = area > 0.0f && normalLength > 0.0f ? math::Dot(center / area - meshCenter, normal / normalLength) : 0.0f;
+        }
+
+        std::vector<size_t> order(clusterCount);
+        for(size_t c = 0; c < clusterCount; c++) order[c] = c;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return keys[a] > keys[b]; });
+
+        std::uint32_t* pDst = pOut;
+        for(const size_t c : order)
+        {
+            const size_t count = (clusterStarts[c + 1] - clusterStarts[c]) * 3;
+            std::copy(pIndices + clusterStarts[c] * 3, pIndices + clusterStarts[c] * 3 + count, pDst);
+            pDst += count;
+        }
+    }
+
+    /**
+     * Переупорядочивание вершин в порядке первого использования индексами
+     * @details Соседние по времени обращения вершины оказываются рядом в памяти. Индексы переписываются на месте,
+     * неиспользуемые вершины переносятся в конец
+     * @param pIndices Индексы (изменяются)
+     * @param indexCount Кол-во индексов
+     * @param vertexCount Кол-во вершин
+     * @return Таблица перестановки (новый индекс для каждой старой вершины), для RemapVertices
+     */
+    inline std::vector<std::uint32_t> OptimizeVertexFetch(std::uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+    {
+        std::vector<std::uint32_t> remap(vertexCount, UINT32_MAX);
+        std::uint32_t next = 0;
+
+        for(size_t i = 0; i < indexCount; i++)
+        {
+            std::uint32_t& target = remap[pIndices[i]];
+            if(target == UINT32_MAX) target = next++;
+            pIndices[i] = target;
+        }
+
+        for(auto& target : remap){
+            if(target == UINT32_MAX) target = next++;
+        }
+
+        return remap;
+    }
+
+    /**
+     * Переставить вершины по таблице перестановки
+     * @tparam T Тип атрибута вершины
+     * @param vertices Массив атрибута (переставляется)
+     * @param remap Таблица перестановки (OptimizeVertexFetch)
+     */
+    template <typename T>
+    void RemapVertices(std::vector<T>& vertices, const std::vector<std::uint32_t>& remap)
+    {
+        if(vertices.empty()) return;
+
+        std::vector<T> result(vertices.size());
+        for(size_t i = 0; i < vertices.size(); i++) result[remap[i]] = vertices[i];
+        vertices.swap(result);
+    }
+
+    /**
+     * Оптимизация импортированного меша: порядок треугольников для кэша вершин и перерисовки, порядок вершин для
+     * последовательного чтения
+     * @param mesh Меш (изменяется)
+     * @param cacheSize Размер кэша для вычисления ACMR и разбиения на кластеры
+     * @return ACMR до и после оптимизации
+     */
+    inline MeshOptimizationStats OptimizeMesh(ImportedMesh& mesh, size_t cacheSize = 16)
+    {
+        MeshOptimizationStats stats;
+        const size_t vertexCount = mesh.positions.size();
+        stats.acmrBefore = CalculateAcmr(mesh.indices.data(), mesh.indices.size(), vertexCount, cacheSize);
+
+        std::vector<std::uint32_t> indices(mesh.indices.size() - mesh.indices.size() % 3);
+        OptimizeVertexCache(mesh.indices.data(), indices.size(), vertexCount, indices.data());
+        OptimizeOverdraw(indices.data(), indices.size(), mesh.positions.data(), vertexCount, mesh.indices.data(), cacheSize);
+        mesh.indices.resize(indices.size());
+
+        const std::vector<std::uint32_t> remap = OptimizeVertexFetch(mesh.indices.data(), mesh.indices.size(), vertexCount);
+        RemapVertices(mesh.positions, remap);
+        RemapVertices(mesh.normals, remap);
+        RemapVertices(mesh.texCoords, remap);
+
+        stats.acmrAfter = CalculateAcmr(mesh.indices.data(), mesh.indices.size(), vertexCount, cacheSize);
+        return stats;
+    }
+}
@@ -0,0 +1,784 @@
+#pragma once
+
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include <Math.hpp>
+
+#include "MeshImporter.hpp"
+#include "MeshOptimizer.hpp"
+
+namespace tools
+{
+    /**
+     * Уровень детализации меша
+     * @details Все уровни используют общий массив вершин исходного меша, различаются только индексы
+     */
+    struct MeshLod
+    {
+        /// Индексы (тройки вершин)
+        std::vector<std::uint32_t> indices;
+        /// Отклонение от исходного меша (в единицах модели) - измеренное расстояние Хаусдорфа, см. MeasureMeshDeviation
+        float error = 0.0f;
+    };
+
+    namespace detail
+    {
+        /**
+         * Квадрика ошибки (сумма квадратов расстояний до плоскостей, взвешенная площадью)
+         * @details Хранится верхний треугольник симметричной матрицы 4x4: xx xy xz xw yy yz yw zz zw ww.
+         * Используется только для упорядочивания стягиваний - среднее значение не ограничивает сверху отклонение поверхности
+         */
+        struct Quadric
+        {
+            double m[10] = {};
+            double weight = 0.0;
+
+            void addPlane(double a, double b, double c, double d, double w)
+            {
+                m[0] += w * a * a; m[1] += w * a * b; m[2] += w * a * c; m[3] += w * a * d;
+                m[4] += w * b * b; m[5] += w * b * c; m[6] += w * b * d;
+                m[7] += w * c * c; m[8] += w * c * d;
+                m[9] += w * d * d;
+                weight += w;
+            }
+
+            Quadric operator+(const Quadric& other) const
+            {
+                Quadric result;
+                for(int i = 0; i < 10; i++) result.m[i] = m[i] + other.m[i];
+                result.weight = weight + other.weight;
+                return result;
+            }
+
+            /**
+             * Средний квадрат расстояния от точки до плоскостей (взвешенный площадью)
+             * @param p Точка
+             * @return Значение ошибки (не больше квадрата наибольшего расстояния до плоскостей)
+             */
+            double evaluate(const math::Vec3<float>& p) const
+            {
+                const double x = p.x, y = p.y, z = p.z;
+                const double e = m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x +
+                                 m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y +
+                                 m[7] * z * z + 2.0 * m[8] * z +
+                                 m[9];
+                return weight > 0.0 ? std::fabs(e) / weight : 0.0;
+            }
+        };
+
+        /**
+         * Кандидат на стягивание ребра (вершина source переносится в вершину target)
+         */
+        struct Collapse
+        {
+            std::uint32_t source;
+            std::uint32_t target;
+            double cost;
+        };
+
+        /**
+         * Ближайшая к точке точка треугольника
+         * @param p Точка
+         * @param a Первая вершина треугольника
+         * @param b Вторая вершина треугольника
+         * @param c Третья вершина треугольника
+         * @return Ближайшая точка (на треугольнике, включая ребра и вершины)
+         */
+        inline math::Vec3<float> ClosestPointOnTriangle(const math::Vec3<float>& p, const math::Vec3<float>& a, const math::Vec3<float>& b, const math::Vec3<float>& c)
+        {
+            const math::Vec3<float> ab = b - a, ac = c - a, ap = p - a;
+            const float d1 = math::Dot(ab, ap), d2 = math::Dot(ac, ap);
+            if(d1 <= 0.0f && d2 <= 0.0f) return a;
+
+            const math::Vec3<float> bp = p - b;
+            const float d3 = math::Dot(ab, bp), d4 = math::Dot(ac, bp);
+            if(d3 >= 0.0f && d4 <= d3) return b;
+
+            const float vc = d1 * d4 - d3 * d2;
+            if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+            const math::Vec3<float> cp = p - c;
+            const float d5 = math::Dot(ab, cp), d6 = math::Dot(ac, cp);
+            if(d6 >= 0.0f && d5 <= d6) return c;
+
+            const float vb = d5 * d2 - d1 * d6;
+            if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+            const float va = d3 * d6 - d5 * d4;
+            if(va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+            const float denominator = 1.0f / (va + vb + vc);
+            return a + ab * (vb * denominator) + ac * (vc * denominator);
+        }
+
+        /**
+         * Вырожден ли треугольник (площадь пренебрежимо мала относительно квадрата наибольшего ребра)
+         * @details Вырожденные треугольники не покрывают поверхность: при совпадающих вершинах (полюса UV-сфер, швы)
+         * такой треугольник после упрощения может стать отрезком через внутренность меша
+         * @param a Первая вершина
+         * @param b Вторая вершина
+         * @param c Третья вершина
+         * @return Треугольник вырожден
+         */
+        inline bool IsDegenerateTriangle(const math::Vec3<float>& a, const math::Vec3<float>& b, const math::Vec3<float>& c)
+        {
+            const math::Vec3<float> n = math::Cross(b - a, c - a);
+            const float longest = std::max(math::Dot(b - a, b - a), std::max(math::Dot(c - b, c - b), math::Dot(a - c, a - c)));
+            return math::Dot(n, n) <= 1e-12f * longest * longest;
+        }
+
+        /**
+         * Равномерная сетка треугольников для поиска расстояния от точки до поверхности
+         * @details Вырожденные треугольники в сетку не попадают
+         */
+        class TriangleGrid
+        {
+        private:
+            /// Положения вершин
+            const math::Vec3<float>* pPositions_;
+            /// Индексы (тройки вершин)
+            const std::uint32_t* pIndices_;
+            /// Начало сетки
+            math::Vec3<float> origin_;
+            /// Размер ячейки
+            float cellSize_;
+            /// Кол-во ячеек по осям
+            int resolution_[3];
+            /// Начала списков треугольников ячеек (по ячейкам подряд, последний элемент - общее кол-во)
+            std::vector<std::uint32_t> offsets_;
+            /// Треугольники ячеек
+            std::vector<std::uint32_t> triangles_;
+
+            /// Наибольшее кол-во слоев ячеек вокруг точки при поиске (ограничивает время поиска для далеких точек)
+            static constexpr int MAX_SEARCH_RADIUS = 8;
+
+            /**
+             * Индекс ячейки по координате (с ограничением границами сетки)
+             * @param value Координата
+             * @param axis Ось
+             * @return Индекс ячейки
+             */
+            int getCell(float value, int axis) const
+            {
+                const float origin = axis == 0 ? origin_.x : (axis == 1 ? origin_.y : origin_.z);
+                const int cell = static_cast<int>(std::floor((value - origin) / cellSize_));
+                return std::min(std::max(cell, 0), resolution_[axis] - 1);
+            }
+
+        public:
+            /**
+             * Конструктор
+             * @param pPositions Положения вершин
+             * @param pIndices Индексы (тройки вершин)
+             * @param indexCount Кол-во индексов (больше 0)
+             */
+            TriangleGrid(const math::Vec3<float>* pPositions, const std::uint32_t* pIndices, size_t indexCount):
+                    pPositions_(pPositions),
+                    pIndices_(pIndices)
+            {
+                const size_t triangleCount = indexCount / 3;
+
+                math::Vec3<float> min = pPositions[pIndices[0]], max = min;
+                for(size_t i = 0; i < triangleCount * 3; i++)
+                {
+                    const math::Vec3<float>& p = pPositions[pIndices[i]];
+                    min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+                    max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+                }
+
+                // Поверхность занимает около res² ячеек из res³: res = sqrt(T / 2) дает несколько треугольников на занятую
+                // ячейку, общее кол-во ячеек ограничено 8 * T (T - кол-во треугольников)
+                const float extent = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+                const float cellsPerAxis = std::max(1.0f, std::min(std::sqrt(static_cast<float>(triangleCount) * 0.5f), std::cbrt(static_cast<float>(triangleCount) * 8.0f)));
+                origin_ = min;
+                cellSize_ = extent > 0.0f ? extent / cellsPerAxis : 1.0f;
+                resolution_[0] = static_cast<int>((max.x - min.x) / cellSize_) + 1;
+                resolution_[1] = static_cast<int>((max.y - min.y) / cellSize_) + 1;
+                resolution_[2] = static_cast<int>((max.z - min.z) / cellSize_) + 1;
+
+                const size_t cellCount = static_cast<size_t>(resolution_[0]) * resolution_[1] * resolution_[2];
+                offsets_.assign(cellCount + 1, 0);
+
+                // Треугольник попадает во все ячейки своего описывающего параллелепипеда (два прохода: подсчет и запись)
+                for(int pass = 0; pass < 2; pass++)
+                {
+                    std::vector<std::uint32_t> fill;
+                    if(pass == 1){
+                        for(size_t c = 0; c < cellCount; c++) offsets_[c + 1] += offsets_[c];
+                        triangles_.resize(offsets_[cellCount]);
+                        fill.assign(offsets_.begin(), offsets_.end() - 1);
+                    }
+
+                    for(size_t t = 0; t < triangleCount; t++)
+                    {
+                        const math::Vec3<float>& a = pPositions[pIndices[t * 3]];
+                        const math::Vec3<float>& b = pPositions[pIndices[t * 3 + 1]];
+                        const math::Vec3<float>& c = pPositions[pIndices[t * 3 + 2]];
+                        if(IsDegenerateTriangle(a, b, c)) continue;
+
+                        const int x0 = getCell(std::min(a.x, std::min(b.x, c.x)), 0), x1 = getCell(std::max(a.x, std::max(b.x, c.x)), 0);
+                        const int y0 = getCell(std::min(a.y, std::min(b.y, c.y)), 1), y1 = getCell(std::max(a.y, std::max(b.y, c.y)), 1);
+                        const int z0 = getCell(std::min(a.z, std::min(b.z, c.z)), 2), z1 = getCell(std::max(a.z, std::max(b.z, c.z)), 2);
+
+                        for(int z = z0; z <= z1; z++) for(int y = y0; y <= y1; y++) for(int x = x0; x <= x1; x++)
+                        {
+                            const size_t cell = (static_cast<size_t>(z) * resolution_[1] + y) * resolution_[0] + x;
+                            if(pass == 0) offsets_[cell + 1]++;
+                            else triangles_[fill[cell]++] = static_cast<std::uint32_t>(t);
+                        }
+                    }
+                }
+            }
+
+            /**
+             * Расстояние от точки до поверхности
+             * @details Ячейки просматриваются слоями вокруг ячейки точки, пока найденное расстояние больше расстояния
+             * до еще не просмотренных ячеек, но не дальше MAX_SEARCH_RADIUS слоев. Для точек дальше от поверхности
+             * возвращается нижняя оценка - расстояние до непросмотренных ячеек. При поиске наибольшего расстояния
+             * точки ближе уже найденного максимума не важны: поиск прекращается, как только найден треугольник не
+             * дальше limit
+             * @param p Точка
+             * @param limit Расстояние, до которого точное значение не нужно
+             * @return Расстояние до ближайшего треугольника (или нижняя оценка, не меньше MAX_SEARCH_RADIUS - 1 ячеек),
+             * либо значение не больше limit
+             */
+            [[nodiscard]] float distance(const math::Vec3<float>& p, float limit = 0.0f) const
+            {
+                const float limitSquared = limit * limit;
+                const int center[3] = {getCell(p.x, 0), getCell(p.y, 1), getCell(p.z, 2)};
+                const float point[3] = {p.x, p.y, p.z};
+                const float origin[3] = {origin_.x, origin_.y, origin_.z};
+                // Квадрат расстояния
+                float best = FLT_MAX;
+
+                for(int r = 0; ; r++)
+                {
+                    int lo[3], hi[3];
+                    bool coversGrid = true;
+                    for(int axis = 0; axis < 3; axis++){
+                        lo[axis] = std::max(center[axis] - r, 0);
+                        hi[axis] = std::min(center[axis] + r, resolution_[axis] - 1);
+                        coversGrid = coversGrid && lo[axis] == 0 && hi[axis] == resolution_[axis] - 1;
+                    }
+
+                    // Только ячейки слоя r (внутренние просмотрены на предыдущих шагах), дальше найденного - пропускаются
+                    for(int z = lo[2]; z <= hi[2]; z++) for(int y = lo[1]; y <= hi[1]; y++) for(int x = lo[0]; x <= hi[0]; x++)
+                    {
+                        if(std::abs(x - center[0]) != r && std::abs(y - center[1]) != r && std::abs(z - center[2]) != r) continue;
+
+                        const size_t cell = (static_cast<size_t>(z) * resolution_[1] + y) * resolution_[0] + x;
+                        if(offsets_[cell] == offsets_[cell + 1]) continue;
+
+                        const int cellIndex[3] = {x, y, z};
+                        float cellDistance = 0.0f;
+                        for(int axis = 0; axis < 3; axis++){
+                            const float cellMin = origin[axis] + static_cast<float>(cellIndex[axis]) * cellSize_;
+                            const float outside = std::max(std::max(cellMin - point[axis], point[axis] - (cellMin + cellSize_)), 0.0f);
+                            cellDistance += outside * outside;
+                        }
+                        if(cellDistance >= best) continue;
+
+                        for(std::uint32_t i = offsets_[cell]; i < offsets_[cell + 1]; i++)
+                        {
+                            const std::uint32_t* tri = pIndices_ + triangles_[i] * 3;
+                            const math::Vec3<float> d = p - ClosestPointOnTriangle(p, pPositions_[tri[0]], pPositions_[tri[1]], pPositions_[tri[2]]);
+                            best = std::min(best, math::Dot(d, d));
+                        }
+                        if(best <= limitSquared) return std::sqrt(best);
+                    }
+
+                    if(coversGrid) return std::sqrt(best);
+
+                    // Расстояние до непросмотренных ячеек (со сторон, где сетка еще не закончилась)
+                    float bound = FLT_MAX;
+                    for(int axis = 0; axis < 3; axis++){
+                        if(lo[axis] > 0) bound = std::min(bound, point[axis] - (origin[axis] + static_cast<float>(lo[axis]) * cellSize_));
+                        if(hi[axis] < resolution_[axis] - 1) bound = std::min(bound, origin[axis] + static_cast<float>(hi[axis] + 1) * cellSize_ - point[axis]);
+                    }
+                    if(best <= bound * bound) return std::sqrt(best);
+                    if(r >= MAX_SEARCH_RADIUS) return bound;
+                }
+            }
+        };
+
+        /**
+         * Наибольшее расстояние от точек треугольников до поверхности
+         * @details Треугольники проверяются в узлах равномерного разбиения с шагом не больше step (вершины треугольников
+         * должны лежать на поверхности и не проверяются). Треугольники, у которых найдено не меньше половины наибольшего
+         * расстояния, проверяются повторно с шагом в 4 раза меньше - наибольшее расстояние может лежать между узлами.
+         * Вырожденные треугольники не проверяются. Точки ближе уже найденного максимума (при первом проходе - его
+         * половины) не уточняются, поэтому большинство запросов заканчивается на первом найденном треугольнике
+         * @param pPositions Положения вершин
+         * @param pIndices Индексы проверяемых треугольников
+         * @param indexCount Кол-во индексов
+         * @param grid Поверхность
+         * @param step Шаг разбиения
+         * @param knownDistance Уже известное расстояние (результат не меньше него)
+         * @return Наибольшее расстояние
+         */
+        inline float GetMaxDistanceToSurface(const math::Vec3<float>* pPositions, const std::uint32_t* pIndices, size_t indexCount, const TriangleGrid& grid, float step, float knownDistance = 0.0f)
+        {
+            const auto sampleTriangle = [&](size_t i, int density, float limit){
+                const math::Vec3<float>& a = pPositions[pIndices[i]];
+                const math::Vec3<float>& b = pPositions[pIndices[i + 1]];
+                const math::Vec3<float>& c = pPositions[pIndices[i + 2]];
+
+                const float longest = std::max(math::Length(b - a), std::max(math::Length(c - b), math::Length(a - c)));
+                // Кол-во делений ограничивается до перевода в int (переполнение при переводе - неопределенное поведение)
+                const float divisions = std::ceil(longest * static_cast<float>(density) / step);
+                const int n = divisions < static_cast<float>(32 * density) ? std::max(static_cast<int>(divisions), 2) : 32 * density;
+
+                float result = 0.0f;
+                for(int u = 0; u <= n; u++)
+                {
+                    for(int v = 0; u + v <= n; v++)
+                    {
+                        if(u == n || v == n || (u == 0 && v == 0)) continue;
+
+                        const float fu = static_cast<float>(u) / static_cast<float>(n);
+                        const float fv = static_cast<float>(v) / static_cast<float>(n);
+                        result = std::max(result, grid.distance(a * (1.0f - fu - fv) + b * fu + c * fv, std::max(limit, result)));
+                    }
+                }
+                return result;
+            };
+
+            const size_t triangleCount = indexCount / 3;
+            std::vector<float> triangleMax(triangleCount);
+            float result = knownDistance;
+            for(size_t t = 0; t < triangleCount; t++){
+                const bool degenerate = IsDegenerateTriangle(pPositions[pIndices[t * 3]], pPositions[pIndices[t * 3 + 1]], pPositions[pIndices[t * 3 + 2]]);
+                triangleMax[t] = degenerate ? 0.0f : sampleTriangle(t * 3, 1, result * 0.5f);
+                result = std::max(result, triangleMax[t]);
+            }
+
+            const float threshold = result * 0.5f;
+            for(size_t t = 0; t < triangleCount; t++){
+                if(triangleMax[t] >= threshold) result = std::max(result, sampleTriangle(t * 3, 4, result));
+            }
+            return result;
+        }
+    }
+
+    /**
+     * Упрощение меша стягиванием ребер по квадрикам ошибки
+     * @details Ребро стягивается в одну из своих вершин (новые вершины не создаются, поэтому нормали и текстурные
+     * координаты остаются корректными и массив вершин общий для всех уровней). Вершины с одинаковыми положениями
+     * (швы атрибутов) объединяются для топологии и стягиваются только вдоль шва, вершины на границах не переносятся -
+     * швы и края сохраняются. Работа идет проходами: кандидаты сортируются по ошибке и применяются, пока вершины не
+     * задеты другим стягиванием этого прохода. Отклоняются стягивания, переворачивающие треугольники, и стягивания,
+     * нарушающие условие связности (общие соседи вершин ребра - только вершины треугольников этого ребра), поэтому
+     * замкнутое двумерное многообразие остается многообразием того же рода.
+     * Ошибка - корень среднего (по площади) квадрата расстояния до плоскостей стянутой области. Это оценка для
+     * упорядочивания, она может быть меньше настоящего отклонения поверхности (его измеряет MeasureMeshDeviation)
+     * @param pPositions Положения вершин
+     * @param vertexCount Кол-во вершин
+     * @param pIndices Индексы (тройки вершин)
+     * @param indexCount Кол-во индексов
+     * @param targetIndexCount Желаемое кол-во индексов
+     * @param maxError Предельная ошибка стягивания (в единицах модели, по квадрикам)
+     * @param pResultError Наибольшая ошибка выполненных стягиваний (может быть nullptr)
+     * @return Индексы упрощенного меша
+     */
+    inline std::vector<std::uint32_t> SimplifyMesh(const math::Vec3<float>* pPositions,
+                                                   size_t vertexCount,
+                                                   const std::uint32_t* pIndices,
+                                                   size_t indexCount,
+                                                   size_t targetIndexCount,
+                                                   float maxError = FLT_MAX,
+                                                   float* pResultError = nullptr)
+    {
+        std::vector<std::uint32_t> indices(pIndices, pIndices + indexCount - indexCount % 3);
+        if(pResultError != nullptr) *pResultError = 0.0f;
+
+        // Вершины с одинаковым положением сводятся к одной (первой по порядку)
+        std::vector<std::uint32_t> canonical(vertexCount);
+        std::vector<bool> locked(vertexCount, false);
+        {
+            std::vector<std::uint32_t> order(vertexCount);
+            for(size_t v = 0; v < vertexCount; v++) order[v] = static_cast<std::uint32_t>(v);
+            std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b){
+                const math::Vec3<float>& pa = pPositions[a];
+                const math::Vec3<float>& pb = pPositions[b];
+                if(pa.x != pb.x) return pa.x < pb.x;
+                if(pa.y != pb.y) return pa.y < pb.y;
+                if(pa.z != pb.z) return pa.z < pb.z;
+                return a < b;
+            });
+
+            for(size_t i = 0; i < vertexCount; )
+            {
+                size_t j = i + 1;
+                const math::Vec3<float>& p = pPositions[order[i]];
+                while(j < vertexCount && pPositions[order[j]].x == p.x && pPositions[order[j]].y == p.y && pPositions[order[j]].z == p.z) j++;
+                for(size_t k = i; k < j; k++) canonical[order[k]] = order[i];
+                i = j;
+            }
+        }
+
+        // Вершины на границах (ребро принадлежит одному треугольнику)
+        {
+            std::vector<std::uint64_t> edges;
+            edges.reserve(indices.size());
+            for(size_t i = 0; i < indices.size(); i += 3)
+            {
+                for(size_t j = 0; j < 3; j++)
+                {
+                    const std::uint64_t a = canonical[indices[i + j]];
+                    const std::uint64_t b = canonical[indices[i + (j + 1) % 3]];
+                    edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+                }
+            }
+            std::sort(edges.begin(), edges.end());
+
+            for(size_t i = 0; i < edges.size(); )
+            {
+                size_t j = i + 1;
+                while(j < edges.size() && edges[j] == edges[i]) j++;
+                if(j - i == 1){
+                    locked[static_cast<std::uint32_t>(edges[i] >> 32)] = true;
+                    locked[static_cast<std::uint32_t>(edges[i] & 0xFFFFFFFFu)] = true;
+                }
+                i = j;
+            }
+        }
+
+        // Квадрики вершин (по каноническим вершинам)
+        std::vector<detail::Quadric> quadrics(vertexCount);
+        for(size_t i = 0; i < indices.size(); i += 3)
+        {
+            const math::Vec3<float>& p0 = pPositions[indices[i]];
+            const math::Vec3<float>& p1 = pPositions[indices[i + 1]];
+            const math::Vec3<float>& p2 = pPositions[indices[i + 2]];
+
+            const math::Vec3<float> n = math::Cross(p1 - p0, p2 - p0);
+            const double length = math::Length(n);
+            if(length == 0.0) continue;
+
+            const double a = n.x / length, b = n.y / length, c = n.z / length;
+            const double d = -(a * p0.x + b * p0.y + c * p0.z);
+            for(size_t j = 0; j < 3; j++) quadrics[canonical[indices[i + j]]].addPlane(a, b, c, d, length * 0.5);
+        }
+
+        const double maxCost = static_cast<double>(maxError) * static_cast<double>(maxError);
+        double resultCost = 0.0;
+
+        std::vector<std::uint32_t> offsets(vertexCount + 1);
+        std::vector<std::uint32_t> adjacency;
+        std::vector<detail::Collapse> collapses;
+        std::vector<bool> touched(vertexCount);
+        std::vector<bool> removed;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> mapping;
+        std::vector<std::uint32_t> sourceNeighbors;
+        std::vector<std::uint32_t> targetNeighbors;
+        std::vector<std::uint32_t> opposite;
+
+        // Канонические соседи вершины (кроме except) и вершины треугольников, содержащих обе вершины
+        const auto collectNeighbors = [&](std::uint32_t vertex, std::uint32_t except, std::vector<std::uint32_t>& neighbors, std::vector<std::uint32_t>* pOpposite){
+            neighbors.clear();
+            for(std::uint32_t a = offsets[vertex]; a < offsets[vertex + 1]; a++)
+            {
+                const std::uint32_t t = adjacency[a];
+                if(removed[t]) continue;
+
+                const std::uint32_t* tri = indices.data() + t * 3;
+                const bool shared = canonical[tri[0]] == except || canonical[tri[1]] == except || canonical[tri[2]] == except;
+                for(size_t j = 0; j < 3; j++)
+                {
+                    const std::uint32_t c = canonical[tri[j]];
+                    if(c == vertex || c == except) continue;
+                    neighbors.push_back(c);
+                    if(shared && pOpposite != nullptr) pOpposite->push_back(c);
+                }
+            }
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        };
+
+        const auto findMapping = [&](std::uint32_t source){
+            for(const auto& pair : mapping) if(pair.first == source) return pair.second;
+            return UINT32_MAX;
+        };
+
+        while(indices.size() > targetIndexCount)
+        {
+            const size_t triangleCount = indices.size() / 3;
+
+            // Треугольники канонических вершин
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for(const auto index : indices) offsets[canonical[index] + 1]++;
+            for(size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+
+            adjacency.resize(indices.size());
+            {
+                std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                for(size_t i = 0; i < indices.size(); i++) adjacency[fill[canonical[indices[i]]]++] = static_cast<std::uint32_t>(i / 3);
+            }
+
+            // Кандидаты
+            collapses.clear();
+            for(size_t i = 0; i < indices.size(); i += 3)
+            {
+                for(size_t j = 0; j < 3; j++)
+                {
+                    const std::uint32_t a = indices[i + j];
+                    const std::uint32_t b = indices[i + (j + 1) % 3];
+                    const std::uint32_t ca = canonical[a];
+                    const std::uint32_t cb = canonical[b];
+                    if(ca == cb) continue;
+
+                    const detail::Quadric q = quadrics[ca] + quadrics[cb];
+                    if(!locked[ca]) collapses.push_back({a, b, q.evaluate(pPositions[b])});
+                    if(!locked[cb]) collapses.push_back({b, a, q.evaluate(pPositions[a])});
+                }
+            }
+
+            std::sort(collapses.begin(), collapses.end(), [](const detail::Collapse& x, const detail::Collapse& y){ return x.cost < y.cost; });
+
+            std::fill(touched.begin(), touched.end(), false);
+            removed.assign(triangleCount, false);
+            size_t remainingIndices = indices.size();
+            size_t applied = 0;
+
+            for(const auto& collapse : collapses)
+            {
+                if(remainingIndices <= targetIndexCount || collapse.cost > maxCost) break;
+
+                const std::uint32_t cs = canonical[collapse.source];
+                const std::uint32_t ct = canonical[collapse.target];
+                if(touched[cs] || touched[ct]) continue;
+
+                // Условие связности: иначе стягивание склеивает разные части поверхности (дубли треугольников, ребра
+                // более чем с двумя треугольниками). Если соседей, кроме общих, нет ни у одной вершины (тетраэдр) -
+                // стягивание вырождает его в два совпадающих треугольника
+                opposite.clear();
+                collectNeighbors(cs, ct, sourceNeighbors, &opposite);
+                collectNeighbors(ct, cs, targetNeighbors, nullptr);
+                std::sort(opposite.begin(), opposite.end());
+                opposite.erase(std::unique(opposite.begin(), opposite.end()), opposite.end());
+
+                size_t common = 0;
+                for(size_t i = 0, j = 0; i < sourceNeighbors.size() && j < targetNeighbors.size(); )
+                {
+                    if(sourceNeighbors[i] < targetNeighbors[j]) i++;
+                    else if(sourceNeighbors[i] > targetNeighbors[j]) j++;
+                    else { common++; i++; j++; }
+                }
+
+                if(common != opposite.size()) continue;
+                if(sourceNeighbors.size() == opposite.size() && targetNeighbors.size() == opposite.size()) continue;
+
+                // Соответствие вершин источника вершинам цели (по треугольникам, содержащим ребро). На шве атрибутов у
+                // каждой стороны своя пара вершин, поэтому шов стягивается только вдоль себя
+                mapping.clear();
+                for(std::uint32_t a = offsets[cs]; a < offsets[cs + 1]; a++)
+                {
+                    const std::uint32_t t = adjacency[a];
+                    if(removed[t]) continue;
+
+                    const std::uint32_t* tri = indices.data() + t * 3;
+                    std::uint32_t source = UINT32_MAX, target = UINT32_MAX;
+                    for(size_t j = 0; j < 3; j++){
+                        if(canonical[tri[j]] == cs) source = tri[j];
+                        if(canonical[tri[j]] == ct) target = tri[j];
+                    }
+
+                    if(target != UINT32_MAX && findMapping(source) == UINT32_MAX) mapping.emplace_back(source, target);
+                }
+
+                // Проверка переворота треугольников, остающихся после переноса вершины
+                const math::Vec3<float>& newPosition = pPositions[collapse.target];
+                bool valid = true;
+
+                for(std::uint32_t a = offsets[cs]; a < offsets[cs + 1] && valid; a++)
+                {
+                    const std::uint32_t t = adjacency[a];
+                    if(removed[t]) continue;
+
+                    const std::uint32_t* tri = indices.data() + t * 3;
+                    if(canonical[tri[0]] == ct || canonical[tri[1]] == ct || canonical[tri[2]] == ct) continue;
+
+                    math::Vec3<float> p[3];
+                    for(size_t j = 0; j < 3; j++)
+                    {
+                        p[j] = pPositions[tri[j]];
+                        if(canonical[tri[j]] == cs){
+                            valid = findMapping(tri[j]) != UINT32_MAX;
+                            p[j] = newPosition;
+                        }
+                    }
+
+                    const math::Vec3<float> before = math::Cross(pPositions[tri[1]] - pPositions[tri[0]], pPositions[tri[2]] - pPositions[tri[0]]);
+                    const math::Vec3<float> after = math::Cross(p[1] - p[0], p[2] - p[0]);
+                    valid = valid && math::Dot(before, after) > 0.0f;
+                }
+
+                if(!valid) continue;
+
+                // Применить
+                for(std::uint32_t a = offsets[cs]; a < offsets[cs + 1]; a++)
+                {
+                    const std::uint32_t t = adjacency[a];
+                    if(removed[t]) continue;
+
+                    std::uint32_t* tri = indices.data() + t * 3;
+                    for(size_t j = 0; j < 3; j++) if(canonical[tri[j]] == cs) tri[j] = findMapping(tri[j]);
+
+                    if(canonical[tri[0]] == canonical[tri[1]] || canonical[tri[1]] == canonical[tri[2]] || canonical[tri[0]] == canonical[tri[2]]){
+                        removed[t] = true;
+                        remainingIndices -= 3;
+                    }
+                }
+
+                quadrics[ct] = quadrics[ct] + quadrics[cs];
+                touched[cs] = true;
+                touched[ct] = true;
+                resultCost = std::max(resultCost, collapse.cost);
+                applied++;
+            }
+
+            if(applied == 0) break;
+
+            // Удалить вырожденные треугольники
+            size_t write = 0;
+            for(size_t t = 0; t < triangleCount; t++)
+            {
+                if(removed[t]) continue;
+                for(size_t j = 0; j < 3; j++) indices[write * 3 + j] = indices[t * 3 + j];
+                write++;
+            }
+            indices.resize(write * 3);
+        }
+
+        if(pResultError != nullptr) *pResultError = static_cast<float>(std::sqrt(resultCost));
+        return indices;
+    }
+
+    /**
+     * Измерение отклонения упрощенного меша от исходного
+     * @details Двустороннее расстояние Хаусдорфа, измеренное по точкам: от вершин исходного меша до упрощенной поверхности
+     * и от точек упрощенных треугольников (разбиение с шагом среднего ребра исходного меша, вблизи наибольшего отклонения -
+     * в 4 раза мельче) до исходной поверхности. Расстояния до поверхности точные, но между точками отклонение может быть
+     * немного больше измеренного. Вырожденные треугольники (нулевой площади) поверхность не образуют и не учитываются.
+     * Поиск ближайшего треугольника ограничен несколькими ячейками сетки вокруг точки, поэтому отклонения больше
+     * примерно 8 ячеек (ячейка - порядка размера треугольника) не уточняются: возвращается нижняя оценка
+     * @param pPositions Положения вершин (общие для обоих мешей)
+     * @param pSourceIndices Индексы исходного меша
+     * @param sourceIndexCount Кол-во индексов исходного меша
+     * @param pIndices Индексы упрощенного меша
+     * @param indexCount Кол-во индексов упрощенного меша
+     * @return Отклонение (в единицах модели)
+     */
+    inline float MeasureMeshDeviation(const math::Vec3<float>* pPositions,
+                                      const std::uint32_t* pSourceIndices,
+                                      size_t sourceIndexCount,
+                                      const std::uint32_t* pIndices,
+                                      size_t indexCount)
+    {
+        if(sourceIndexCount < 3 || indexCount < 3) return sourceIndexCount < 3 && indexCount < 3 ? 0.0f : FLT_MAX;
+
+        size_t vertexCount = 0;
+        double edgeLength = 0.0;
+        for(size_t i = 0; i + 2 < sourceIndexCount; i += 3)
+        {
+            for(size_t j = 0; j < 3; j++)
+            {
+                vertexCount = std::max(vertexCount, static_cast<size_t>(pSourceIndices[i + j]) + 1);
+                edgeLength += math::Length(pPositions[pSourceIndices[i + (j + 1) % 3]] - pPositions[pSourceIndices[i + j]]);
+            }
+        }
+        const float step = std::max(static_cast<float>(edgeLength / static_cast<double>(sourceIndexCount - sourceIndexCount % 3)), FLT_MIN);
+
+        // От вершин исходного меша до упрощенной поверхности (каждая вершина один раз)
+        const detail::TriangleGrid grid(pPositions, pIndices, indexCount);
+        std::vector<bool> visited(vertexCount, false);
+        float result = 0.0f;
+        for(size_t i = 0; i < sourceIndexCount - sourceIndexCount % 3; i++)
+        {
+            const std::uint32_t v = pSourceIndices[i];
+            if(visited[v]) continue;
+            visited[v] = true;
+            result = std::max(result, grid.distance(pPositions[v], result));
+        }
+
+        // От точек упрощенных треугольников до исходной поверхности
+        const detail::TriangleGrid sourceGrid(pPositions, pSourceIndices, sourceIndexCount);
+        return detail::GetMaxDistanceToSurface(pPositions, pIndices, indexCount, sourceGrid, step, result);
+    }
+
+    /**
+     * Построение цепочки уровней детализации
+     * @details Каждый следующий уровень получается упрощением предыдущего до ratio от его треугольников. Ошибка уровня -
+     * отклонение от исходного меша (MeasureMeshDeviation), не меньше ошибки предыдущего уровня. Построение прекращается,
+     * когда уровень сокращается меньше чем на 10%. Индексы каждого уровня упорядочиваются для кэша вершин
+     * @param mesh Исходный меш (уровень 0)
+     * @param maxLevels Максимальное кол-во уровней (включая исходный)
+     * @param ratio Доля треугольников следующего уровня
+     * @return Уровни детализации от подробного к грубому
+     */
+    inline std::vector<MeshLod> BuildLodChain(const ImportedMesh& mesh, size_t maxLevels = 5, float ratio = 0.5f)
+    {
+        std::vector<MeshLod> lods;
+        if(maxLevels == 0) return lods;
+
+        lods.emplace_back();
+        lods.back().indices = mesh.indices;
+
+        while(lods.size() < maxLevels)
+        {
+            const MeshLod& previous = lods.back();
+            const size_t previousCount = previous.indices.size();
+            const auto target = static_cast<size_t>(static_cast<float>(previousCount / 3) * ratio) * 3;
+
+            std::vector<std::uint32_t> simplified = SimplifyMesh(mesh.positions.data(), mesh.positions.size(), previous.indices.data(), previousCount, target);
+            if(simplified.empty() || simplified.size() * 10 > previousCount * 9) break;
+
+            MeshLod lod;
+            lod.error = std::max(previous.error, MeasureMeshDeviation(mesh.positions.data(), mesh.indices.data(), mesh.indices.size(), simplified.data(), simplified.size()));
+            lod.indices.resize(simplified.size());
+            OptimizeVertexCache(simplified.data(), simplified.size(), mesh.positions.size(), lod.indices.data());
+            lods.push_back(std::move(lod));
+        }
+
+        return lods;
+    }
+
+    /**
+     * Размер объекта на экране
+     * @details Используются те же параметры, что и в GetProjectionMatPerspective (fov - вертикальный угол обзора)
+     * @param size Размер объекта (в единицах мира)
+     * @param distance Расстояние от наблюдателя
+     * @param fov Угол обзора (в градусах)
+     * @param screenHeight Высота экрана в пикселях
+     * @return Размер в пикселях
+     */
+    inline float GetProjectedSize(float size, float distance, float fov, float screenHeight)
+    {
+        const float tanHalfFov = std::tan(fov * math::DEG_TO_RAD * 0.5f);
+        return distance > 0.0f ? size / (distance * tanHalfFov) * screenHeight * 0.5f : FLT_MAX;
+    }
+
+    /**
+     * Выбор уровня детализации
+     * @details Выбирается самый грубый уровень, измеренное отклонение которого на экране не превышает maxPixelError
+     * @param lods Уровни детализации (BuildLodChain)
+     * @param distance Расстояние от наблюдателя до объекта
+     * @param fov Угол обзора (в градусах, как в GetProjectionMatPerspective)
+     * @param screenHeight Высота экрана в пикселях
+     * @param scale Масштаб объекта
+     * @param maxPixelError Допустимое отклонение в пикселях
+     * @return Индекс уровня
+     */
+    inline size_t SelectLod(const std::vector<MeshLod>& lods, float distance, float fov, float screenHeight, float scale = 1.0f, float maxPixelError = 1.0f)
+    {
+        size_t result = 0;
+        for(size_t i = 1; i < lods.size(); i++){
+            if(GetProjectedSize(lods[i].error * scale, distance, fov, screenHeight) <= maxPixelError) result = i;
+        }
+        return result;
+    }
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+namespace tools
+{
+    /**
+     * Пул рабочих потоков для параллельной обработки массивов
+     * @details Потоки создаются один раз и ждут задач, поэтому пул можно использовать каждый кадр.
+     * Вызывающий поток тоже участвует в обработке. Задача разбивается на отрезки, которые потоки забирают по очереди
+     */
+    class ThreadPool
+    {
+    private:
+        /// Рабочие потоки
+        std::vector<std::thread> workers_;
+        /// Мьютекс для синхронизации запуска и завершения задачи
+        std::mutex mutex_;
+        /// Сигнал о новой задаче (или остановке)
+        std::condition_variable wakeCondition_;
+        /// Сигнал о завершении задачи всеми потоками
+        std::condition_variable doneCondition_;
+
+        /// Функция вызова задачи (без выделения памяти под std::function)
+        void (*pInvoke_)(const void* pTask, size_t begin, size_t end, unsigned workerIndex);
+        /// Указатель на объект задачи (живет в стеке вызывающего потока на время parallelFor)
+        const void* pTask_;
+        /// Кол-во элементов задачи
+        size_t count_;
+        /// Размер отрезка
+        size_t chunkSize_;
+        /// Начало следующего свободного отрезка
+        std::atomic<size_t> nextChunk_;
+        /// Кол-во потоков, еще не закончивших текущую задачу
+        unsigned pendingWorkers_;
+        /// Номер текущей задачи
+        std::uint64_t generation_;
+        /// Остановка пула
+        bool stopping_;
+
+        /**
+         * Обработка отрезков текущей задачи, пока они не закончатся
+         * @param workerIndex Индекс потока
+         */
+        void runChunks(unsigned workerIndex)
+        {
+            for(;;)
+            {
+                const size_t begin = nextChunk_.fetch_add(chunkSize_);
+                if(begin >= count_) break;
+                const size_t end = begin + chunkSize_ < count_ ? begin + chunkSize_ : count_;
+                pInvoke_(pTask_, begin, end, workerIndex);
+            }
+        }
+
+        /**
+         * Цикл рабочего потока
+         * @param workerIndex Индекс потока
+         */
+        void workerLoop(unsigned workerIndex)
+        {
+            std::uint64_t lastGeneration = 0;
+            for(;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wakeCondition_.wait(lock, [&]{ return stopping_ || generation_ != lastGeneration; });
+                    if(stopping_) return;
+                    lastGeneration = generation_;
+                }
+
+                runChunks(workerIndex);
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(--pendingWorkers_ == 0) doneCondition_.notify_one();
+            }
+        }
+
+    public:
+        /**
+         * Конструктор
+         * @param threadCount Общее кол-во потоков с учетом вызывающего (0 - по кол-ву ядер)
+         */
+        explicit ThreadPool(unsigned threadCount = 0):
+                pInvoke_(nullptr),
+                pTask_(nullptr),
+                count_(0),
+                chunkSize_(1),
+                nextChunk_(0),
+                pendingWorkers_(0),
+                generation_(0),
+                stopping_(false)
+        {
+            if(threadCount == 0) threadCount = std::thread::hardware_concurrency();
+            if(threadCount == 0) threadCount = 1;
+
+            // Вызывающий поток имеет индекс 0, рабочие - с 1
+            workers_.reserve(threadCount - 1);
+            for(unsigned i = 1; i < threadCount; i++){
+                workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * Деструктор (дожидается завершения потоков)
+         */
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            wakeCondition_.notify_all();
+            for(auto& worker : workers_) worker.join();
+        }
+
+        /**
+         * Параллельная обработка диапазона [0, count)
+         * @details Блокирует вызывающий поток до завершения. Не должен вызываться из самой задачи
+         * @tparam FN Тип функции обработки
+         * @param count Кол-во элементов
+         * @param chunkSize Кол-во элементов в одном отрезке (минимальная единица работы потока)
+         * @param fn Функция обработки отрезка fn(begin, end, workerIndex), workerIndex - в диапазоне [0, getThreadCount())
+         */
+        template <typename FN>
+        void parallelFor(size_t count, size_t chunkSize, const FN& fn)
+        {
+            if(count == 0) return;
+            if(chunkSize == 0) chunkSize = 1;
+
+            // Если работа помещается в один отрезок - без синхронизации
+            if(workers_.empty() || count <= chunkSize){
+                fn(static_cast<size_t>(0), count, 0u);
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pInvoke_ = [](const void* pTask, size_t begin, size_t end, unsigned workerIndex){
+                    (*static_cast<const FN*>(pTask))(begin, end, workerIndex);
+                };
+                pTask_ = &fn;
+                count_ = count;
+                chunkSize_ = chunkSize;
+                nextChunk_.store(0);
+                pendingWorkers_ = static_cast<unsigned>(workers_.size());
+                generation_++;
+            }
+            wakeCondition_.notify_all();
+
+            runChunks(0);
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            doneCondition_.wait(lock, [&]{ return pendingWorkers_ == 0; });
+        }
+
+        /**
+         * Получить общее кол-во потоков (с учетом вызывающего)
+         * @return Целое положительное число
+         */
+        [[nodiscard]] unsigned getThreadCount() const
+        {
+            return static_cast<unsigned>(workers_.size()) + 1;
+        }
+    };
+}